@@ -0,0 +1,46 @@
+#include "allocator.h"
+
+#include <stdio.h>
+
+#include "arena.h"
+#include "hmap.h"
+
+int main(void)
+{
+    // create a memory arena and an allocator that uses it
+    Arena arena = arena_create(1 << 12);
+    Allocator alloc = arena_allocator(&arena);
+
+    // create a hmap whose items, keys, and data live in the arena
+    Hmap a = hmap_create_full(10, sizeof(int), 0.75, strhash_fnv1a, memcpy, 0, &alloc, 0);
+
+    // insert key-integer pairs 0 through 9
+    const char *key[] = {"zero", "one", "two",   "three", "four",
+                         "five", "six", "seven", "eight", "nine"};
+    for (int i = 0; i < 10; ++i) hmap_insert(&a, key[i], &i, 0);
+
+    // create a copy of the hmap that uses the standard allocator
+    Hmap b = hmap_create(10, sizeof(int));
+    HmapForEach(item, &a) hmap_insert(&b, item->key, item->data, 0);
+
+    // remove the item with key "six" from hmap a (no need to free the data)
+    hmap_remove(&a, "six");
+
+    // print items of hmap a
+    printf("a = {");
+    HmapForEach(item, &a) printf("%s: %d, ", item->key, *(int *)item->data);
+    printf("}\n");
+
+    // print items of hmap b
+    printf("b = {");
+    HmapForEach(item, &b) printf("%s: %d, ", item->key, *(int *)item->data);
+    printf("}\n");
+
+    // print arena usage
+    printf("arena used = %td bytes\n", arena.head - arena.data);
+
+    // clear items; hmap a does not free anything, the arena releases all memory at once
+    hmap_clear(&a);
+    hmap_clear(&b);
+    arena_clear(&arena);
+}
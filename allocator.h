@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// general purpose allocator interface; the *_create_full functions copy the allocator into the
+// container, but its context (e.g., an arena) must outlive the container; the copies of the data
+// that a container makes with data_copy are allocated through the allocator, so data_free must
+// release them through it as well (or be 0 if the allocator releases everything at once), and data
+// that is returned by *_pop or *_remove is released with allocator_free(&container.alloc, data)
+typedef struct Allocator Allocator;
+typedef void *AllocatorAllocate(void *, long, long, int);
+typedef void *AllocatorReallocate(void *, void *, long);
+typedef void AllocatorDeallocate(void *, void *);
+
+struct Allocator {
+    AllocatorAllocate *allocate;
+    AllocatorReallocate *reallocate;
+    AllocatorDeallocate *deallocate;
+    void *context;
+};
+
+static void *x__allocator_std_allocate(void *, long count, long size, int init)
+{
+    if (init) return calloc(count, size);
+    if (size && count > PTRDIFF_MAX / size) return 0;
+    return malloc(count * size);
+}
+
+static void *x__allocator_std_reallocate(void *, void *ptr, long size)
+{
+    return realloc(ptr, size);
+}
+
+static void x__allocator_std_deallocate(void *, void *ptr)
+{
+    free(ptr);
+}
+
+// allocator that uses malloc, calloc, realloc, and free
+static const Allocator allocator_std = {
+    .allocate = x__allocator_std_allocate,
+    .reallocate = x__allocator_std_reallocate,
+    .deallocate = x__allocator_std_deallocate,
+};
+
+// allocate memory for count objects of a given size; zero the memory if init is set
+static void *allocator_alloc(const Allocator *alloc, long count, long size, int init)
+{
+    return alloc->allocate(alloc->context, count, size, init);
+}
+
+// reallocate a block of memory
+static void *allocator_realloc(const Allocator *alloc, void *ptr, long size)
+{
+    return alloc->reallocate(alloc->context, ptr, size);
+}
+
+// release a block of memory; allocators without deallocate release everything at once
+static void allocator_free(const Allocator *alloc, void *ptr)
+{
+    if (alloc->deallocate) alloc->deallocate(alloc->context, ptr);
+}
+
+// return a copy of a string
+static char *allocator_strdup(const Allocator *alloc, const char *str)
+{
+    const long size = strlen(str) + 1;
+    char *copy = allocator_alloc(alloc, 1, size, 0);
+    return (copy ? memcpy(copy, str, size) : 0);
+}
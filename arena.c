@@ -21,22 +21,25 @@ int main(void)
     printf("\n");
 
     {  // create a temporary memory region (braces are not strictly needed)
-        Arena scratch = arena;
+        Arena save = arena_save(&arena);
 
         // allocate another string
-        char *b = strdup(&scratch, "foo");
+        char *b = strdup(&arena, "foo");
         printf("a = '%s'\n", a);
         printf("b = '%s'\n", b);
-        hexdump(scratch.data, scratch.head - scratch.data);
+        hexdump(arena.data, arena.head - arena.data);
         printf("\n");
 
         // resize last string
-        b = realloc(&scratch, b, strlen(b) + 4 + 1);
+        b = realloc(&arena, b, strlen(b) + 4 + 1);
         strcat(b, " bar");
         printf("a = '%s'\n", a);
         printf("b = '%s'\n", b);
-        hexdump(scratch.data, scratch.head - scratch.data);
+        hexdump(arena.data, arena.head - arena.data);
         printf("\n");
+
+        // release the temporary memory region
+        arena_restore(&arena, save);
     }
 
     // resize the first string
@@ -53,6 +56,20 @@ int main(void)
     hexdump(arena.data, arena.head - arena.data);
     printf("\n");
 
+    // allocate more memory than fits into the arena, which chains a new block
+    char *d = malloc(&arena, 4 << 10);
+    memset(d, 'd', 4 << 10);
+    printf("c = '%s'\n", c);
+    printf("d[0] = '%c', d[4095] = '%c'\n", d[0], d[(4 << 10) - 1]);
+
+    // allocate temporary memory in a loop, and release it after every iteration
+    for (long i = 0; i < 100; ++i) {
+        Arena save = arena_save(&arena);
+        for (long j = 0; j < 100; ++j) malloc(&arena, 1 << 10);
+        arena_restore(&arena, save);
+    }
+    printf("arena used = %td bytes of %ld\n", arena.head - arena.data, arena.block->capacity);
+
     // cleanup
     arena_clear(&arena);
 }
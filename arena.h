@@ -1,70 +1,166 @@
 #pragma once
 
 #include <assert.h>
+#include <limits.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
-// general purpose arena allocator
+#include "allocator.h"
+
+// general purpose arena allocator that chains a new block twice the size of the last one whenever
+// the last one is full; blocks come from calloc (or the allocator of arena_create_full), which maps
+// large blocks to fresh zero pages instead of clearing them; an arena must not be copied by value
+// to get a temporary region (as in `Arena scratch = arena;`), because the blocks that the copy
+// chains are leaked and clearing both copies frees the shared blocks twice; use arena_save and
+// arena_restore instead
 typedef struct Arena Arena;
+typedef struct ArenaBlock ArenaBlock;
 
 struct Arena {
+    ArenaBlock *block;
     char *data, *prev, *head, *tail;
+    Allocator alloc;
 };
 
-// create an empty arena
-static Arena arena_create(long capacity)
+struct ArenaBlock {
+    ArenaBlock *prev;
+    long capacity;
+    alignas(max_align_t) char data[];
+};
+
+static ArenaBlock *x__arena_block_create(Arena *arena, long capacity)
+{
+    ArenaBlock *block = allocator_alloc(&arena->alloc, 1, sizeof(*block) + capacity, 1);
+    assert(block);
+    block->prev = arena->block;
+    block->capacity = capacity;
+    arena->block = block;
+    arena->data = block->data;
+    arena->prev = block->data;
+    arena->head = block->data;
+    arena->tail = block->data + capacity;
+    return block;
+}
+
+// create an empty arena whose first block has a given capacity, and whose blocks are allocated by
+// alloc (by default, calloc and free)
+static Arena arena_create_full(long capacity, const Allocator *alloc)
 {
     assert(capacity > 0);
-    char *data = malloc(capacity);
-    assert(data);
-    return (Arena){
-        .data = memset(data, 0, capacity),
-        .prev = data,
-        .head = data,
-        .tail = data + capacity,
-    };
+    Arena arena = {.alloc = (alloc ? *alloc : allocator_std)};
+    x__arena_block_create(&arena, capacity);
+    return arena;
+}
+static Arena arena_create(long capacity)
+{
+    return arena_create_full(capacity, 0);
 }
 
-// allocate a block of memory; return aligned pointer on zero size; abort on out of memory
+// allocate a block of memory; return aligned pointer on zero size; chain a new block if the last
+// one is full
 [[gnu::malloc, gnu::alloc_size(2, 3), gnu::alloc_align(4)]]
 static void *arena_alloc(Arena *arena, long count, long size, long align, int init)
 {
     assert(arena);
     assert(arena->data);
     assert(align > 0 && (align & (align - 1)) == 0);
-    const long padding = -(uintptr_t)arena->head & (align - 1);
+    long padding = -(uintptr_t)arena->head & (align - 1);
     if (count <= 0 || size <= 0) return arena->head + padding;
     const long available = arena->tail - arena->head - padding;
-    if (available < 0 || count > available / size) abort();
+    if (available < 0 || count > available / size) {
+        assert(count <= (LONG_MAX - align) / size);
+        const long capacity = 2 * arena->block->capacity;
+        const long required = count * size + align;
+        x__arena_block_create(arena, (capacity > required ? capacity : required));
+        padding = -(uintptr_t)arena->head & (align - 1);
+    }
     arena->prev = arena->head + padding;
     assert((uintptr_t)arena->prev % align == 0);
     arena->head = arena->prev + count * size;
     return (init ? memset(arena->prev, 0, count * size) : arena->prev);
 }
 
-// reallocate a block of memory
+// return the end of the block that contains ptr
+static char *x__arena_block_end(const Arena *arena, const void *ptr)
+{
+    if (arena->data <= (char *)ptr && (char *)ptr <= arena->tail) return arena->head;
+    for (ArenaBlock *block = arena->block->prev; block; block = block->prev)
+        if (block->data <= (char *)ptr && (char *)ptr < block->data + block->capacity)
+            return block->data + block->capacity;
+    assert(!"pointer does not belong to the arena");
+    return 0;
+}
+
+// reallocate a block of memory; the last block grows in place while it fits into the last block
 static void *arena_realloc(Arena *arena, void *ptr, long new_size, long align)
 {
     assert(arena);
     assert(arena->data);
     if (!ptr || new_size <= 0) return arena_alloc(arena, 1, new_size, align, 0);
-    assert(arena->data <= (char *)ptr && (char *)ptr < arena->head + align);
     assert((uintptr_t)ptr % align == 0);
-    if (ptr == arena->prev) {
-        arena->head = arena->prev;
-        return arena_alloc(arena, 1, new_size, align, 0);
+    if (ptr == arena->prev && new_size <= arena->tail - arena->prev) {
+        arena->head = arena->prev + new_size;
+        return ptr;
     }
+    const long max_old_size = x__arena_block_end(arena, ptr) - (char *)ptr;
     void *new_ptr = arena_alloc(arena, 1, new_size, align, 0);
-    const long max_old_size = arena->prev - (char *)ptr;
     if (max_old_size <= 0) return new_ptr;
     return memcpy(new_ptr, ptr, (new_size < max_old_size ? new_size : max_old_size));
 }
 
+// return the current state of the arena, so that arena_restore can release everything that is
+// allocated after this call; the returned state is only meant for arena_restore, and must not be
+// used as an arena of its own
+static Arena arena_save(const Arena *arena)
+{
+    assert(arena);
+    return *arena;
+}
+
+// release everything that was allocated after the arena_save that returned save, including the
+// blocks that were chained since then
+static void arena_restore(Arena *arena, Arena save)
+{
+    assert(arena);
+    while (arena->block != save.block) {
+        assert(arena->block);
+        ArenaBlock *prev = arena->block->prev;
+        allocator_free(&arena->alloc, arena->block);
+        arena->block = prev;
+    }
+    *arena = save;
+}
+
 // remove all memory from the arena
 static void arena_clear(Arena *arena)
 {
     assert(arena);
-    free(arena->data);
+    for (ArenaBlock *block = arena->block, *prev; block; block = prev) {
+        prev = block->prev;
+        allocator_free(&arena->alloc, block);
+    }
     *arena = (Arena){0};
 }
+
+static void *x__arena_allocate(void *arena, long count, long size, int init)
+{
+    return arena_alloc(arena, count, size, alignof(max_align_t), init);
+}
+
+static void *x__arena_reallocate(void *arena, void *ptr, long size)
+{
+    return arena_realloc(arena, ptr, size, alignof(max_align_t));
+}
+
+// return an allocator that allocates from the arena; memory is only released by arena_clear
+static Allocator arena_allocator(Arena *arena)
+{
+    assert(arena);
+    return (Allocator){
+        .allocate = x__arena_allocate,
+        .reallocate = x__arena_reallocate,
+        .context = arena,
+    };
+}
@@ -9,6 +9,15 @@ int intcmp(const void *a, const void *b)
     return (*ia > *ib) - (*ia < *ib);
 }
 
+// integer key function
+uint64_t intkey(const void *a)
+{
+    return array_key_long(*(const int *)a);
+}
+
+// define a typed array of integers
+ARRAY_DEFINE(IntArray, int, intcmp)
+
 int main(void)
 {
     // create an array that stores integers
@@ -60,7 +69,69 @@ int main(void)
     printf("a.count(33) = %ld\n", array_count(&a, (int[]){33}));
     printf("b.count(33) = %ld\n", array_count(&b, (int[]){33}));
 
+    // create a flat array that stores integers inline, and insert integers 0 through 9 at the front
+    Array c = array_create_full(10, sizeof(int), intcmp, memcpy, 0, 0, ARRAY_FLAT);
+    for (int i = 0; i < 10; ++i) array_insert(&c, 0, &i);
+
+    // remove the first item from array c (the data must not be freed)
+    printf("c.pop(0) = %d\n", *(int *)array_pop(&c, 0));
+
+    // sort items of array c and print them
+    array_sort(&c, 0);
+    printf("c = [");
+    ArrayForEachFlat(data, &c) printf("%d, ", *(int *)data);
+    printf("]\n");
+
+    // create a typed array of integers, and append integers 9 through 0
+    IntArray d = IntArray_create(10, 0);
+    for (int i = 9; i >= 0; --i) IntArray_append(&d, i);
+
+    // remove the first item from array d, sort the rest, and print them
+    printf("d.pop(0) = %d\n", IntArray_pop(&d, 0));
+    IntArray_sort(&d, 0);
+    printf("d = [");
+    ArrayForEachTyped(item, &d) printf("%d, ", *item);
+    printf("]\n");
+
+    // create a large flat array of pseudo-random integers, and sort it in reverse
+    Array e = array_create_full(100000, sizeof(int), intcmp, memcpy, 0, 0, ARRAY_FLAT);
+    for (int i = 0; i < 100000; ++i) array_append(&e, &(int){(i * 7919) % 100003});
+    array_sort(&e, 1);
+    const int *data = e.data;
+    printf("e[0], e[1], e[-1] = %d, %d, %d\n", data[0], data[1], data[e.size - 1]);
+
+    // sort array e again, by integer keys using radix sort
+    array_sort_by_key(&e, intkey, 0);
+    data = e.data;
+    printf("e[0], e[1], e[-1] = %d, %d, %d\n", data[0], data[1], data[e.size - 1]);
+
+    // create an array with room for 16 integers, and append two batches of integers at once
+    Array f = array_create(0, sizeof(int), intcmp);
+    array_reserve(&f, 16);
+    array_extend(&f, (int[]){0, 1, 2, 3, 4, 5, 6, 7}, 8);
+    array_extend(&f, (int[]){8, 9, 10, 11}, 4);
+
+    // remove the first item from array f by moving the last item into its place, and release the
+    // unused capacity
+    free(array_swap_remove(&f, 0));
+    array_shrink_to_fit(&f);
+    printf("f = [");
+    ArrayForEach(item, &f) printf("%d, ", *(int *)item->data);
+    printf("]\n");
+    printf("f.capacity = %ld\n", f.capacity);
+
+    // append a batch of integers to the typed array d, and remove its first item out of order
+    IntArray_extend(&d, (int[]){10, 11, 12}, 3);
+    printf("d.swap_remove(0) = %d\n", IntArray_swap_remove(&d, 0));
+    printf("d = [");
+    ArrayForEachTyped(item, &d) printf("%d, ", *item);
+    printf("]\n");
+
     // clear items
     array_clear(&a);
     array_clear(&b);
+    array_clear(&c);
+    IntArray_clear(&d);
+    array_clear(&e);
+    array_clear(&f);
 }
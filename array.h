@@ -1,22 +1,34 @@
 #pragma once
 
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "allocator.h"
+
 // general purpose dynamic array
 typedef struct Array Array;
 typedef struct ArrayItem ArrayItem;
 typedef int ArrayDataCompare(const void *, const void *);
 typedef void *ArrayDataCopy(void *, const void *, size_t);
 typedef void ArrayDataFree(void *);
+typedef uint64_t ArrayDataKey(const void *);
+
+// store data inline in one contiguous buffer instead of one allocation per item
+enum { ARRAY_FLAT = 1 << 0 };
 
 struct Array {
-    long size, capacity, data_size;
+    long size, capacity, data_size, item_size;
+    int flags;
     ArrayDataCompare *data_cmp;
     ArrayDataCopy *data_copy;
     ArrayDataFree *data_free;
-    ArrayItem *item;
+    Allocator alloc;
+    union {
+        ArrayItem *item;
+        void *data;
+    };
 };
 
 struct ArrayItem {
@@ -29,43 +41,78 @@ struct ArrayItem {
 #define ArrayForEachReverse(item, array) \
     for (ArrayItem *item = (array)->item + (array)->size - 1; item >= (array)->item; --item)
 
-// create an empty array
+#define ArrayForEachFlat(data, array)                                                  \
+    for (void *data = x__array_data(array, 0); data < x__array_data(array, (array)->size); \
+         data = (char *)data + (array)->data_size)
+
+#define ArrayForEachFlatReverse(data, array)                                        \
+    for (void *data = x__array_data(array, (array)->size - 1);                      \
+         data >= x__array_data(array, 0); data = (char *)data - (array)->data_size)
+
+// create an empty array; in flat mode, data_copy is required and data_free must not free the data
 static Array array_create_full(long capacity, long data_size, ArrayDataCompare *data_cmp,
-                               ArrayDataCopy *data_copy, ArrayDataFree *data_free)
+                               ArrayDataCopy *data_copy, ArrayDataFree *data_free,
+                               const Allocator *alloc, int flags)
 {
     assert(capacity >= 0);
     assert(data_size >= 0);
+    assert(!(flags & ARRAY_FLAT) || (data_size > 0 && data_copy));
     return (Array){
         .capacity = capacity,
         .data_size = data_size,
+        .item_size = (flags & ARRAY_FLAT ? data_size : (long)sizeof(ArrayItem)),
+        .flags = flags,
         .data_cmp = data_cmp,
         .data_copy = data_copy,
         .data_free = data_free,
+        .alloc = (alloc ? *alloc : allocator_std),
     };
 }
 static Array array_create(long capacity, long data_size, ArrayDataCompare *data_cmp)
 {
-    return array_create_full(capacity, data_size, data_cmp, memcpy, free);
+    return array_create_full(capacity, data_size, data_cmp, memcpy, free, 0, 0);
+}
+
+static long x__array_slots(const Array *array)
+{
+    return array->capacity + (array->flags & ARRAY_FLAT ? 1 : 0);
 }
 
 static void x__array_create_items(Array *array)
 {
-    array->item = calloc(array->capacity, sizeof(*array->item));
-    assert(array->item);
+    array->data = allocator_alloc(&array->alloc, x__array_slots(array), array->item_size, 1);
+    assert(array->data);
+}
+
+static void x__array_reserve_items(Array *array, long capacity)
+{
+    array->capacity = capacity;
+    array->data =
+        allocator_realloc(&array->alloc, array->data, x__array_slots(array) * array->item_size);
+    assert(array->data);
 }
 
 static void x__array_resize_items(Array *array)
 {
     assert(array);
-    array->capacity = 2 * array->capacity + 1;
-    array->item = realloc(array->item, array->capacity * sizeof(*array->item));
-    assert(array->item);
+    x__array_reserve_items(array, 2 * array->capacity + 1);
+}
+
+static void *x__array_data(const Array *array, long i)
+{
+    if (array->flags & ARRAY_FLAT) return (char *)array->data + i * array->data_size;
+    return array->item[i].data;
+}
+
+static void *x__array_item(const Array *array, long i)
+{
+    return (char *)array->data + i * array->item_size;
 }
 
 static void x__array_item_create(const Array *array, ArrayItem *item, void *data)
 {
     if (data && array->data_copy) {
-        item->data = malloc(array->data_size);
+        item->data = allocator_alloc(&array->alloc, 1, array->data_size, 0);
         assert(item->data);
         array->data_copy(item->data, data, array->data_size);
     }
@@ -81,11 +128,17 @@ static void array_insert(Array *array, long i, void *data)
     assert(-array->size <= i && i <= array->size);
     if (!array->item) x__array_create_items(array);
     if (array->size + 1 > array->capacity) x__array_resize_items(array);
-    if (i != array->size) {
-        i = (array->size + i) % array->size;
-        for (long j = array->size; j > i; --j) array->item[j] = array->item[j - 1];
+    if (i != array->size) i = (array->size + i) % array->size;
+    if (array->flags & ARRAY_FLAT) {
+        assert(data);
+        char *item = x__array_data(array, i);
+        memmove(item + array->data_size, item, (array->size - i) * array->data_size);
+        array->data_copy(item, data, array->data_size);
+    }
+    else {
+        memmove(array->item + i + 1, array->item + i, (array->size - i) * sizeof(ArrayItem));
+        x__array_item_create(array, &array->item[i], data);
     }
-    x__array_item_create(array, &array->item[i], data);
     array->size += 1;
 }
 
@@ -95,29 +148,116 @@ static void array_append(Array *array, void *data)
     array_insert(array, array->size, data);
 }
 
+// make room for at least capacity items, so that the array does not need to grow until it holds
+// that many items
+static void array_reserve(Array *array, long capacity)
+{
+    assert(array);
+    assert(capacity >= 0);
+    if (!array->item) {
+        if (capacity > array->capacity) array->capacity = capacity;
+        x__array_create_items(array);
+    }
+    else if (capacity > array->capacity) {
+        x__array_reserve_items(array, capacity);
+    }
+}
+
+// add count items to the end of the array, whose data is stored consecutively in data (count *
+// data_size bytes), with at most one resize
+static void array_extend(Array *array, void *data, long count)
+{
+    assert(array);
+    assert(data || count == 0);
+    assert(count >= 0);
+    assert(array->data_size > 0);
+    if (count == 0) return;
+    long capacity = array->size + count;
+    if (capacity > array->capacity && capacity < 2 * array->capacity + 1)
+        capacity = 2 * array->capacity + 1;
+    array_reserve(array, capacity);
+    if (array->flags & ARRAY_FLAT) {
+        if (array->data_copy == memcpy)
+            memcpy(x__array_data(array, array->size), data, count * array->data_size);
+        else
+            for (long i = 0; i < count; ++i)
+                array->data_copy(x__array_data(array, array->size + i),
+                                 (char *)data + i * array->data_size, array->data_size);
+    }
+    else {
+        for (long i = 0; i < count; ++i)
+            x__array_item_create(array, &array->item[array->size + i],
+                                 (char *)data + i * array->data_size);
+    }
+    array->size += count;
+}
+
+// release the capacity that is not used by the items
+static void array_shrink_to_fit(Array *array)
+{
+    assert(array);
+    if (!array->item || array->capacity == array->size) return;
+    if (array->size == 0) {
+        allocator_free(&array->alloc, array->data);
+        array->data = 0;
+        array->capacity = 0;
+        return;
+    }
+    x__array_reserve_items(array, array->size);
+}
+
 // return a copy of the array
 static Array array_copy(const Array *array)
 {
     assert(array);
     Array copy = array_create_full(array->capacity, array->data_size, array->data_cmp,
-                                   array->data_copy, array->data_free);
+                                   array->data_copy, array->data_free, &array->alloc, array->flags);
     if (array->size == 0) return copy;
-    for (const ArrayItem *item = array->item; item < array->item + array->size; ++item)
-        array_append(&copy, item->data);
+    for (long i = 0; i < array->size; ++i) array_append(&copy, x__array_data(array, i));
     return copy;
 }
 
-// remove the item at the given position in the array, and return its data
+// return the data of an item that is about to be removed; a flat item is copied to the scratch slot
+// past the capacity
+static void *x__array_take(Array *array, long i)
+{
+    if (!(array->flags & ARRAY_FLAT)) return array->item[i].data;
+    return memcpy(x__array_data(array, array->capacity), x__array_data(array, i), array->data_size);
+}
+
+static void *x__array_pop(Array *array, long i)
+{
+    void *data = x__array_take(array, i);
+    char *item = x__array_item(array, i);
+    memmove(item, item + array->item_size, (array->size - 1 - i) * array->item_size);
+    array->size -= 1;
+    return data;
+}
+
+// remove the item at the given position in the array, and return its data; in flat mode, the data
+// is only valid until the array is modified again
 static void *array_pop(Array *array, long i)
 {
     assert(array);
     assert(-array->size <= i && i < array->size);
     if (array->size == 0) return 0;
     i = (array->size + i) % array->size;
-    void *data = array->item[i].data;
-    if (i != array->size)
-        for (long j = i; j < array->size; ++j) array->item[j] = array->item[j + 1];
+    return x__array_pop(array, i);
+}
+
+// remove the item at the given position in the array by moving the last item into its place, and
+// return its data; this does not preserve the order of the items (in flat mode, the data is only
+// valid until the array is modified again)
+static void *array_swap_remove(Array *array, long i)
+{
+    assert(array);
+    assert(-array->size <= i && i < array->size);
+    if (array->size == 0) return 0;
+    i = (array->size + i) % array->size;
+    void *data = x__array_take(array, i);
     array->size -= 1;
+    if (i != array->size)
+        memcpy(x__array_item(array, i), x__array_item(array, array->size), array->item_size);
     return data;
 }
 
@@ -127,15 +267,8 @@ static void *array_remove(Array *array, const void *data)
     assert(array);
     assert(array->data_cmp);
     if (array->size == 0) return 0;
-    for (long i = 0; i < array->size; ++i) {
-        if (!array->data_cmp(array->item[i].data, data)) {
-            void *item_data = array->item[i].data;
-            if (i != array->size)
-                for (long j = i; j < array->size; ++j) array->item[j] = array->item[j + 1];
-            array->size -= 1;
-            return item_data;
-        }
-    }
+    for (long i = 0; i < array->size; ++i)
+        if (!array->data_cmp(x__array_data(array, i), data)) return x__array_pop(array, i);
     return 0;
 }
 
@@ -146,7 +279,7 @@ static long array_index(const Array *array, const void *data)
     assert(array->data_cmp);
     if (array->size == 0) return 0;
     for (long i = 0; i < array->size; ++i)
-        if (!array->data_cmp(array->item[i].data, data)) return i;
+        if (!array->data_cmp(x__array_data(array, i), data)) return i;
     return -1;
 }
 
@@ -157,7 +290,7 @@ static void *array_find(const Array *array, const void *data)
     assert(array->data_cmp);
     if (array->size == 0) return 0;
     for (long i = 0; i < array->size; ++i)
-        if (!array->data_cmp(array->item[i].data, data)) return array->item[i].data;
+        if (!array->data_cmp(x__array_data(array, i), data)) return x__array_data(array, i);
     return 0;
 }
 
@@ -169,47 +302,119 @@ static long array_count(const Array *array, const void *data)
     if (array->size == 0) return 0;
     long n = 0;
     for (long i = 0; i < array->size; ++i)
-        if (!array->data_cmp(array->item[i].data, data)) n += 1;
+        if (!array->data_cmp(x__array_data(array, i), data)) n += 1;
     return n;
 }
 
-static long x__array_quick_sort_partition(ArrayItem *item, long low, long high,
-                                          ArrayDataCompare cmp, int order)
+static int x__array_sort_cmp(const Array *array, long i, long j, int order)
+{
+    return order * array->data_cmp(x__array_data(array, i), x__array_data(array, j));
+}
+
+static void x__array_sort_swap(const Array *array, long i, long j)
+{
+    if (!(array->flags & ARRAY_FLAT)) {
+        const ArrayItem swap = array->item[i];
+        array->item[i] = array->item[j];
+        array->item[j] = swap;
+        return;
+    }
+    char *a = x__array_item(array, i), *b = x__array_item(array, j);
+    long k = 0;
+    for (; k + (long)sizeof(long) <= array->item_size; k += sizeof(long)) {
+        long swap;
+        memcpy(&swap, a + k, sizeof(swap));
+        memcpy(a + k, b + k, sizeof(swap));
+        memcpy(b + k, &swap, sizeof(swap));
+    }
+    for (; k < array->item_size; ++k) {
+        const char swap = a[k];
+        a[k] = b[k];
+        b[k] = swap;
+    }
+}
+
+// ranges of at most this many items are sorted by insertion sort
+enum { X__ARRAY_SORT_CUTOFF = 16 };
+
+static void x__array_insertion_sort(const Array *array, long low, long high, int order)
+{
+    for (long i = low + 1; i <= high; ++i)
+        for (long j = i; j > low && x__array_sort_cmp(array, j - 1, j, order) > 0; --j)
+            x__array_sort_swap(array, j - 1, j);
+}
+
+// restore the heap order of positions [root, end) of the range starting at low, whose subtrees
+// below root are already heaps
+static void x__array_sift_down(const Array *array, long low, long root, long end, int order)
+{
+    for (long child; (child = 2 * root + 1) < end; root = child) {
+        if (child + 1 < end && x__array_sort_cmp(array, low + child, low + child + 1, order) < 0)
+            child += 1;
+        if (x__array_sort_cmp(array, low + root, low + child, order) >= 0) return;
+        x__array_sort_swap(array, low + root, low + child);
+    }
+}
+
+static void x__array_heap_sort(const Array *array, long low, long high, int order)
+{
+    const long n = high - low + 1;
+    for (long i = n / 2 - 1; i >= 0; --i) x__array_sift_down(array, low, i, n, order);
+    for (long end = n - 1; end > 0; --end) {
+        x__array_sort_swap(array, low, low + end);
+        x__array_sift_down(array, low, 0, end, order);
+    }
+}
+
+// move the median of the first, middle, and last item to low, and partition the range around it;
+// items equal to the pivot stop both scans, so that many equal items still give balanced parts
+static long x__array_partition(const Array *array, long low, long high, int order)
 {
-    long p = low + rand() % (high - low + 1), i = low + 1, j = high;
-    ArrayItem pivot = item[p];
-    item[p] = item[low];
-    item[low] = pivot;
+    const long mid = low + (high - low) / 2;
+    if (x__array_sort_cmp(array, mid, low, order) < 0) x__array_sort_swap(array, mid, low);
+    if (x__array_sort_cmp(array, high, mid, order) < 0) {
+        x__array_sort_swap(array, high, mid);
+        if (x__array_sort_cmp(array, mid, low, order) < 0) x__array_sort_swap(array, mid, low);
+    }
+    x__array_sort_swap(array, low, mid);
+    long i = low + 1, j = high;
     while (1) {
-        while (i <= high && order * cmp(item[i].data, pivot.data) <= 0) i += 1;
-        while (j >= low && order * cmp(item[j].data, pivot.data) > 0) j -= 1;
+        while (i <= j && x__array_sort_cmp(array, i, low, order) < 0) i += 1;
+        while (i <= j && x__array_sort_cmp(array, j, low, order) > 0) j -= 1;
         if (i >= j) break;
-        ArrayItem swap = item[i];
-        item[i] = item[j];
-        item[j] = swap;
+        x__array_sort_swap(array, i++, j--);
     }
-    item[low] = item[j];
-    item[j] = pivot;
+    x__array_sort_swap(array, low, j);
     return j;
 }
 
-static void x__array_quick_sort(ArrayItem *item, long low, long high, ArrayDataCompare cmp,
-                                int order)
+// sort a range with introsort: quicksort, but insertion sort for small ranges, and heapsort once
+// the recursion depth is exhausted, which bounds the time by O(n log n)
+static void x__array_sort(const Array *array, long low, long high, int order, long depth)
 {
-    if (low < high) {
-        long pivot = x__array_quick_sort_partition(item, low, high, cmp, order);
-        x__array_quick_sort(item, low, pivot - 1, cmp, order);
-        x__array_quick_sort(item, pivot + 1, high, cmp, order);
+    while (high - low + 1 > X__ARRAY_SORT_CUTOFF) {
+        if (depth-- == 0) {
+            x__array_heap_sort(array, low, high, order);
+            return;
+        }
+        const long p = x__array_partition(array, low, high, order);
+        if (p - low < high - p) {
+            x__array_sort(array, low, p - 1, order, depth);
+            low = p + 1;
+        }
+        else {
+            x__array_sort(array, p + 1, high, order, depth);
+            high = p - 1;
+        }
     }
+    x__array_insertion_sort(array, low, high, order);
 }
 
-// sort the items of the array in place
-static void array_sort(Array *array, int reverse)
+static long x__array_sort_depth(long size)
 {
-    assert(array);
-    assert(array->data_cmp);
-    if (array->size == 0) return;
-    x__array_quick_sort(array->item, 0, array->size - 1, array->data_cmp, (reverse ? -1 : 1));
+    long depth = 0;
+    while (size >>= 1) depth += 2;
+    return depth;
 }
 
 // reverse the elements of the array in place
@@ -217,6 +422,15 @@ static void array_reverse(Array *array)
 {
     assert(array);
     if (array->size == 0) return;
+    if (array->flags & ARRAY_FLAT) {
+        char *scratch = x__array_data(array, array->capacity);
+        for (long i = 0, j = array->size - 1; i < array->size / 2; ++i, --j) {
+            memcpy(scratch, x__array_data(array, i), array->data_size);
+            memcpy(x__array_data(array, i), x__array_data(array, j), array->data_size);
+            memcpy(x__array_data(array, j), scratch, array->data_size);
+        }
+        return;
+    }
     for (long i = 0, j = array->size - 1; i < array->size / 2; ++i, --j) {
         ArrayItem swap = array->item[i];
         array->item[i] = array->item[j];
@@ -224,13 +438,301 @@ static void array_reverse(Array *array)
     }
 }
 
+// sort the items of the array in place
+static void array_sort(Array *array, int reverse)
+{
+    assert(array);
+    assert(array->data_cmp);
+    if (array->size == 0) return;
+    x__array_sort(array, 0, array->size - 1, (reverse ? -1 : 1), x__array_sort_depth(array->size));
+}
+
+// map signed integers to unsigned keys with the same order, for array_sort_by_key
+static uint64_t array_key_long(long key)
+{
+    return (uint64_t)key ^ (1ULL << 63);
+}
+
+// map floating-point numbers to unsigned keys with the same order, for array_sort_by_key
+static uint64_t array_key_double(double key)
+{
+    uint64_t bits;
+    memcpy(&bits, &key, sizeof(bits));
+    return (bits >> 63 ? ~bits : bits | (1ULL << 63));
+}
+
+// sort the items of the array by the unsigned 64-bit key that data_key returns for their data,
+// using a stable LSD radix sort with 8-bit digits; instead of O(n log n) calls of data_cmp, it
+// calls data_key n times, and skips the digits that are the same for all keys; every pass moves
+// the keys together with the items, so that all memory accesses are sequential or go to one of 256
+// buckets
+static void array_sort_by_key(Array *array, ArrayDataKey *data_key, int reverse)
+{
+    assert(array);
+    assert(data_key);
+    if (array->size < 2) return;
+    const long n = array->size, item_size = array->item_size;
+    const long size = sizeof(uint64_t) + (item_size + 7) / 8 * 8;
+    char *record = allocator_alloc(&array->alloc, 2 * n, size, 0), *swap = record + n * size;
+    assert(record);
+    long count[8][256] = {0};
+    for (long i = 0; i < n; ++i) {
+        const uint64_t key = data_key(x__array_data(array, i)) ^ (reverse ? UINT64_MAX : 0);
+        memcpy(record + i * size, &key, sizeof(key));
+        memcpy(record + i * size + sizeof(key), x__array_item(array, i), item_size);
+        for (int d = 0; d < 8; ++d) count[d][(key >> 8 * d) & 255] += 1;
+    }
+    uint64_t first;
+    memcpy(&first, record, sizeof(first));
+    char *data = record;
+    for (int d = 0; d < 8; ++d) {
+        if (count[d][(first >> 8 * d) & 255] == n) continue;
+        for (long b = 0, offset = 0; b < 256; ++b) {
+            const long _count = count[d][b];
+            count[d][b] = offset;
+            offset += _count;
+        }
+        char *dest = (data == record ? swap : record);
+        for (long i = 0; i < n; ++i) {
+            uint64_t key;
+            memcpy(&key, data + i * size, sizeof(key));
+            memcpy(dest + count[d][(key >> 8 * d) & 255]++ * size, data + i * size, size);
+        }
+        data = dest;
+    }
+    for (long i = 0; i < n; ++i)
+        memcpy(x__array_item(array, i), data + i * size + sizeof(uint64_t), item_size);
+    allocator_free(&array->alloc, record);
+}
+
 // remove all items from the array
 static void array_clear(Array *array)
 {
     assert(array);
-    if (array->size == 0) return;
+    if (!array->data) return;
     if (array->data_free)
-        for (long i = 0; i < array->size; ++i) array->data_free(array->item[i].data);
-    free(array->item);
+        for (long i = 0; i < array->size; ++i) array->data_free(x__array_data(array, i));
+    allocator_free(&array->alloc, array->data);
     *array = (Array){0};
 }
+
+// define a typed array `name` of items of type T, ordered by cmp(const T *, const T *); the
+// functions mirror the generic ones, but take and return items by value, and the item type and
+// comparison function are known at compile time, so they can be inlined
+#define ARRAY_DEFINE(name, T, cmp)                                                               \
+    typedef struct name name;                                                                    \
+    struct name {                                                                                \
+        long size, capacity;                                                                     \
+        Allocator alloc;                                                                         \
+        T *item;                                                                                 \
+    };                                                                                           \
+    [[maybe_unused]] static name name##_create(long capacity, const Allocator *alloc)            \
+    {                                                                                            \
+        assert(capacity >= 0);                                                                   \
+        return (name){.capacity = capacity, .alloc = (alloc ? *alloc : allocator_std)};          \
+    }                                                                                            \
+    [[maybe_unused]] static void x__##name##_resize_items(name *array)                           \
+    {                                                                                            \
+        array->capacity = 2 * array->capacity + 1;                                               \
+        array->item =                                                                            \
+            allocator_realloc(&array->alloc, array->item, array->capacity * sizeof(T));          \
+        assert(array->item);                                                                     \
+    }                                                                                            \
+    [[maybe_unused]] static void name##_insert(name *array, long i, T data)                      \
+    {                                                                                            \
+        assert(array);                                                                           \
+        assert(-array->size <= i && i <= array->size);                                           \
+        if (array->size + 1 > array->capacity || !array->item) x__##name##_resize_items(array);  \
+        if (i != array->size) i = (array->size + i) % array->size;                               \
+        memmove(array->item + i + 1, array->item + i, (array->size - i) * sizeof(T));            \
+        array->item[i] = data;                                                                   \
+        array->size += 1;                                                                        \
+    }                                                                                            \
+    [[maybe_unused]] static void name##_append(name *array, T data)                              \
+    {                                                                                            \
+        name##_insert(array, array->size, data);                                                 \
+    }                                                                                            \
+    [[maybe_unused]] static void name##_reserve(name *array, long capacity)                      \
+    {                                                                                            \
+        assert(array);                                                                           \
+        assert(capacity >= 0);                                                                   \
+        if (capacity <= array->capacity && (array->item || capacity == 0)) return;               \
+        if (capacity < array->capacity) capacity = array->capacity;                              \
+        array->item = allocator_realloc(&array->alloc, array->item, capacity * sizeof(T));       \
+        assert(array->item);                                                                     \
+        array->capacity = capacity;                                                              \
+    }                                                                                            \
+    [[maybe_unused]] static void name##_extend(name *array, const T *data, long count)           \
+    {                                                                                            \
+        assert(array);                                                                           \
+        assert(data || count == 0);                                                              \
+        assert(count >= 0);                                                                      \
+        if (count == 0) return;                                                                  \
+        long capacity = array->size + count;                                                     \
+        if (capacity > array->capacity && capacity < 2 * array->capacity + 1)                    \
+            capacity = 2 * array->capacity + 1;                                                  \
+        name##_reserve(array, capacity);                                                         \
+        memcpy(array->item + array->size, data, count * sizeof(T));                              \
+        array->size += count;                                                                    \
+    }                                                                                            \
+    [[maybe_unused]] static void name##_shrink_to_fit(name *array)                               \
+    {                                                                                            \
+        assert(array);                                                                           \
+        if (!array->item || array->capacity == array->size) return;                              \
+        if (array->size == 0) {                                                                  \
+            allocator_free(&array->alloc, array->item);                                          \
+            array->item = 0;                                                                     \
+            array->capacity = 0;                                                                 \
+            return;                                                                              \
+        }                                                                                        \
+        array->item = allocator_realloc(&array->alloc, array->item, array->size * sizeof(T));    \
+        assert(array->item);                                                                     \
+        array->capacity = array->size;                                                           \
+    }                                                                                            \
+    [[maybe_unused]] static name name##_copy(const name *array)                                  \
+    {                                                                                            \
+        assert(array);                                                                           \
+        name copy = name##_create(array->size, &array->alloc);                                   \
+        if (array->size == 0) return copy;                                                       \
+        copy.item = allocator_alloc(&copy.alloc, copy.capacity, sizeof(T), 0);                   \
+        assert(copy.item);                                                                       \
+        memcpy(copy.item, array->item, array->size * sizeof(T));                                 \
+        copy.size = array->size;                                                                 \
+        return copy;                                                                             \
+    }                                                                                            \
+    [[maybe_unused]] static T name##_pop(name *array, long i)                                    \
+    {                                                                                            \
+        assert(array);                                                                           \
+        assert(-array->size <= i && i < array->size);                                            \
+        i = (array->size + i) % array->size;                                                     \
+        T data = array->item[i];                                                                 \
+        memmove(array->item + i, array->item + i + 1, (array->size - i - 1) * sizeof(T));        \
+        array->size -= 1;                                                                        \
+        return data;                                                                             \
+    }                                                                                            \
+    [[maybe_unused]] static T name##_swap_remove(name *array, long i)                            \
+    {                                                                                            \
+        assert(array);                                                                           \
+        assert(-array->size <= i && i < array->size);                                            \
+        i = (array->size + i) % array->size;                                                     \
+        T data = array->item[i];                                                                 \
+        array->size -= 1;                                                                        \
+        array->item[i] = array->item[array->size];                                               \
+        return data;                                                                             \
+    }                                                                                            \
+    [[maybe_unused]] static long name##_index(const name *array, T data)                         \
+    {                                                                                            \
+        assert(array);                                                                           \
+        for (long i = 0; i < array->size; ++i)                                                   \
+            if (!cmp(&array->item[i], &data)) return i;                                          \
+        return -1;                                                                               \
+    }                                                                                            \
+    [[maybe_unused]] static T *name##_find(const name *array, T data)                            \
+    {                                                                                            \
+        const long i = name##_index(array, data);                                                \
+        return (i >= 0 ? &array->item[i] : 0);                                                   \
+    }                                                                                            \
+    [[maybe_unused]] static int name##_remove(name *array, T data)                               \
+    {                                                                                            \
+        const long i = name##_index(array, data);                                                \
+        if (i >= 0) name##_pop(array, i);                                                        \
+        return (i >= 0);                                                                         \
+    }                                                                                            \
+    [[maybe_unused]] static long name##_count(const name *array, T data)                         \
+    {                                                                                            \
+        assert(array);                                                                           \
+        long n = 0;                                                                              \
+        for (long i = 0; i < array->size; ++i)                                                   \
+            if (!cmp(&array->item[i], &data)) n += 1;                                            \
+        return n;                                                                                \
+    }                                                                                            \
+    [[maybe_unused]] static T x__##name##_median(const T *a, const T *b, const T *c, int order)  \
+    {                                                                                            \
+        if (order * cmp(a, b) < 0) {                                                             \
+            if (order * cmp(b, c) < 0) return *b;                                                \
+            return (order * cmp(a, c) < 0 ? *c : *a);                                            \
+        }                                                                                        \
+        if (order * cmp(a, c) < 0) return *a;                                                    \
+        return (order * cmp(b, c) < 0 ? *c : *b);                                                \
+    }                                                                                            \
+    [[maybe_unused]] static void x__##name##_sift_down(T *item, long root, long end, int order)  \
+    {                                                                                            \
+        for (long child; (child = 2 * root + 1) < end; root = child) {                           \
+            if (child + 1 < end && order * cmp(&item[child], &item[child + 1]) < 0) child += 1;  \
+            if (order * cmp(&item[root], &item[child]) >= 0) return;                             \
+            const T swap = item[root];                                                           \
+            item[root] = item[child];                                                            \
+            item[child] = swap;                                                                  \
+        }                                                                                        \
+    }                                                                                            \
+    [[maybe_unused]] static void x__##name##_heap_sort(T *item, long n, int order)               \
+    {                                                                                            \
+        for (long i = n / 2 - 1; i >= 0; --i) x__##name##_sift_down(item, i, n, order);          \
+        for (long end = n - 1; end > 0; --end) {                                                 \
+            const T swap = item[0];                                                              \
+            item[0] = item[end];                                                                 \
+            item[end] = swap;                                                                    \
+            x__##name##_sift_down(item, 0, end, order);                                          \
+        }                                                                                        \
+    }                                                                                            \
+    [[maybe_unused]] static void x__##name##_sort(T *item, long low, long high, int order,       \
+                                                  long depth)                                    \
+    {                                                                                            \
+        while (high - low > 16) {                                                                \
+            if (depth-- == 0) {                                                                  \
+                x__##name##_heap_sort(item + low, high - low + 1, order);                        \
+                return;                                                                          \
+            }                                                                                    \
+            const long mid = low + (high - low) / 2;                                             \
+            const T pivot = x__##name##_median(&item[low], &item[mid], &item[high], order);      \
+            long i = low, j = high;                                                              \
+            while (i <= j) {                                                                     \
+                while (order * cmp(&item[i], &pivot) < 0) i += 1;                                \
+                while (order * cmp(&item[j], &pivot) > 0) j -= 1;                                \
+                if (i <= j) {                                                                    \
+                    const T swap = item[i];                                                      \
+                    item[i++] = item[j];                                                         \
+                    item[j--] = swap;                                                            \
+                }                                                                                \
+            }                                                                                    \
+            if (j - low < high - i) {                                                            \
+                x__##name##_sort(item, low, j, order, depth);                                    \
+                low = i;                                                                         \
+            }                                                                                    \
+            else {                                                                               \
+                x__##name##_sort(item, i, high, order, depth);                                   \
+                high = j;                                                                        \
+            }                                                                                    \
+        }                                                                                        \
+        for (long i = low + 1; i <= high; ++i) {                                                 \
+            const T data = item[i];                                                              \
+            long j = i - 1;                                                                      \
+            for (; j >= low && order * cmp(&item[j], &data) > 0; --j) item[j + 1] = item[j];     \
+            item[j + 1] = data;                                                                  \
+        }                                                                                        \
+    }                                                                                            \
+    [[maybe_unused]] static void name##_sort(name *array, int reverse)                           \
+    {                                                                                            \
+        assert(array);                                                                           \
+        if (array->size == 0) return;                                                            \
+        x__##name##_sort(array->item, 0, array->size - 1, (reverse ? -1 : 1),                    \
+                         x__array_sort_depth(array->size));                                      \
+    }                                                                                            \
+    [[maybe_unused]] static void name##_reverse(name *array)                                     \
+    {                                                                                            \
+        assert(array);                                                                           \
+        for (long i = 0, j = array->size - 1; i < j; ++i, --j) {                                 \
+            const T swap = array->item[i];                                                       \
+            array->item[i] = array->item[j];                                                     \
+            array->item[j] = swap;                                                               \
+        }                                                                                        \
+    }                                                                                            \
+    [[maybe_unused]] static void name##_clear(name *array)                                       \
+    {                                                                                            \
+        assert(array);                                                                           \
+        allocator_free(&array->alloc, array->item);                                              \
+        *array = (name){0};                                                                      \
+    }
+
+#define ArrayForEachTyped(item, array) \
+    for (typeof((array)->item) item = (array)->item; item < (array)->item + (array)->size; ++item)
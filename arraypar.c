@@ -0,0 +1,31 @@
+#include "arraypar.h"
+
+#include <stdio.h>
+
+// integer comparison function
+int intcmp(const void *a, const void *b)
+{
+    const int *ia = a, *ib = b;
+    return (*ia > *ib) - (*ia < *ib);
+}
+
+int main(void)
+{
+    // create a large flat array of pseudo-random integers, and sort it in reverse using 4 threads
+    Array a = array_create_full(100000, sizeof(int), intcmp, memcpy, 0, 0, ARRAY_FLAT);
+    for (int i = 0; i < 100000; ++i) array_append(&a, &(int){(i * 7919) % 100003});
+    array_sort_parallel(&a, 1, 4);
+    const int *data = a.data;
+    printf("a[0], a[1], a[-1] = %d, %d, %d\n", data[0], data[1], data[a.size - 1]);
+
+    // create a large array of pseudo-random integers, and sort it using 4 threads
+    Array b = array_create(100000, sizeof(int), intcmp);
+    for (int i = 0; i < 100000; ++i) array_append(&b, &(int){(i * 7919) % 100003});
+    array_sort_parallel(&b, 0, 4);
+    printf("b[0], b[1], b[-1] = %d, %d, %d\n", *(int *)b.item[0].data, *(int *)b.item[1].data,
+           *(int *)b.item[b.size - 1].data);
+
+    // clear items
+    array_clear(&a);
+    array_clear(&b);
+}
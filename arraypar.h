@@ -0,0 +1,65 @@
+#pragma once
+
+#include <assert.h>
+#include <pthread.h>
+
+#include "array.h"
+
+// parallel sort of the arrays of array.h; it lives in its own header, so that only the users of
+// array_sort_parallel depend on POSIX threads (this header needs -pthread)
+
+// ranges of at least this many items are split across threads
+enum { X__ARRAY_SORT_GRAIN = 1 << 15 };
+
+typedef struct {
+    const Array *array;
+    long low, high, depth;
+    int order, nthreads;
+} x__ArraySortTask;
+
+static void x__array_sort_parallel(const Array *array, long low, long high, int order, long depth,
+                                   int nthreads);
+
+static void *x__array_sort_thread(void *arg)
+{
+    const x__ArraySortTask *task = arg;
+    x__array_sort_parallel(task->array, task->low, task->high, task->order, task->depth,
+                           task->nthreads);
+    return 0;
+}
+
+// partition a range, and sort the upper part in a new thread while sorting the lower part in this
+// one; the threads are split in proportion to the sizes of the parts
+static void x__array_sort_parallel(const Array *array, long low, long high, int order, long depth,
+                                   int nthreads)
+{
+    if (nthreads < 2 || high - low + 1 < X__ARRAY_SORT_GRAIN || depth == 0) {
+        x__array_sort(array, low, high, order, depth);
+        return;
+    }
+    const long p = x__array_partition(array, low, high, order);
+    int _nthreads = (double)nthreads * (high - p) / (high - low + 1) + 0.5;
+    if (_nthreads < 1) _nthreads = 1;
+    if (_nthreads > nthreads - 1) _nthreads = nthreads - 1;
+    x__ArraySortTask task = {array, p + 1, high, depth - 1, order, _nthreads};
+    pthread_t thread;
+    const int error = pthread_create(&thread, 0, x__array_sort_thread, &task);
+    if (error) x__array_sort_thread(&task);
+    x__array_sort_parallel(array, low, p - 1, order, depth - 1, nthreads - _nthreads);
+    if (!error) pthread_join(thread, 0);
+}
+
+// sort the items of the array in place using up to nthreads threads
+static void array_sort_parallel(Array *array, int reverse, int nthreads)
+{
+    assert(array);
+    assert(array->data_cmp);
+    assert(nthreads > 0);
+    if (nthreads == 1) {
+        array_sort(array, reverse);
+        return;
+    }
+    if (array->size == 0) return;
+    x__array_sort_parallel(array, 0, array->size - 1, (reverse ? -1 : 1),
+                           x__array_sort_depth(array->size), nthreads);
+}
@@ -0,0 +1,1004 @@
+#include "bench.h"
+
+#include <unistd.h>
+
+#include "../arena.h"
+#include "../array.h"
+#include "../arraypar.h"
+#include "../btree.h"
+#include "../chmap.h"
+#include "../deque.h"
+#include "../dict.h"
+#include "../graph.h"
+#include "../hash.h"
+#include "../heap.h"
+#include "../hmap.h"
+#include "../list.h"
+#include "../mphf.h"
+#include "../pool.h"
+#include "../queue.h"
+#include "../set.h"
+#include "../varena.h"
+
+int cmp_long(const void *a, const void *b)
+{
+    const long la = *(const long *)a, lb = *(const long *)b;
+    return (la > lb) - (la < lb);
+}
+
+uint64_t key_long(const void *a)
+{
+    return array_key_long(*(const long *)a);
+}
+
+uint64_t hash_long(long a)
+{
+    return hash_mix(a);
+}
+
+int eq_long(long a, long b)
+{
+    return a == b;
+}
+
+// define typed containers of integers
+ARRAY_DEFINE(LongArray, long, cmp_long)
+HEAP_DEFINE(LongHeap, long)
+SET_DEFINE(LongSet, long, hash_long, eq_long)
+HMAP_DEFINE(LongMap, long, long, hash_long, eq_long)
+
+// inputs of the benchmarks, and the containers under test; every benchmark performs one operation
+// on each of count items per repetition
+typedef struct {
+    long count, key_size, key_count, block_size;
+    int flags;
+    long *number, *distance;
+    double *priority;
+    char *key_buffer;
+    const char **key;
+    void **block;
+    Array array;
+    LongArray long_array;
+    List list;
+    Deque deque;
+    Queue queue;
+    Heap heap;
+    LongHeap long_heap;
+    Set set;
+    LongSet long_set;
+    Dict dict;
+    Hmap hmap;
+    LongMap long_map;
+    Chmap chmap;
+    Fmap fmap;
+    Btree btree;
+    GraphBuilder builder;
+    Graph graph;
+    Arena arena;
+    Varena varena;
+    Pool pool;
+    uint64_t (*strhash)(const char *);
+    uint64_t (*memhash)(const void *, long);
+} Data;
+
+// create count distinct numbers in random order, and random priorities
+Data data_create(long count)
+{
+    Data data = {.count = count};
+    data.number = malloc(count * sizeof(*data.number));
+    data.priority = malloc(count * sizeof(*data.priority));
+    data.key = malloc(count * sizeof(*data.key));
+    data.block = malloc(count * sizeof(*data.block));
+    assert(data.number && data.priority && data.key && data.block);
+    for (long i = 0; i < count; ++i) {
+        data.number[i] = hash_mix(i + 1);
+        data.priority[i] = (hash_mix(~i) >> 11) * 0x1p-53;
+    }
+    return data;
+}
+
+// create count distinct keys of key_size characters; the first eight characters are hex digits of
+// a permutation of the index, and the remaining ones are letters that depend on the index
+void data_keys(Data *data, long key_size)
+{
+    assert(key_size >= 8);
+    data->key_size = key_size;
+    data->key_buffer = realloc(data->key_buffer, data->count * (key_size + 1));
+    assert(data->key_buffer);
+    for (long i = 0; i < data->count; ++i) {
+        char *key = data->key_buffer + i * (key_size + 1);
+        snprintf(key, 9, "%08x", (unsigned)(i * 2654435761u));
+        for (long j = 8; j < key_size; ++j) key[j] = 'a' + (data->number[i] >> j) % 26;
+        key[key_size] = 0;
+        data->key[i] = key;
+    }
+}
+
+void data_clear(Data *data)
+{
+    free(data->number);
+    free(data->priority);
+    free(data->key_buffer);
+    free(data->key);
+    free(data->block);
+    *data = (Data){0};
+}
+
+void array_empty(void *ctx)
+{
+    Data *data = ctx;
+    array_clear(&data->array);
+    const int flags = data->flags;
+    data->array =
+        array_create_full(0, sizeof(long), cmp_long, memcpy, (flags ? 0 : free), 0, flags);
+}
+
+void array_shuffled(void *ctx)
+{
+    Data *data = ctx;
+    array_empty(data);
+    array_extend(&data->array, data->number, data->count);
+}
+
+void run_array_append(void *ctx)
+{
+    Data *data = ctx;
+    for (long i = 0; i < data->count; ++i) array_append(&data->array, &data->number[i]);
+}
+
+void run_array_sort(void *ctx)
+{
+    Data *data = ctx;
+    array_sort(&data->array, 0);
+}
+
+// thread count of the parallel benchmarks
+enum { BENCH_THREADS = 4 };
+
+void run_array_sort_parallel(void *ctx)
+{
+    Data *data = ctx;
+    array_sort_parallel(&data->array, 0, BENCH_THREADS);
+}
+
+void run_array_sort_by_key(void *ctx)
+{
+    Data *data = ctx;
+    array_sort_by_key(&data->array, key_long, 0);
+}
+
+void long_array_empty(void *ctx)
+{
+    Data *data = ctx;
+    LongArray_clear(&data->long_array);
+    data->long_array = LongArray_create(0, 0);
+}
+
+void long_array_shuffled(void *ctx)
+{
+    Data *data = ctx;
+    long_array_empty(data);
+    LongArray_extend(&data->long_array, data->number, data->count);
+}
+
+void run_long_array_append(void *ctx)
+{
+    Data *data = ctx;
+    for (long i = 0; i < data->count; ++i) LongArray_append(&data->long_array, data->number[i]);
+}
+
+void run_long_array_sort(void *ctx)
+{
+    Data *data = ctx;
+    LongArray_sort(&data->long_array, 0);
+}
+
+void bench_array(Bench *bench, Data *data)
+{
+    const long n = data->count;
+    data->flags = 0;
+    bench_run(bench, "array/append/pointer", n, run_array_append, array_empty, data);
+    bench_run(bench, "array/sort/pointer", n, run_array_sort, array_shuffled, data);
+    bench_run(bench, "array/sort_parallel/pointer", n, run_array_sort_parallel, array_shuffled,
+              data);
+    data->flags = ARRAY_FLAT;
+    bench_run(bench, "array/append/flat", n, run_array_append, array_empty, data);
+    bench_run(bench, "array/sort/flat", n, run_array_sort, array_shuffled, data);
+    bench_run(bench, "array/sort_parallel/flat", n, run_array_sort_parallel, array_shuffled, data);
+    bench_run(bench, "array/sort_by_key/flat", n, run_array_sort_by_key, array_shuffled, data);
+    array_clear(&data->array);
+    data->long_array = LongArray_create(0, 0);
+    bench_run(bench, "array/append/typed", n, run_long_array_append, long_array_empty, data);
+    bench_run(bench, "array/sort/typed", n, run_long_array_sort, long_array_shuffled, data);
+    LongArray_clear(&data->long_array);
+}
+
+void list_empty(void *ctx)
+{
+    Data *data = ctx;
+    list_clear(&data->list);
+    const int flags = data->flags;
+    data->list = list_create_full(sizeof(long), cmp_long, memcpy, (flags ? 0 : free), 0, flags);
+}
+
+void list_shuffled(void *ctx)
+{
+    Data *data = ctx;
+    list_empty(data);
+    for (long i = 0; i < data->count; ++i) list_append(&data->list, &data->number[i]);
+}
+
+void run_list_append(void *ctx)
+{
+    Data *data = ctx;
+    for (long i = 0; i < data->count; ++i) list_append(&data->list, &data->number[i]);
+}
+
+void run_list_pop(void *ctx)
+{
+    Data *data = ctx;
+    uint64_t sum = 0;
+    for (long i = 0; i < data->count; ++i) {
+        long *number = list_pop(&data->list, 0);
+        sum += *number;
+        if (!(data->flags & LIST_POOL)) free(number);
+    }
+    bench_sink += sum;
+}
+
+void run_list_sort(void *ctx)
+{
+    Data *data = ctx;
+    list_sort(&data->list, 0);
+}
+
+void bench_list(Bench *bench, Data *data)
+{
+    const long n = data->count;
+    data->flags = 0;
+    bench_run(bench, "list/append/malloc", n, run_list_append, list_empty, data);
+    bench_run(bench, "list/pop/malloc", n, run_list_pop, list_shuffled, data);
+    bench_run(bench, "list/sort/malloc", n, run_list_sort, list_shuffled, data);
+    data->flags = LIST_POOL;
+    bench_run(bench, "list/append/pool", n, run_list_append, list_empty, data);
+    bench_run(bench, "list/pop/pool", n, run_list_pop, list_shuffled, data);
+    bench_run(bench, "list/sort/pool", n, run_list_sort, list_shuffled, data);
+    list_clear(&data->list);
+}
+
+void run_deque_push_pop(void *ctx)
+{
+    Data *data = ctx;
+    uint64_t sum = 0;
+    for (long i = 0; i < data->count; ++i) deque_push_back(&data->deque, &data->number[i]);
+    for (long i = 0; i < data->count; ++i) sum += *(long *)deque_pop_front(&data->deque);
+    bench_sink += sum;
+}
+
+void bench_deque(Bench *bench, Data *data)
+{
+    data->deque = deque_create_full(0, sizeof(long), memcpy, 0, 0, DEQUE_FLAT);
+    bench_run(bench, "deque/push_pop/flat", data->count, run_deque_push_pop, 0, data);
+    deque_clear(&data->deque);
+}
+
+// number of items that are pushed and popped at once by the batched queue benchmark
+enum { QUEUE_BATCH = 16 };
+
+void run_queue_push_pop(void *ctx)
+{
+    Data *data = ctx;
+    uint64_t sum = 0;
+    for (long i = 0; i < data->count; ++i) queue_push(&data->queue, &data->number[i]);
+    for (long i = 0; i < data->count; ++i) {
+        long number;
+        queue_pop(&data->queue, &number);
+        sum += number;
+    }
+    bench_sink += sum;
+}
+
+void run_queue_push_pop_many(void *ctx)
+{
+    Data *data = ctx;
+    uint64_t sum = 0;
+    for (long i = 0; i < data->count; i += QUEUE_BATCH) {
+        const long n = (data->count - i < QUEUE_BATCH ? data->count - i : QUEUE_BATCH);
+        queue_push_many(&data->queue, data->block + i, n);
+    }
+    for (long i = 0; i < data->count; i += QUEUE_BATCH) {
+        long number[QUEUE_BATCH];
+        const long n = queue_pop_many(&data->queue, number, QUEUE_BATCH);
+        for (long j = 0; j < n; ++j) sum += number[j];
+    }
+    bench_sink += sum;
+}
+
+// the queue is used by a single thread, so that only the cost of its atomic operations is timed
+void bench_queue(Bench *bench, Data *data)
+{
+    for (long i = 0; i < data->count; ++i) data->block[i] = &data->number[i];
+    data->queue = queue_create_full(data->count, sizeof(long), memcpy, 0, 0, QUEUE_FLAT);
+    bench_run(bench, "queue/push_pop/flat", data->count, run_queue_push_pop, 0, data);
+    bench_run(bench, "queue/push_pop_many/flat", data->count, run_queue_push_pop_many, 0, data);
+    queue_clear(&data->queue);
+}
+
+void run_heap_push_pop(void *ctx)
+{
+    Data *data = ctx;
+    uint64_t sum = 0;
+    for (long i = 0; i < data->count; ++i)
+        heap_push(&data->heap, data->priority[i], &data->number[i]);
+    for (long i = 0; i < data->count; ++i) {
+        long *number = heap_pop(&data->heap);
+        sum += *number;
+        if (!(data->heap.flags & HEAP_FLAT)) free(number);
+    }
+    bench_sink += sum;
+}
+
+void run_long_heap_push_pop(void *ctx)
+{
+    Data *data = ctx;
+    uint64_t sum = 0;
+    for (long i = 0; i < data->count; ++i)
+        LongHeap_push(&data->long_heap, data->priority[i], data->number[i]);
+    for (long i = 0; i < data->count; ++i) sum += LongHeap_pop(&data->long_heap);
+    bench_sink += sum;
+}
+
+void bench_heap(Bench *bench, Data *data)
+{
+    static const struct {
+        const char *name;
+        int flags;
+    } variant[] = {
+        {"heap/push_pop/pointer", 0},
+        {"heap/push_pop/flat", HEAP_FLAT},
+        {"heap/push_pop/flat_arity4", HEAP_FLAT | HEAP_ARITY_4},
+        {"heap/push_pop/flat_arity8", HEAP_FLAT | HEAP_ARITY_8},
+    };
+    for (long i = 0; i < (long)(sizeof(variant) / sizeof(*variant)); ++i) {
+        const int flags = variant[i].flags;
+        data->heap = heap_create_full(0, sizeof(long), memcpy, (flags ? 0 : free), 0, flags);
+        bench_run(bench, variant[i].name, data->count, run_heap_push_pop, 0, data);
+        heap_clear(&data->heap);
+    }
+    data->long_heap = LongHeap_create(0, 0);
+    bench_run(bench, "heap/push_pop/typed", data->count, run_long_heap_push_pop, 0, data);
+    LongHeap_clear(&data->long_heap);
+}
+
+void set_empty(void *ctx)
+{
+    Data *data = ctx;
+    set_clear(&data->set);
+    const int flags = data->flags;
+    data->set = set_create_full(0, sizeof(long), 0.75, memhash_wyhash, memcpy,
+                                (flags & SET_FLAT ? 0 : free), 0, flags);
+}
+
+void run_set_insert(void *ctx)
+{
+    Data *data = ctx;
+    for (long i = 0; i < data->count; ++i) set_insert(&data->set, &data->number[i], 0);
+}
+
+void set_full(void *ctx)
+{
+    Data *data = ctx;
+    if (data->set.size == data->count) return;
+    set_empty(data);
+    run_set_insert(data);
+}
+
+void run_set_find(void *ctx)
+{
+    Data *data = ctx;
+    uint64_t sum = 0;
+    for (long i = 0; i < data->count; ++i) sum += *(long *)set_find(&data->set, &data->number[i]);
+    bench_sink += sum;
+}
+
+void run_set_remove(void *ctx)
+{
+    Data *data = ctx;
+    for (long i = 0; i < data->count; ++i) {
+        long *number = set_remove(&data->set, &data->number[i]);
+        if (!(data->flags & SET_FLAT)) free(number);
+    }
+}
+
+void long_set_empty(void *ctx)
+{
+    Data *data = ctx;
+    LongSet_clear(&data->long_set);
+    data->long_set = LongSet_create(0, 0);
+}
+
+void run_long_set_insert(void *ctx)
+{
+    Data *data = ctx;
+    for (long i = 0; i < data->count; ++i) LongSet_insert(&data->long_set, data->number[i]);
+}
+
+void long_set_full(void *ctx)
+{
+    Data *data = ctx;
+    if (data->long_set.size == data->count) return;
+    long_set_empty(data);
+    run_long_set_insert(data);
+}
+
+void run_long_set_find(void *ctx)
+{
+    Data *data = ctx;
+    uint64_t sum = 0;
+    for (long i = 0; i < data->count; ++i)
+        sum += *LongSet_find(&data->long_set, data->number[i]);
+    bench_sink += sum;
+}
+
+void run_long_set_remove(void *ctx)
+{
+    Data *data = ctx;
+    for (long i = 0; i < data->count; ++i) LongSet_remove(&data->long_set, data->number[i]);
+}
+
+void bench_set(Bench *bench, Data *data)
+{
+    static const struct {
+        const char *name;
+        int flags;
+    } variant[] = {
+        {"pointer", 0},
+        {"flat", SET_FLAT},
+        {"flat_incremental", SET_FLAT | SET_INCREMENTAL},
+    };
+    const long n = data->count;
+    char name[X__BENCH_NAME];
+    for (long i = 0; i < (long)(sizeof(variant) / sizeof(*variant)); ++i) {
+        data->flags = variant[i].flags;
+        snprintf(name, sizeof(name), "set/insert/%s", variant[i].name);
+        bench_run(bench, name, n, run_set_insert, set_empty, data);
+        snprintf(name, sizeof(name), "set/find/%s", variant[i].name);
+        bench_run(bench, name, n, run_set_find, set_full, data);
+        snprintf(name, sizeof(name), "set/remove/%s", variant[i].name);
+        bench_run(bench, name, n, run_set_remove, set_full, data);
+        set_clear(&data->set);
+    }
+    data->long_set = LongSet_create(0, 0);
+    bench_run(bench, "set/insert/typed", n, run_long_set_insert, long_set_empty, data);
+    bench_run(bench, "set/find/typed", n, run_long_set_find, long_set_full, data);
+    bench_run(bench, "set/remove/typed", n, run_long_set_remove, long_set_full, data);
+    LongSet_clear(&data->long_set);
+}
+
+void dict_empty(void *ctx)
+{
+    Data *data = ctx;
+    dict_clear(&data->dict);
+    data->dict = dict_create_full(0, sizeof(long), 0.75, strhash_wyhash, memcpy, free, 0,
+                                  data->flags);
+}
+
+void run_dict_insert(void *ctx)
+{
+    Data *data = ctx;
+    for (long i = 0; i < data->count; ++i)
+        dict_insert(&data->dict, data->key[i], &data->number[i], 0);
+}
+
+void dict_full(void *ctx)
+{
+    Data *data = ctx;
+    if (data->dict.size == data->count) return;
+    dict_empty(data);
+    run_dict_insert(data);
+}
+
+void run_dict_find(void *ctx)
+{
+    Data *data = ctx;
+    uint64_t sum = 0;
+    for (long i = 0; i < data->count; ++i) sum += *(long *)dict_find(&data->dict, data->key[i]);
+    bench_sink += sum;
+}
+
+void run_dict_remove(void *ctx)
+{
+    Data *data = ctx;
+    for (long i = 0; i < data->count; ++i) free(dict_remove(&data->dict, data->key[i]));
+}
+
+void hmap_empty(void *ctx)
+{
+    Data *data = ctx;
+    hmap_clear(&data->hmap);
+    data->hmap = hmap_create_full(0, sizeof(long), 0.75, strhash_wyhash, memcpy, free, 0,
+                                  data->flags);
+}
+
+void run_hmap_insert(void *ctx)
+{
+    Data *data = ctx;
+    for (long i = 0; i < data->count; ++i)
+        hmap_insert(&data->hmap, data->key[i], &data->number[i], 0);
+}
+
+void hmap_full(void *ctx)
+{
+    Data *data = ctx;
+    if (data->hmap.size == data->count) return;
+    hmap_empty(data);
+    run_hmap_insert(data);
+}
+
+void run_hmap_find(void *ctx)
+{
+    Data *data = ctx;
+    uint64_t sum = 0;
+    for (long i = 0; i < data->count; ++i) sum += *(long *)hmap_find(&data->hmap, data->key[i]);
+    bench_sink += sum;
+}
+
+void run_hmap_remove(void *ctx)
+{
+    Data *data = ctx;
+    for (long i = 0; i < data->count; ++i) free(hmap_remove(&data->hmap, data->key[i]));
+}
+
+void run_fmap_find(void *ctx)
+{
+    Data *data = ctx;
+    uint64_t sum = 0;
+    for (long i = 0; i < data->count; ++i) sum += *(long *)fmap_find(&data->fmap, data->key[i]);
+    bench_sink += sum;
+}
+
+void chmap_empty(void *ctx)
+{
+    Data *data = ctx;
+    chmap_clear(&data->chmap);
+    data->chmap = chmap_create(0, sizeof(long));
+}
+
+void run_chmap_insert(void *ctx)
+{
+    Data *data = ctx;
+    for (long i = 0; i < data->count; ++i)
+        chmap_insert(&data->chmap, data->key[i], &data->number[i], 0);
+}
+
+void chmap_full(void *ctx)
+{
+    Data *data = ctx;
+    if (chmap_size(&data->chmap) == data->count) return;
+    chmap_empty(data);
+    run_chmap_insert(data);
+}
+
+void run_chmap_find(void *ctx)
+{
+    Data *data = ctx;
+    uint64_t sum = 0;
+    for (long i = 0; i < data->count; ++i) {
+        long number;
+        chmap_find(&data->chmap, data->key[i], &number);
+        sum += number;
+    }
+    bench_sink += sum;
+}
+
+// compare the string maps (dict and hmap with their backends) with keys of a few lengths; the
+// frozen map and the sharded map are read and written by a single thread
+void bench_map(Bench *bench, Data *data)
+{
+    static const struct {
+        const char *name;
+        int flags;
+    } dict_variant[] = {{"dict", 0}, {"dict_pool", DICT_POOL}, {"dict_intern", DICT_INTERN}},
+      hmap_variant[] = {
+          {"hmap", 0},
+          {"hmap_swiss", HMAP_SWISS},
+          {"hmap_incremental", HMAP_INCREMENTAL},
+          {"hmap_intern", HMAP_INTERN},
+      };
+    static const long key_size[] = {8, 32};
+    const long n = data->count;
+    char name[X__BENCH_NAME];
+    for (long k = 0; k < (long)(sizeof(key_size) / sizeof(*key_size)); ++k) {
+        data_keys(data, key_size[k]);
+        for (long i = 0; i < (long)(sizeof(dict_variant) / sizeof(*dict_variant)); ++i) {
+            data->flags = dict_variant[i].flags;
+            snprintf(name, sizeof(name), "map/insert/%s/%ld", dict_variant[i].name, key_size[k]);
+            bench_run(bench, name, n, run_dict_insert, dict_empty, data);
+            snprintf(name, sizeof(name), "map/find/%s/%ld", dict_variant[i].name, key_size[k]);
+            bench_run(bench, name, n, run_dict_find, dict_full, data);
+            snprintf(name, sizeof(name), "map/remove/%s/%ld", dict_variant[i].name, key_size[k]);
+            bench_run(bench, name, n, run_dict_remove, dict_full, data);
+            dict_clear(&data->dict);
+        }
+        for (long i = 0; i < (long)(sizeof(hmap_variant) / sizeof(*hmap_variant)); ++i) {
+            data->flags = hmap_variant[i].flags;
+            snprintf(name, sizeof(name), "map/insert/%s/%ld", hmap_variant[i].name, key_size[k]);
+            bench_run(bench, name, n, run_hmap_insert, hmap_empty, data);
+            snprintf(name, sizeof(name), "map/find/%s/%ld", hmap_variant[i].name, key_size[k]);
+            bench_run(bench, name, n, run_hmap_find, hmap_full, data);
+            snprintf(name, sizeof(name), "map/remove/%s/%ld", hmap_variant[i].name, key_size[k]);
+            bench_run(bench, name, n, run_hmap_remove, hmap_full, data);
+            hmap_clear(&data->hmap);
+        }
+        snprintf(name, sizeof(name), "map/find/fmap/%ld", key_size[k]);
+        if (!bench->filter || strstr(name, bench->filter)) {
+            data->flags = 0;
+            hmap_full(data);
+            data->fmap = fmap_create(&data->hmap);
+            hmap_clear(&data->hmap);
+            bench_run(bench, name, n, run_fmap_find, 0, data);
+            fmap_clear(&data->fmap);
+        }
+        snprintf(name, sizeof(name), "map/insert/chmap/%ld", key_size[k]);
+        bench_run(bench, name, n, run_chmap_insert, chmap_empty, data);
+        snprintf(name, sizeof(name), "map/find/chmap/%ld", key_size[k]);
+        bench_run(bench, name, n, run_chmap_find, chmap_full, data);
+        chmap_clear(&data->chmap);
+    }
+}
+
+void hmap_long_empty(void *ctx)
+{
+    Data *data = ctx;
+    hmap_clear(&data->hmap);
+    data->hmap = hmap_create_mem_full(0, sizeof(long), 0.75, memhash_wyhash, memcpy, free, 0,
+                                      data->flags);
+}
+
+void run_hmap_long_insert(void *ctx)
+{
+    Data *data = ctx;
+    for (long i = 0; i < data->count; ++i) {
+        const char *key = (const char *)&data->number[i];
+        hmap_insert_len(&data->hmap, key, sizeof(long), &data->number[i], 0);
+    }
+}
+
+void hmap_long_full(void *ctx)
+{
+    Data *data = ctx;
+    if (data->hmap.size == data->count) return;
+    hmap_long_empty(data);
+    run_hmap_long_insert(data);
+}
+
+void run_hmap_long_find(void *ctx)
+{
+    Data *data = ctx;
+    uint64_t sum = 0;
+    for (long i = 0; i < data->count; ++i) {
+        const char *key = (const char *)&data->number[i];
+        sum += *(long *)hmap_find_len(&data->hmap, key, sizeof(long));
+    }
+    bench_sink += sum;
+}
+
+void long_map_empty(void *ctx)
+{
+    Data *data = ctx;
+    LongMap_clear(&data->long_map);
+    data->long_map = LongMap_create(0, 0);
+}
+
+void run_long_map_insert(void *ctx)
+{
+    Data *data = ctx;
+    for (long i = 0; i < data->count; ++i)
+        LongMap_insert(&data->long_map, data->number[i], data->number[i], 0);
+}
+
+void long_map_full(void *ctx)
+{
+    Data *data = ctx;
+    if (data->long_map.size == data->count) return;
+    long_map_empty(data);
+    run_long_map_insert(data);
+}
+
+void run_long_map_find(void *ctx)
+{
+    Data *data = ctx;
+    uint64_t sum = 0;
+    for (long i = 0; i < data->count; ++i) sum += *LongMap_find(&data->long_map, data->number[i]);
+    bench_sink += sum;
+}
+
+void btree_empty(void *ctx)
+{
+    Data *data = ctx;
+    btree_clear(&data->btree);
+    data->btree = btree_create_full(sizeof(long), sizeof(long), btree_cmp_long, memcpy, free, 0);
+}
+
+void run_btree_insert(void *ctx)
+{
+    Data *data = ctx;
+    for (long i = 0; i < data->count; ++i)
+        btree_insert(&data->btree, &data->number[i], &data->number[i], 0);
+}
+
+void btree_full(void *ctx)
+{
+    Data *data = ctx;
+    if (data->btree.size == data->count) return;
+    btree_empty(data);
+    run_btree_insert(data);
+}
+
+void run_btree_find(void *ctx)
+{
+    Data *data = ctx;
+    uint64_t sum = 0;
+    for (long i = 0; i < data->count; ++i)
+        sum += *(long *)btree_find(&data->btree, &data->number[i]);
+    bench_sink += sum;
+}
+
+void run_btree_scan(void *ctx)
+{
+    Data *data = ctx;
+    uint64_t sum = 0;
+    BtreeForEach(cursor, &data->btree) sum += *(long *)btree_cursor_data(&cursor);
+    bench_sink += sum;
+}
+
+void run_btree_remove(void *ctx)
+{
+    Data *data = ctx;
+    for (long i = 0; i < data->count; ++i) free(btree_remove(&data->btree, &data->number[i]));
+}
+
+// compare the maps with integer keys: binary keys in a hmap, a typed hmap, and a B+ tree
+void bench_map_long(Bench *bench, Data *data)
+{
+    const long n = data->count;
+    data->flags = 0;
+    bench_run(bench, "map_long/insert/hmap", n, run_hmap_long_insert, hmap_long_empty, data);
+    bench_run(bench, "map_long/find/hmap", n, run_hmap_long_find, hmap_long_full, data);
+    hmap_clear(&data->hmap);
+    data->long_map = LongMap_create(0, 0);
+    bench_run(bench, "map_long/insert/typed", n, run_long_map_insert, long_map_empty, data);
+    bench_run(bench, "map_long/find/typed", n, run_long_map_find, long_map_full, data);
+    LongMap_clear(&data->long_map);
+    bench_run(bench, "map_long/insert/btree", n, run_btree_insert, btree_empty, data);
+    bench_run(bench, "map_long/find/btree", n, run_btree_find, btree_full, data);
+    bench_run(bench, "map_long/scan/btree", n, run_btree_scan, btree_full, data);
+    bench_run(bench, "map_long/remove/btree", n, run_btree_remove, btree_full, data);
+    btree_clear(&data->btree);
+}
+
+// out-degree of the vertices of the benchmark graph, whose edges lead to random vertices
+enum { GRAPH_DEGREE = 8 };
+
+void graph_empty(void *ctx)
+{
+    Data *data = ctx;
+    graph_clear(&data->graph);
+}
+
+void run_graph_build(void *ctx)
+{
+    Data *data = ctx;
+    data->graph = graph_build(&data->builder, 0);
+}
+
+void run_graph_bfs(void *ctx)
+{
+    Data *data = ctx;
+    bench_sink += graph_bfs(&data->graph, 0, data->distance, 1);
+}
+
+void run_graph_bfs_parallel(void *ctx)
+{
+    Data *data = ctx;
+    bench_sink += graph_bfs(&data->graph, 0, data->distance, BENCH_THREADS);
+}
+
+void bench_graph(Bench *bench, Data *data)
+{
+    const long n = data->count;
+    data->builder = graph_builder_create(n, n * GRAPH_DEGREE, 0);
+    for (long i = 0; i < n; ++i)
+        for (long j = 0; j < GRAPH_DEGREE; ++j)
+            graph_add_edge(&data->builder, i, hash_mix(i * GRAPH_DEGREE + j) % n, 1);
+    bench_run(bench, "graph/build/directed", n * GRAPH_DEGREE, run_graph_build, graph_empty, data);
+    data->distance = malloc(n * sizeof(*data->distance));
+    assert(data->distance);
+    bench_run(bench, "graph/bfs/directed", n, run_graph_bfs, 0, data);
+    bench_run(bench, "graph/bfs_parallel/directed", n, run_graph_bfs_parallel, 0, data);
+    free(data->distance);
+    data->distance = 0;
+    graph_clear(&data->graph);
+    graph_builder_clear(&data->builder);
+}
+
+void run_malloc(void *ctx)
+{
+    Data *data = ctx;
+    for (long i = 0; i < data->count; ++i) data->block[i] = malloc(data->block_size);
+    for (long i = 0; i < data->count; ++i) free(data->block[i]);
+}
+
+void run_arena(void *ctx)
+{
+    Data *data = ctx;
+    const Arena save = arena_save(&data->arena);
+    for (long i = 0; i < data->count; ++i)
+        data->block[i] = arena_alloc(&data->arena, 1, data->block_size, alignof(max_align_t), 0);
+    arena_restore(&data->arena, save);
+}
+
+void run_varena(void *ctx)
+{
+    Data *data = ctx;
+    const Varena save = varena_save(&data->varena);
+    for (long i = 0; i < data->count; ++i)
+        data->block[i] = varena_alloc(&data->varena, 1, data->block_size, alignof(max_align_t), 0);
+    varena_restore(&data->varena, save);
+}
+
+void run_pool(void *ctx)
+{
+    Data *data = ctx;
+    for (long i = 0; i < data->count; ++i) data->block[i] = pool_alloc(&data->pool, 0);
+    for (long i = 0; i < data->count; ++i) pool_free(&data->pool, data->block[i]);
+}
+
+// allocate count blocks of a few sizes, and release them again
+void bench_alloc(Bench *bench, Data *data)
+{
+    static const long block_size[] = {16, 64, 256};
+    const long n = data->count;
+    char name[X__BENCH_NAME];
+    for (long k = 0; k < (long)(sizeof(block_size) / sizeof(*block_size)); ++k) {
+        data->block_size = block_size[k];
+        snprintf(name, sizeof(name), "alloc/malloc/%ld", block_size[k]);
+        bench_run(bench, name, n, run_malloc, 0, data);
+        data->arena = arena_create(n * block_size[k]);
+        snprintf(name, sizeof(name), "alloc/arena/%ld", block_size[k]);
+        bench_run(bench, name, n, run_arena, 0, data);
+        arena_clear(&data->arena);
+        data->varena = varena_create(n * block_size[k]);
+        snprintf(name, sizeof(name), "alloc/varena/%ld", block_size[k]);
+        bench_run(bench, name, n, run_varena, 0, data);
+        varena_clear(&data->varena);
+        data->pool = pool_create(block_size[k], 256, 0);
+        snprintf(name, sizeof(name), "alloc/pool/%ld", block_size[k]);
+        bench_run(bench, name, n, run_pool, 0, data);
+        pool_clear(&data->pool);
+    }
+}
+
+// the keys of the hash functions fit into the L2 cache, so that only the hashing is timed
+enum { HASH_BUFFER = 1 << 16 };
+
+void run_strhash(void *ctx)
+{
+    Data *data = ctx;
+    uint64_t sum = 0;
+    for (long i = 0; i < data->count; ++i) sum += data->strhash(data->key[i % data->key_count]);
+    bench_sink += sum;
+}
+
+void run_memhash(void *ctx)
+{
+    Data *data = ctx;
+    uint64_t sum = 0;
+    for (long i = 0; i < data->count; ++i)
+        sum += data->memhash(data->key[i % data->key_count], data->key_size);
+    bench_sink += sum;
+}
+
+void bench_hash(Bench *bench, Data *data)
+{
+    static const struct {
+        const char *name;
+        uint64_t (*strhash)(const char *);
+        uint64_t (*memhash)(const void *, long);
+    } function[] = {
+        {"fnv1a", strhash_fnv1a, memhash_fnv1a},
+        {"djb2", strhash_djb2, memhash_djb2},
+        {"sdbm", strhash_sdbm, memhash_sdbm},
+        {"wyhash", strhash_wyhash, memhash_wyhash},
+    };
+    static const long key_size[] = {4, 16, 64, 256, 1024};
+    char *buffer = malloc(HASH_BUFFER);
+    assert(buffer);
+    char name[X__BENCH_NAME];
+    for (long k = 0; k < (long)(sizeof(key_size) / sizeof(*key_size)); ++k) {
+        const long keys = HASH_BUFFER / (key_size[k] + 1);
+        data->key_size = key_size[k];
+        data->key_count = (keys < data->count ? keys : data->count);
+        for (long i = 0; i < data->key_count; ++i) {
+            char *key = buffer + i * (key_size[k] + 1);
+            for (long j = 0; j < key_size[k]; ++j)
+                key[j] = 'a' + hash_mix(i * key_size[k] + j) % 26;
+            key[key_size[k]] = 0;
+            data->key[i] = key;
+        }
+        for (long i = 0; i < (long)(sizeof(function) / sizeof(*function)); ++i) {
+            data->strhash = function[i].strhash;
+            data->memhash = function[i].memhash;
+            snprintf(name, sizeof(name), "hash/strhash_%s/%ld", function[i].name, key_size[k]);
+            bench_run(bench, name, data->count, run_strhash, 0, data);
+            snprintf(name, sizeof(name), "hash/memhash_%s/%ld", function[i].name, key_size[k]);
+            bench_run(bench, name, data->count, run_memhash, 0, data);
+        }
+    }
+    free(buffer);
+}
+
+void usage(const char *program)
+{
+    fprintf(stderr,
+            "usage: %s [-n count] [-w warmup] [-r repeat] [-f text|csv|json] [-c baseline.csv]\n"
+            "       [-t threshold] [filter]\n"
+            "  -n  operations per repetition (default 262144)\n"
+            "  -w  untimed warmup repetitions (default 2)\n"
+            "  -r  timed repetitions (default 11)\n"
+            "  -f  report format (default text)\n"
+            "  -c  compare against the CSV report of an earlier run, and fail on regressions\n"
+            "  -t  slowdown of the median that counts as regression (default 0.1)\n"
+            "  only the benchmarks whose name contains the filter are run\n",
+            program);
+}
+
+int main(int argc, char **argv)
+{
+    long count = 1 << 18;
+    int warmup = 2, repeat = 11, format = BENCH_TEXT;
+    const char *baseline = 0;
+    double threshold = 0.1;
+    for (int opt; (opt = getopt(argc, argv, "n:w:r:f:c:t:h")) != -1;) {
+        switch (opt) {
+            case 'n': count = atol(optarg); break;
+            case 'w': warmup = atoi(optarg); break;
+            case 'r': repeat = atoi(optarg); break;
+            case 'f':
+                format = (!strcmp(optarg, "csv")    ? BENCH_CSV
+                          : !strcmp(optarg, "json") ? BENCH_JSON
+                          : !strcmp(optarg, "text") ? BENCH_TEXT
+                                                    : -1);
+                break;
+            case 'c': baseline = optarg; break;
+            case 't': threshold = atof(optarg); break;
+            default: usage(argv[0]); return EXIT_FAILURE;
+        }
+    }
+    if (count < 1 || warmup < 0 || repeat < 1 || format < 0 || threshold < 0 || argc - optind > 1) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    Bench bench = bench_create(warmup, repeat, format, argv[optind], stdout);
+    if (baseline && !bench_compare(&bench, baseline, threshold)) {
+        fprintf(stderr, "%s: cannot read baseline %s\n", argv[0], baseline);
+        return EXIT_FAILURE;
+    }
+
+    Data data = data_create(count);
+    bench_array(&bench, &data);
+    bench_list(&bench, &data);
+    bench_deque(&bench, &data);
+    bench_queue(&bench, &data);
+    bench_heap(&bench, &data);
+    bench_set(&bench, &data);
+    bench_map(&bench, &data);
+    bench_map_long(&bench, &data);
+    bench_graph(&bench, &data);
+    bench_alloc(&bench, &data);
+    bench_hash(&bench, &data);
+    data_clear(&data);
+
+    return (bench_finish(&bench) ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -0,0 +1,208 @@
+#pragma once
+
+// the monotonic clock is part of POSIX, not of standard C, so that this header needs
+// -D_DEFAULT_SOURCE (or -std=gnu23) on glibc; the Makefile passes it in BENCHFLAGS
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// micro benchmark harness; a benchmark performs count operations per repetition, and is timed with
+// the monotonic clock over several repetitions, after a few untimed warmup repetitions; the times
+// are reported per operation (median, minimum, and maximum over the repetitions), and can be
+// compared against the results of an earlier run
+typedef struct Bench Bench;
+typedef struct BenchResult BenchResult;
+typedef void BenchRun(void *);
+
+// report formats: aligned text, comma-separated values (which can be read back as baseline), and
+// a JSON array of objects
+enum { BENCH_TEXT, BENCH_CSV, BENCH_JSON };
+
+// largest benchmark name
+enum { X__BENCH_NAME = 64 };
+
+struct Bench {
+    int warmup, repeat, format;
+    double threshold;
+    const char *filter;
+    FILE *file;
+    long count, regressions;
+    long baseline_size;
+    BenchResult *baseline;
+};
+
+// times in nanoseconds per operation
+struct BenchResult {
+    char name[X__BENCH_NAME];
+    long count;
+    double median, min, max;
+};
+
+// sink for results that would otherwise be optimized away
+static volatile uint64_t bench_sink = 0;
+
+// create a harness that reports to a file; a benchmark is only run if its name contains the filter
+// (if the filter is not 0)
+static Bench bench_create(int warmup, int repeat, int format, const char *filter, FILE *file)
+{
+    assert(warmup >= 0);
+    assert(repeat > 0);
+    assert(format == BENCH_TEXT || format == BENCH_CSV || format == BENCH_JSON);
+    assert(file);
+    return (Bench){
+        .warmup = warmup,
+        .repeat = repeat,
+        .format = format,
+        .threshold = 0.1,
+        .filter = filter,
+        .file = file,
+    };
+}
+
+// read the results of an earlier run in CSV format; afterwards, every result is compared against
+// the baseline result of the same name, and a median that is slower by more than the threshold
+// (a fraction of the baseline median) counts as regression; return whether the file was read
+static int bench_compare(Bench *bench, const char *path, double threshold)
+{
+    assert(bench);
+    assert(path);
+    assert(threshold >= 0);
+    FILE *file = fopen(path, "r");
+    if (!file) return 0;
+    bench->threshold = threshold;
+    char line[256];
+    long capacity = 0;
+    while (fgets(line, sizeof(line), file)) {
+        BenchResult result = {0};
+        if (sscanf(line, "%63[^,],%ld,%lf,%lf,%lf", result.name, &result.count, &result.median,
+                   &result.min, &result.max) != 5)
+            continue;  // header or malformed line
+        if (bench->baseline_size == capacity) {
+            capacity = (capacity ? 2 * capacity : 64);
+            bench->baseline = realloc(bench->baseline, capacity * sizeof(*bench->baseline));
+            assert(bench->baseline);
+        }
+        bench->baseline[bench->baseline_size++] = result;
+    }
+    fclose(file);
+    return 1;
+}
+
+static double x__bench_now(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1e9 + time.tv_nsec;
+}
+
+static int x__bench_cmp(const void *a, const void *b)
+{
+    const double da = *(const double *)a, db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+static const BenchResult *x__bench_baseline(const Bench *bench, const char *name)
+{
+    for (long i = 0; i < bench->baseline_size; ++i)
+        if (!strcmp(bench->baseline[i].name, name)) return &bench->baseline[i];
+    return 0;
+}
+
+static void x__bench_report(Bench *bench, const BenchResult *result)
+{
+    const BenchResult *base = x__bench_baseline(bench, result->name);
+    const double change = (base ? result->median / base->median - 1 : 0);
+    const int regression = (base && change > bench->threshold);
+    bench->regressions += regression;
+    FILE *file = bench->file;
+    switch (bench->format) {
+        case BENCH_TEXT:
+            if (bench->count == 0)
+                fprintf(file, "%-40s %10s %12s %12s %12s%s\n", "name", "count", "median [ns]",
+                        "min [ns]", "max [ns]", (bench->baseline ? "       change" : ""));
+            fprintf(file, "%-40s %10ld %12.2f %12.2f %12.2f", result->name, result->count,
+                    result->median, result->min, result->max);
+            if (base)
+                fprintf(file, " %+12.1f%%%s", 100 * change, (regression ? " regression" : ""));
+            fprintf(file, "\n");
+            break;
+        case BENCH_CSV:
+            if (bench->count == 0)
+                fprintf(file, "name,count,median_ns,min_ns,max_ns%s\n",
+                        (bench->baseline ? ",baseline_ns,regression" : ""));
+            fprintf(file, "%s,%ld,%.3f,%.3f,%.3f", result->name, result->count, result->median,
+                    result->min, result->max);
+            if (base)
+                fprintf(file, ",%.3f,%d", base->median, regression);
+            else if (bench->baseline)
+                fprintf(file, ",,0");
+            fprintf(file, "\n");
+            break;
+        case BENCH_JSON:
+            fprintf(file, "%s\n  {\"name\": \"%s\", \"count\": %ld, ", (bench->count ? "," : "["),
+                    result->name, result->count);
+            fprintf(file, "\"median_ns\": %.3f, \"min_ns\": %.3f, \"max_ns\": %.3f",
+                    result->median, result->min, result->max);
+            if (base)
+                fprintf(file, ", \"baseline_ns\": %.3f, \"regression\": %s", base->median,
+                        (regression ? "true" : "false"));
+            fprintf(file, "}");
+            break;
+    }
+    fflush(file);
+    bench->count += 1;
+}
+
+// run a benchmark of count operations; setup is called before every repetition, and is not timed
+// (it may be 0); the median, the minimum, and the maximum are taken over the timed repetitions
+// (with the few repetitions of a run, a higher percentile than the median would just be the maximum)
+static void bench_run(Bench *bench, const char *name, long count, BenchRun *run, BenchRun *setup,
+                      void *ctx)
+{
+    assert(bench);
+    assert(name && strlen(name) < X__BENCH_NAME);
+    assert(count > 0);
+    assert(run);
+    if (bench->filter && !strstr(name, bench->filter)) return;
+    for (int i = 0; i < bench->warmup; ++i) {
+        if (setup) setup(ctx);
+        run(ctx);
+    }
+    double *time = malloc(bench->repeat * sizeof(*time));
+    assert(time);
+    for (int i = 0; i < bench->repeat; ++i) {
+        if (setup) setup(ctx);
+        const double start = x__bench_now();
+        run(ctx);
+        time[i] = (x__bench_now() - start) / count;
+    }
+    qsort(time, bench->repeat, sizeof(*time), x__bench_cmp);
+    const int half = bench->repeat / 2;
+    BenchResult result = {
+        .count = count,
+        .median = (bench->repeat % 2 ? time[half] : (time[half - 1] + time[half]) / 2),
+        .min = time[0],
+        .max = time[bench->repeat - 1],
+    };
+    strcpy(result.name, name);
+    free(time);
+    x__bench_report(bench, &result);
+}
+
+// finish the report, and return the number of regressions against the baseline
+static long bench_finish(Bench *bench)
+{
+    assert(bench);
+    if (bench->format == BENCH_JSON) fprintf(bench->file, "%s\n", (bench->count ? "\n]" : "[]"));
+    if (bench->baseline)
+        fprintf(stderr, "%ld of %ld benchmarks regressed by more than %.0f%%\n", bench->regressions,
+                bench->count, 100 * bench->threshold);
+    const long regressions = bench->regressions;
+    free(bench->baseline);
+    *bench = (Bench){0};
+    return regressions;
+}
@@ -0,0 +1,50 @@
+#include "btree.h"
+
+#include <stdio.h>
+
+int main(void)
+{
+    // create a tree that maps integer keys to integers
+    Btree a = btree_create(sizeof(long), sizeof(long), btree_cmp_long);
+
+    // insert the squares of the keys 0 through 99, in a scrambled order
+    for (long i = 0; i < 100; ++i) {
+        long key = (37 * i) % 100, square = key * key;
+        btree_insert(&a, &key, &square, 0);
+    }
+
+    // remove the items with odd keys
+    for (long key = 1; key < 100; key += 2) free(btree_remove(&a, &key));
+
+    // print the data of the item with key 42, and of the removed item with key 43
+    printf("a.find(42) = %ld\n", *(long *)btree_find(&a, (long[]){42}));
+    printf("a.find(43) = %p\n", btree_find(&a, (long[]){43}));
+
+    // print the items with keys from 20 (inclusive) up to 30 (exclusive)
+    printf("a[20:30] = {");
+    const long last = 30;
+    for (BtreeCursor cursor = btree_lower_bound(&a, (long[]){20});
+         cursor.node && btree_cmp_long(btree_cursor_key(&cursor), &last) < 0;
+         btree_cursor_next(&cursor))
+        printf("%ld: %ld, ", *(const long *)btree_cursor_key(&cursor),
+               *(long *)btree_cursor_data(&cursor));
+    printf("}\n");
+
+    // print the first key after 90
+    const BtreeCursor upper = btree_upper_bound(&a, (long[]){90});
+    printf("a.upper_bound(90) = %ld\n", *(const long *)btree_cursor_key(&upper));
+
+    // create a tree of string keys without data; the keys are pointers to string literals
+    Btree b = btree_create_full(sizeof(char *), 0, btree_cmp_str, 0, 0, 0);
+    const char *word[] = {"pear", "apple", "fig", "kiwi", "banana", "cherry"};
+    for (long i = 0; i < 6; ++i) btree_insert(&b, &word[i], 0, 0);
+
+    // print the keys of tree b in order
+    printf("b = {");
+    BtreeForEach(cursor, &b) printf("%s, ", *(const char *const *)btree_cursor_key(&cursor));
+    printf("}\n");
+
+    // free memory
+    btree_clear(&a);
+    btree_clear(&b);
+}
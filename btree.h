@@ -0,0 +1,464 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "pool.h"
+
+// ordered associative array using a B+ tree, whose nodes store their keys inline; the items are
+// stored in the leaves, which are linked in key order; keys have a fixed size and are ordered by
+// a comparison function (string keys are stored as pointers, see btree_cmp_str)
+typedef struct Btree Btree;
+typedef struct BtreeNode BtreeNode;
+typedef struct BtreeCursor BtreeCursor;
+typedef int BtreeKeyCompare(const void *, const void *);
+typedef void *BtreeDataCopy(void *, const void *, size_t);
+typedef void BtreeDataFree(void *);
+
+// a node spans eight cache lines, which hold 30 keys of 8 bytes with their data or children; the
+// nodes are blocks of a pool, which allocates X__BTREE_POOL_COUNT nodes per slab
+enum { X__BTREE_NODE = 512, X__BTREE_POOL_COUNT = 256 };
+
+// largest key size, such that every node holds at least eight keys
+enum { X__BTREE_KEY = 48 };
+
+struct Btree {
+    long size, key_size, data_size, height;
+    long leaf_capacity, inner_capacity, leaf_offset, inner_offset;
+    BtreeKeyCompare *key_cmp;
+    BtreeDataCopy *data_copy;
+    BtreeDataFree *data_free;
+    Allocator alloc;
+    BtreeNode *root;
+    Pool pool;
+};
+
+// a leaf stores count keys followed by their data at leaf_offset, and links to the next leaf; an
+// inner node stores count keys followed by count + 1 children at inner_offset, where the subtree
+// of child i holds the keys from key i - 1 (inclusive) up to key i (exclusive)
+struct BtreeNode {
+    long count;
+    BtreeNode *next;
+    alignas(max_align_t) char slot[];
+};
+
+// position of an item in a leaf; the cursor is past the last item once its node is 0
+struct BtreeCursor {
+    const Btree *tree;
+    BtreeNode *node;
+    long index;
+};
+
+// iterate over the items in key order; the tree must not be modified during the iteration
+#define BtreeForEach(cursor, tree) \
+    for (BtreeCursor cursor = btree_first(tree); cursor.node; btree_cursor_next(&cursor))
+
+// compare keys of type long
+static int btree_cmp_long(const void *a, const void *b)
+{
+    long la, lb;
+    memcpy(&la, a, sizeof(la));
+    memcpy(&lb, b, sizeof(lb));
+    return (la > lb) - (la < lb);
+}
+
+// compare keys of type const char *; the strings are not copied, and must outlive the tree (an
+// arena is a good place for them)
+static int btree_cmp_str(const void *a, const void *b)
+{
+    const char *sa, *sb;
+    memcpy(&sa, a, sizeof(sa));
+    memcpy(&sb, b, sizeof(sb));
+    return strcmp(sa, sb);
+}
+
+// return the offset of the pointers behind count keys of a given size
+static long x__btree_offset(long count, long key_size)
+{
+    const long align = alignof(void *);
+    return (count * key_size + align - 1) / align * align;
+}
+
+// create an empty tree of items with keys of key_size bytes
+static Btree btree_create_full(long key_size, long data_size, BtreeKeyCompare *key_cmp,
+                               BtreeDataCopy *data_copy, BtreeDataFree *data_free,
+                               const Allocator *alloc)
+{
+    assert(0 < key_size && key_size <= X__BTREE_KEY);
+    assert(data_size >= 0);
+    assert(key_cmp);
+    const long slots = X__BTREE_NODE - offsetof(BtreeNode, slot);
+    long leaf_capacity = slots / key_size, inner_capacity = leaf_capacity;
+    while (x__btree_offset(leaf_capacity, key_size) + leaf_capacity * (long)sizeof(void *) > slots)
+        leaf_capacity -= 1;
+    while (x__btree_offset(inner_capacity, key_size) + (inner_capacity + 1) * (long)sizeof(void *) >
+           slots)
+        inner_capacity -= 1;
+    Btree tree = {
+        .key_size = key_size,
+        .data_size = data_size,
+        .leaf_capacity = leaf_capacity,
+        .inner_capacity = inner_capacity,
+        .leaf_offset = x__btree_offset(leaf_capacity, key_size),
+        .inner_offset = x__btree_offset(inner_capacity, key_size),
+        .key_cmp = key_cmp,
+        .data_copy = data_copy,
+        .data_free = data_free,
+        .alloc = (alloc ? *alloc : allocator_std),
+    };
+    tree.pool = pool_create(X__BTREE_NODE, X__BTREE_POOL_COUNT, &tree.alloc);
+    return tree;
+}
+static Btree btree_create(long key_size, long data_size, BtreeKeyCompare *key_cmp)
+{
+    return btree_create_full(key_size, data_size, key_cmp, memcpy, free, 0);
+}
+
+static BtreeNode *x__btree_node_create(Btree *tree)
+{
+    BtreeNode *node = pool_alloc(&tree->pool, 0);
+    node->count = 0;
+    node->next = 0;
+    return node;
+}
+
+static char *x__btree_key(const Btree *tree, const BtreeNode *node, long i)
+{
+    return (char *)node->slot + i * tree->key_size;
+}
+
+static void **x__btree_data(const Btree *tree, BtreeNode *node)
+{
+    return (void **)(node->slot + tree->leaf_offset);
+}
+
+static BtreeNode **x__btree_child(const Btree *tree, BtreeNode *node)
+{
+    return (BtreeNode **)(node->slot + tree->inner_offset);
+}
+
+// return the position of the first key of a node that is not less than key (or that is greater
+// than key if upper is set)
+static long x__btree_bound(const Btree *tree, const BtreeNode *node, const void *key, int upper)
+{
+    long low = 0, high = node->count;
+    while (low < high) {
+        const long mid = (low + high) / 2;
+        const int cmp = tree->key_cmp(x__btree_key(tree, node, mid), key);
+        if (cmp < 0 || (upper && cmp == 0))
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+// move count keys (and their pointers) of a node from position src to position dst; an inner node
+// moves the children that follow the keys, and shift is 1 (or 0 for the children that precede them)
+static void x__btree_move(const Btree *tree, BtreeNode *dst_node, long dst, BtreeNode *src_node,
+                          long src, long count, int shift)
+{
+    memmove(x__btree_key(tree, dst_node, dst), x__btree_key(tree, src_node, src),
+            count * tree->key_size);
+    void **dst_ptr = (shift < 0 ? x__btree_data(tree, dst_node)
+                                : (void **)x__btree_child(tree, dst_node) + shift);
+    void **src_ptr = (shift < 0 ? x__btree_data(tree, src_node)
+                                : (void **)x__btree_child(tree, src_node) + shift);
+    memmove(dst_ptr + dst, src_ptr + src, count * sizeof(void *));
+}
+
+// insert a key and its data (or the child that follows it) at position i of a node with room
+static void x__btree_node_insert(const Btree *tree, BtreeNode *node, long i, const void *key,
+                                 void *ptr, int leaf)
+{
+    const int shift = (leaf ? -1 : 1);
+    x__btree_move(tree, node, i + 1, node, i, node->count - i, shift);
+    memcpy(x__btree_key(tree, node, i), key, tree->key_size);
+    if (leaf)
+        x__btree_data(tree, node)[i] = ptr;
+    else
+        x__btree_child(tree, node)[i + 1] = ptr;
+    node->count += 1;
+}
+
+// remove the key and the data (or the child that follows it) at position i of a node
+static void x__btree_node_delete(const Btree *tree, BtreeNode *node, long i, int leaf)
+{
+    x__btree_move(tree, node, i, node, i + 1, node->count - i - 1, (leaf ? -1 : 1));
+    node->count -= 1;
+}
+
+static void *x__btree_data_create(const Btree *tree, void *data)
+{
+    if (!data || !tree->data_copy) return data;
+    void *copy = allocator_alloc(&tree->alloc, 1, tree->data_size, 0);
+    assert(copy);
+    return tree->data_copy(copy, data, tree->data_size);
+}
+
+// insert an item into the subtree of a node at a given height (0 for leaves); return the new right
+// sibling of the node if it was split (and 0 otherwise), and store the first key of its subtree in
+// split; on collision, keep or replace data and store the old data in old
+static BtreeNode *x__btree_insert(Btree *tree, BtreeNode *node, long height, const void *key,
+                                  void *data, int keep, void **old, char *split)
+{
+    const int leaf = (height == 0);
+    long i = x__btree_bound(tree, node, key, !leaf);
+    void *ptr;
+    char child_split[X__BTREE_KEY];
+    if (leaf) {
+        if (i < node->count && !tree->key_cmp(x__btree_key(tree, node, i), key)) {
+            void **item_data = &x__btree_data(tree, node)[i];
+            *old = *item_data;
+            if (!keep) *item_data = data;
+            return 0;
+        }
+        ptr = x__btree_data_create(tree, data);
+        tree->size += 1;
+    }
+    else {
+        BtreeNode *child = x__btree_child(tree, node)[i];
+        ptr = x__btree_insert(tree, child, height - 1, key, data, keep, old, child_split);
+        if (!ptr) return 0;
+        key = child_split;
+    }
+    const long capacity = (leaf ? tree->leaf_capacity : tree->inner_capacity);
+    if (node->count < capacity) {
+        x__btree_node_insert(tree, node, i, key, ptr, leaf);
+        return 0;
+    }
+
+    // a full leaf keeps its first half, and the first key of the second half is copied to split;
+    // a full inner node keeps its first half, and the key between the halves moves to split
+    BtreeNode *right = x__btree_node_create(tree);
+    const long half = (leaf ? (capacity + 1) / 2 : capacity / 2);
+    if (leaf) {
+        x__btree_move(tree, right, 0, node, half, capacity - half, -1);
+        right->count = capacity - half;
+        right->next = node->next;
+        node->next = right;
+    }
+    else {
+        x__btree_move(tree, right, 0, node, half + 1, capacity - half - 1, 1);
+        x__btree_child(tree, right)[0] = x__btree_child(tree, node)[half + 1];
+        right->count = capacity - half - 1;
+    }
+    node->count = half;
+    if (!leaf) memcpy(split, x__btree_key(tree, node, half), tree->key_size);
+    if (i <= half)
+        x__btree_node_insert(tree, node, i, key, ptr, leaf);
+    else
+        x__btree_node_insert(tree, right, i - half - !leaf, key, ptr, leaf);
+    if (leaf) memcpy(split, x__btree_key(tree, right, 0), tree->key_size);
+    return right;
+}
+
+// insert an item with a given key; on collision, keep or replace data and return old data
+static void *btree_insert(Btree *tree, const void *key, void *data, int keep)
+{
+    assert(tree);
+    assert(key);
+    if (!tree->root) tree->root = x__btree_node_create(tree);
+    void *old = 0;
+    char split[X__BTREE_KEY];
+    BtreeNode *right =
+        x__btree_insert(tree, tree->root, tree->height, key, data, keep, &old, split);
+    if (right) {
+        BtreeNode *root = x__btree_node_create(tree);
+        memcpy(x__btree_key(tree, root, 0), split, tree->key_size);
+        x__btree_child(tree, root)[0] = tree->root;
+        x__btree_child(tree, root)[1] = right;
+        root->count = 1;
+        tree->root = root;
+        tree->height += 1;
+    }
+    return old;
+}
+
+// return the leaf whose keys range includes a given key
+static BtreeNode *x__btree_leaf(const Btree *tree, const void *key)
+{
+    BtreeNode *node = tree->root;
+    for (long height = tree->height; height > 0; --height)
+        node = x__btree_child(tree, node)[x__btree_bound(tree, node, key, 1)];
+    return node;
+}
+
+// return the data of an item with a given key
+static void *btree_find(const Btree *tree, const void *key)
+{
+    assert(tree);
+    assert(key);
+    if (tree->size == 0) return 0;
+    BtreeNode *leaf = x__btree_leaf(tree, key);
+    const long i = x__btree_bound(tree, leaf, key, 0);
+    if (i == leaf->count || tree->key_cmp(x__btree_key(tree, leaf, i), key)) return 0;
+    return x__btree_data(tree, leaf)[i];
+}
+
+// refill child i of an inner node at a given height, which has one key too few, from one of its
+// siblings, or merge it with one of them if they fit into one node
+static void x__btree_rebalance(Btree *tree, BtreeNode *node, long i, long height)
+{
+    const int leaf = (height == 0);
+    const long l = (i > 0 ? i - 1 : i);
+    BtreeNode **child = x__btree_child(tree, node), *left = child[l], *right = child[l + 1];
+    const long capacity = (leaf ? tree->leaf_capacity : tree->inner_capacity);
+    if (left->count + right->count + !leaf <= capacity) {
+        if (!leaf) {
+            memcpy(x__btree_key(tree, left, left->count), x__btree_key(tree, node, l),
+                   tree->key_size);
+            x__btree_child(tree, left)[left->count + 1] = x__btree_child(tree, right)[0];
+            left->count += 1;
+        }
+        x__btree_move(tree, left, left->count, right, 0, right->count, (leaf ? -1 : 1));
+        left->count += right->count;
+        left->next = right->next;
+        x__btree_node_delete(tree, node, l, 0);
+        pool_free(&tree->pool, right);
+    }
+    else if (i == l && leaf) {
+        x__btree_node_insert(tree, left, left->count, x__btree_key(tree, right, 0),
+                             x__btree_data(tree, right)[0], 1);
+        x__btree_node_delete(tree, right, 0, 1);
+        memcpy(x__btree_key(tree, node, l), x__btree_key(tree, right, 0), tree->key_size);
+    }
+    else if (leaf) {
+        const long last = left->count - 1;
+        x__btree_node_insert(tree, right, 0, x__btree_key(tree, left, last),
+                             x__btree_data(tree, left)[last], 1);
+        left->count -= 1;
+        memcpy(x__btree_key(tree, node, l), x__btree_key(tree, right, 0), tree->key_size);
+    }
+    else if (i == l) {
+        // rotate the first key of the right sibling through the parent
+        BtreeNode **right_child = x__btree_child(tree, right);
+        x__btree_node_insert(tree, left, left->count, x__btree_key(tree, node, l), right_child[0],
+                             0);
+        memcpy(x__btree_key(tree, node, l), x__btree_key(tree, right, 0), tree->key_size);
+        right_child[0] = right_child[1];
+        x__btree_node_delete(tree, right, 0, 0);
+    }
+    else {
+        // rotate the last key of the left sibling through the parent
+        BtreeNode **right_child = x__btree_child(tree, right);
+        const long last = left->count - 1;
+        x__btree_move(tree, right, 1, right, 0, right->count, 1);
+        right_child[1] = right_child[0];
+        right_child[0] = x__btree_child(tree, left)[last + 1];
+        memcpy(x__btree_key(tree, right, 0), x__btree_key(tree, node, l), tree->key_size);
+        right->count += 1;
+        memcpy(x__btree_key(tree, node, l), x__btree_key(tree, left, last), tree->key_size);
+        left->count -= 1;
+    }
+}
+
+// remove an item from the subtree of a node at a given height, store its data in data, and return
+// whether it was found
+static int x__btree_remove(Btree *tree, BtreeNode *node, long height, const void *key, void **data)
+{
+    if (height == 0) {
+        const long i = x__btree_bound(tree, node, key, 0);
+        if (i == node->count || tree->key_cmp(x__btree_key(tree, node, i), key)) return 0;
+        *data = x__btree_data(tree, node)[i];
+        x__btree_node_delete(tree, node, i, 1);
+        return 1;
+    }
+    const long i = x__btree_bound(tree, node, key, 1);
+    BtreeNode *child = x__btree_child(tree, node)[i];
+    if (!x__btree_remove(tree, child, height - 1, key, data)) return 0;
+    const long capacity = (height == 1 ? tree->leaf_capacity : tree->inner_capacity);
+    if (child->count < capacity / 2) x__btree_rebalance(tree, node, i, height - 1);
+    return 1;
+}
+
+// remove an item with a given key, and return its data
+static void *btree_remove(Btree *tree, const void *key)
+{
+    assert(tree);
+    assert(key);
+    if (tree->size == 0) return 0;
+    void *data = 0;
+    if (!x__btree_remove(tree, tree->root, tree->height, key, &data)) return 0;
+    tree->size -= 1;
+    if (tree->height > 0 && tree->root->count == 0) {
+        BtreeNode *root = tree->root;
+        tree->root = x__btree_child(tree, root)[0];
+        tree->height -= 1;
+        pool_free(&tree->pool, root);
+    }
+    return data;
+}
+
+// return a cursor at the first item
+static BtreeCursor btree_first(const Btree *tree)
+{
+    assert(tree);
+    BtreeNode *node = (tree->size > 0 ? tree->root : 0);
+    for (long height = tree->height; node && height > 0; --height)
+        node = x__btree_child(tree, node)[0];
+    return (BtreeCursor){tree, node, 0};
+}
+
+static BtreeCursor x__btree_bound_cursor(const Btree *tree, const void *key, int upper)
+{
+    if (tree->size == 0) return (BtreeCursor){tree, 0, 0};
+    BtreeCursor cursor = {tree, x__btree_leaf(tree, key), 0};
+    cursor.index = x__btree_bound(tree, cursor.node, key, upper);
+    if (cursor.index == cursor.node->count) {
+        cursor.node = cursor.node->next;
+        cursor.index = 0;
+    }
+    return cursor;
+}
+
+// return a cursor at the first item whose key is not less than a given key
+static BtreeCursor btree_lower_bound(const Btree *tree, const void *key)
+{
+    assert(tree);
+    assert(key);
+    return x__btree_bound_cursor(tree, key, 0);
+}
+
+// return a cursor at the first item whose key is greater than a given key
+static BtreeCursor btree_upper_bound(const Btree *tree, const void *key)
+{
+    assert(tree);
+    assert(key);
+    return x__btree_bound_cursor(tree, key, 1);
+}
+
+// advance a cursor to the next item, following the link to the next leaf at the end of a leaf
+static void btree_cursor_next(BtreeCursor *cursor)
+{
+    assert(cursor && cursor->node);
+    if (++cursor->index < cursor->node->count) return;
+    cursor->node = cursor->node->next;
+    cursor->index = 0;
+}
+
+// return the key of the item at a cursor
+static const void *btree_cursor_key(const BtreeCursor *cursor)
+{
+    assert(cursor && cursor->node);
+    return x__btree_key(cursor->tree, cursor->node, cursor->index);
+}
+
+// return the data of the item at a cursor
+static void *btree_cursor_data(const BtreeCursor *cursor)
+{
+    assert(cursor && cursor->node);
+    return x__btree_data(cursor->tree, cursor->node)[cursor->index];
+}
+
+// remove all items from the tree, and release all nodes at once
+static void btree_clear(Btree *tree)
+{
+    assert(tree);
+    if (tree->data_free) BtreeForEach(cursor, tree) tree->data_free(btree_cursor_data(&cursor));
+    pool_clear(&tree->pool);
+    *tree = (Btree){0};
+}
@@ -0,0 +1,71 @@
+#include "chmap.h"
+
+#include <stdio.h>
+
+enum { THREADS = 4, ITEMS = 1000 };
+
+typedef struct {
+    Chmap *chmap;
+    long first;
+    long found;
+} Work;
+
+// insert the items first through first + ITEMS - 1
+void *insert(void *arg)
+{
+    Work *work = arg;
+    for (long i = work->first; i < work->first + ITEMS; ++i) {
+        char key[32];
+        snprintf(key, sizeof(key), "%ld", i);
+        chmap_insert(work->chmap, key, &i, 0);
+    }
+    return 0;
+}
+
+// look up all items, including the ones of the other threads
+void *find(void *arg)
+{
+    Work *work = arg;
+    for (long i = 0; i < THREADS * ITEMS; ++i) {
+        char key[32];
+        snprintf(key, sizeof(key), "%ld", i);
+        long data;
+        if (chmap_find(work->chmap, key, &data) && data == i) work->found += 1;
+    }
+    return 0;
+}
+
+int main(void)
+{
+    // create a chmap that stores integers
+    Chmap a = chmap_create(THREADS * ITEMS, sizeof(long));
+
+    // insert integers 0 through THREADS * ITEMS - 1 from several threads at once
+    pthread_t thread[THREADS];
+    Work work[THREADS];
+    for (long i = 0; i < THREADS; ++i) {
+        work[i] = (Work){.chmap = &a, .first = i * ITEMS};
+        pthread_create(&thread[i], 0, insert, &work[i]);
+    }
+    for (long i = 0; i < THREADS; ++i) pthread_join(thread[i], 0);
+    printf("a.size = %ld\n", chmap_size(&a));
+
+    // look up all items from several threads at once
+    for (long i = 0; i < THREADS; ++i) pthread_create(&thread[i], 0, find, &work[i]);
+    for (long i = 0; i < THREADS; ++i) pthread_join(thread[i], 0);
+    for (long i = 0; i < THREADS; ++i) printf("thread %ld found %ld items\n", i, work[i].found);
+
+    // remove the item with key "6", and replace the data of the item with key "7"
+    free(chmap_remove(&a, "6"));
+    chmap_insert(&a, "7", &(long){70}, 0);
+
+    // print the items with keys "0" through "9"
+    printf("a = {");
+    ChmapForEach(item, &a) {
+        if (strlen(item->key) == 1) printf("%s: %ld, ", item->key, *(long *)item->data);
+    }
+    printf("}\n");
+
+    // clear items
+    chmap_clear(&a);
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+// reader-writer locks are part of POSIX, not of standard C, so that this header needs
+// -D_POSIX_C_SOURCE=200809L or -D_DEFAULT_SOURCE (or -std=gnu23) on glibc, and -pthread; defining
+// the macro here would not help if another libc header was already included
+
+// chmap_find looks up a shard under a shared read lock, so that several threads run hmap lookups on
+// the same shard at once; the counters of hashstats.h are plain integers, which these lookups would
+// update concurrently
+#ifdef HASH_STATS
+#error "chmap.h does not support HASH_STATS, because its lookups would race on the counters"
+#endif
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "hash.h"
+#include "hmap.h"
+
+// thread-safe associative array that splits its keys across hmap shards by the high bits of their
+// hash, where every shard has its own reader-writer lock; the allocator must be thread-safe
+typedef struct Chmap Chmap;
+typedef struct ChmapShard ChmapShard;
+
+// shard count of chmap_create
+enum { CHMAP_SHARDS = 64 };
+
+struct Chmap {
+    long shard_count, data_size;
+    HmapKeyHash *key_hash;
+    Allocator alloc;
+    ChmapShard *shard;
+    void *shard_data;
+};
+
+// every shard starts on its own cache line, so that threads that use different shards do not
+// contend for the same cache lines
+enum { X__CHMAP_ALIGN = 64 };
+
+struct ChmapShard {
+    alignas(X__CHMAP_ALIGN) pthread_rwlock_t lock;
+    Hmap hmap;
+};
+
+// iterate over the items of every shard while holding its read lock; the items of a shard are a
+// consistent snapshot, but other shards may change in the meantime; the loop must not be left with
+// break, goto, or return, because the lock of the current shard would not be released
+#define ChmapForEach(item, chmap)                                                       \
+    for (ChmapShard *x__##item##_shard = (chmap)->shard;                                \
+         x__##item##_shard < (chmap)->shard + (chmap)->shard_count &&                   \
+         !pthread_rwlock_rdlock(&x__##item##_shard->lock);                              \
+         pthread_rwlock_unlock(&x__##item##_shard->lock), ++x__##item##_shard)          \
+        HmapForEach(item, &x__##item##_shard->hmap)
+
+// create an empty chmap with shard_count shards and a total capacity of about capacity items; the
+// shard count is rounded up to a power of two, the remaining arguments are those of every shard
+static Chmap chmap_create_full(long shard_count, long capacity, long data_size, double load_factor,
+                               HmapKeyHash *key_hash, HmapDataCopy *data_copy,
+                               HmapDataFree *data_free, const Allocator *alloc, int flags)
+{
+    assert(0 < shard_count && shard_count <= 1 << 16);
+    assert(capacity >= 0);
+    Chmap chmap = {
+        .shard_count = hash_capacity(shard_count),
+        .data_size = data_size,
+        .key_hash = key_hash,
+        .alloc = (alloc ? *alloc : allocator_std),
+    };
+    chmap.shard_data = allocator_alloc(&chmap.alloc, chmap.shard_count + 1, sizeof(ChmapShard), 0);
+    assert(chmap.shard_data);
+    const uintptr_t shard = ((uintptr_t)chmap.shard_data + X__CHMAP_ALIGN - 1) & -X__CHMAP_ALIGN;
+    chmap.shard = (ChmapShard *)shard;
+    for (long i = 0; i < chmap.shard_count; ++i) {
+        pthread_rwlock_init(&chmap.shard[i].lock, 0);
+        chmap.shard[i].hmap =
+            hmap_create_full(capacity / chmap.shard_count, data_size, load_factor, key_hash,
+                             data_copy, data_free, &chmap.alloc, flags);
+    }
+    return chmap;
+}
+static Chmap chmap_create(long capacity, long data_size)
+{
+    return chmap_create_full(CHMAP_SHARDS, capacity, data_size, 0.75, strhash_wyhash, memcpy, free,
+                             0, 0);
+}
+
+// the shard index uses the high bits of the hash, and the shards use its low bits (after mixing)
+static ChmapShard *x__chmap_shard(const Chmap *chmap, uint64_t hash)
+{
+    return &chmap->shard[(hash >> 48) & (chmap->shard_count - 1)];
+}
+
+// insert an item with a given key, and return whether the key was new; on collision, keep the old
+// data or replace it (the old data is freed)
+static int chmap_insert(Chmap *chmap, const char *key, void *data, int keep)
+{
+    assert(chmap);
+    assert(key);
+    const long size = strlen(key);
+    const uint64_t hash = chmap->key_hash(key);
+    ChmapShard *shard = x__chmap_shard(chmap, hash);
+    Hmap *hmap = &shard->hmap;
+    pthread_rwlock_wrlock(&shard->lock);
+    const int found = hmap->size > 0 && x__hmap_find(hmap, key, size, hash);
+    if (found && !keep) {
+        void *item_data = x__hmap_remove(hmap, key, size, hash);
+        if (hmap->data_free) hmap->data_free(item_data);
+    }
+    if (!found || !keep) x__hmap_insert(hmap, key, size, data, hash, 0);
+    pthread_rwlock_unlock(&shard->lock);
+    return !found;
+}
+
+// remove an item with a given key, and return its data
+static void *chmap_remove(Chmap *chmap, const char *key)
+{
+    assert(chmap);
+    assert(key);
+    const uint64_t hash = chmap->key_hash(key);
+    ChmapShard *shard = x__chmap_shard(chmap, hash);
+    pthread_rwlock_wrlock(&shard->lock);
+    void *data = (shard->hmap.size > 0 ? x__hmap_remove(&shard->hmap, key, strlen(key), hash) : 0);
+    pthread_rwlock_unlock(&shard->lock);
+    return data;
+}
+
+// find an item with a given key, copy its data to data (if data is not 0), and return whether it
+// was found; the data is copied while the shard is locked, because another thread might remove the
+// item as soon as the lock is released
+static int chmap_find(const Chmap *chmap, const char *key, void *data)
+{
+    assert(chmap);
+    assert(key);
+    const uint64_t hash = chmap->key_hash(key);
+    ChmapShard *shard = x__chmap_shard(chmap, hash);
+    pthread_rwlock_rdlock(&shard->lock);
+    const long size = strlen(key);
+    const HmapItem *item =
+        (shard->hmap.size > 0 ? x__hmap_find(&shard->hmap, key, size, hash) : 0);
+    if (item && item->data && data) memcpy(data, item->data, chmap->data_size);
+    pthread_rwlock_unlock(&shard->lock);
+    return item != 0;
+}
+
+// return the number of items; the count is only exact if no other thread modifies the chmap
+static long chmap_size(const Chmap *chmap)
+{
+    assert(chmap);
+    long size = 0;
+    for (ChmapShard *shard = chmap->shard; shard < chmap->shard + chmap->shard_count; ++shard) {
+        pthread_rwlock_rdlock(&shard->lock);
+        size += shard->hmap.size;
+        pthread_rwlock_unlock(&shard->lock);
+    }
+    return size;
+}
+
+// remove all items from the chmap, and release the shards; no other thread may use it anymore
+static void chmap_clear(Chmap *chmap)
+{
+    assert(chmap);
+    if (!chmap->shard) return;
+    for (ChmapShard *shard = chmap->shard; shard < chmap->shard + chmap->shard_count; ++shard) {
+        hmap_clear(&shard->hmap);
+        pthread_rwlock_destroy(&shard->lock);
+    }
+    allocator_free(&chmap->alloc, chmap->shard_data);
+    *chmap = (Chmap){0};
+}
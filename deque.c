@@ -0,0 +1,47 @@
+#include "deque.h"
+
+#include <stdio.h>
+
+int main(void)
+{
+    // create a deque that stores integers, and push integers 0 through 4 to the back and integers 5
+    // through 9 to the front
+    Deque a = deque_create(4, sizeof(int));
+    for (int i = 0; i < 5; ++i) deque_push_back(&a, &i);
+    for (int i = 5; i < 10; ++i) deque_push_front(&a, &i);
+
+    // print items of deque a
+    printf("a = [");
+    DequeForEach(item, &a) printf("%d, ", *(int *)item->data);
+    printf("]\n");
+    printf("a[0], a[-1] = %d, %d\n", *(int *)deque_get(&a, 0), *(int *)deque_get(&a, -1));
+
+    // remove the first and the last item from deque a (the caller owns their data)
+    int *front = deque_pop_front(&a), *back = deque_pop_back(&a);
+    printf("a.pop_front(), a.pop_back() = %d, %d\n", *front, *back);
+    free(front);
+    free(back);
+
+    // create a flat deque that stores integers inline, and use it as a work queue whose items are
+    // taken from the front and whose new work is appended to the back
+    Deque b = deque_create_full(4, sizeof(int), memcpy, 0, 0, DEQUE_FLAT);
+    deque_push_back(&b, (int[]){1});
+    long sum = 0;
+    while (b.size > 0) {
+        const int work = *(int *)deque_pop_front(&b);
+        sum += work;
+        if (2 * work < 100) deque_push_back(&b, (int[]){2 * work});
+        if (2 * work + 1 < 100) deque_push_back(&b, (int[]){2 * work + 1});
+    }
+    printf("b.sum = %ld (expected %d)\n", sum, 99 * 100 / 2);
+
+    // push integers 0 through 9 to the front of deque b, and print its items
+    for (int i = 0; i < 10; ++i) deque_push_front(&b, &i);
+    printf("b = [");
+    DequeForEachFlat(data, &b) printf("%d, ", *(int *)data);
+    printf("]\n");
+
+    // clear items
+    deque_clear(&a);
+    deque_clear(&b);
+}
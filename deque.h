@@ -0,0 +1,208 @@
+#pragma once
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "hash.h"
+
+// double-ended queue in a ring buffer, with amortized constant time insertion and removal at both
+// ends; the items are stored starting at head, and wrap around to the front of the buffer
+typedef struct Deque Deque;
+typedef struct DequeItem DequeItem;
+typedef void *DequeDataCopy(void *, const void *, size_t);
+typedef void DequeDataFree(void *);
+
+// store data inline in one contiguous buffer instead of one allocation per item
+enum { DEQUE_FLAT = 1 << 0 };
+
+struct Deque {
+    long size, capacity, head, data_size, item_size;
+    int flags;
+    DequeDataCopy *data_copy;
+    DequeDataFree *data_free;
+    Allocator alloc;
+    union {
+        DequeItem *item;
+        void *data;
+    };
+};
+
+struct DequeItem {
+    void *data;
+};
+
+// the items are visited in two linear passes, one from head to the end of the buffer, and one from
+// the front of the buffer to the last item
+#define DequeForEach(item, deque)                                             \
+    for (int x__##item = 0; x__##item < 2; ++x__##item)                       \
+        for (DequeItem *item = x__deque_pass(deque, x__##item, 0),            \
+                       *x__##item##_end = x__deque_pass(deque, x__##item, 1); \
+             item < x__##item##_end; ++item)
+
+#define DequeForEachFlat(data, deque)                                    \
+    for (int x__##data = 0; x__##data < 2; ++x__##data)                  \
+        for (void *data = x__deque_pass(deque, x__##data, 0),            \
+                  *x__##data##_end = x__deque_pass(deque, x__##data, 1); \
+             data < x__##data##_end; data = (char *)data + (deque)->data_size)
+
+// create an empty deque; the capacity is rounded up to a power of two; in flat mode, data_copy is
+// required and data_free must not free the data
+static Deque deque_create_full(long capacity, long data_size, DequeDataCopy *data_copy,
+                               DequeDataFree *data_free, const Allocator *alloc, int flags)
+{
+    assert(capacity >= 0);
+    assert(data_size >= 0);
+    assert(!(flags & DEQUE_FLAT) || (data_size > 0 && data_copy));
+    return (Deque){
+        .capacity = hash_capacity(capacity),
+        .data_size = data_size,
+        .item_size = (flags & DEQUE_FLAT ? data_size : (long)sizeof(DequeItem)),
+        .flags = flags,
+        .data_copy = data_copy,
+        .data_free = data_free,
+        .alloc = (alloc ? *alloc : allocator_std),
+    };
+}
+static Deque deque_create(long capacity, long data_size)
+{
+    return deque_create_full(capacity, data_size, memcpy, free, 0, 0);
+}
+
+static long x__deque_slots(const Deque *deque)
+{
+    return deque->capacity + (deque->flags & DEQUE_FLAT ? 1 : 0);
+}
+
+static char *x__deque_item(const Deque *deque, long i)
+{
+    return (char *)deque->data + (i & (deque->capacity - 1)) * deque->item_size;
+}
+
+// return the begin (or end) of the items of a pass over the buffer
+static void *x__deque_pass(const Deque *deque, int pass, int end)
+{
+    if (!deque->data) return 0;
+    const long tail = deque->head + deque->size;
+    long i = 0;
+    if (pass == 0)
+        i = (end ? (tail < deque->capacity ? tail : deque->capacity) : deque->head);
+    else if (end && tail > deque->capacity)
+        i = tail - deque->capacity;
+    return (char *)deque->data + i * deque->item_size;
+}
+
+// double the capacity; the items that wrapped around are moved behind the old end of the buffer
+static void x__deque_resize_items(Deque *deque)
+{
+    if (!deque->data) {
+        deque->data = allocator_alloc(&deque->alloc, x__deque_slots(deque), deque->item_size, 1);
+        assert(deque->data);
+        return;
+    }
+    const long capacity = deque->capacity, wrapped = deque->head + deque->size - capacity;
+    deque->capacity *= 2;
+    deque->data =
+        allocator_realloc(&deque->alloc, deque->data, x__deque_slots(deque) * deque->item_size);
+    assert(deque->data);
+    if (wrapped > 0) {
+        char *data = deque->data;
+        memcpy(data + capacity * deque->item_size, data, wrapped * deque->item_size);
+    }
+}
+
+static void x__deque_item_create(const Deque *deque, char *item, void *data)
+{
+    if (deque->flags & DEQUE_FLAT) {
+        assert(data);
+        deque->data_copy(item, data, deque->data_size);
+    }
+    else if (data && deque->data_copy) {
+        void *copy = allocator_alloc(&deque->alloc, 1, deque->data_size, 0);
+        assert(copy);
+        deque->data_copy(copy, data, deque->data_size);
+        memcpy(item, &copy, sizeof(copy));
+    }
+    else {
+        memcpy(item, &data, sizeof(data));
+    }
+}
+
+// return the data of an item that was removed; a flat item is copied to the scratch slot past the
+// capacity
+static void *x__deque_item_take(const Deque *deque, const char *item)
+{
+    if (deque->flags & DEQUE_FLAT) {
+        char *scratch = (char *)deque->data + deque->capacity * deque->item_size;
+        return memcpy(scratch, item, deque->data_size);
+    }
+    void *data;
+    memcpy(&data, item, sizeof(data));
+    return data;
+}
+
+// add an item to the end of the deque
+static void deque_push_back(Deque *deque, void *data)
+{
+    assert(deque);
+    if (!deque->data || deque->size == deque->capacity) x__deque_resize_items(deque);
+    x__deque_item_create(deque, x__deque_item(deque, deque->head + deque->size), data);
+    deque->size += 1;
+}
+
+// add an item to the front of the deque
+static void deque_push_front(Deque *deque, void *data)
+{
+    assert(deque);
+    if (!deque->data || deque->size == deque->capacity) x__deque_resize_items(deque);
+    deque->head = (deque->head - 1) & (deque->capacity - 1);
+    x__deque_item_create(deque, x__deque_item(deque, deque->head), data);
+    deque->size += 1;
+}
+
+// remove the last item, and return its data; in flat mode, the data is only valid until the deque
+// is modified again
+static void *deque_pop_back(Deque *deque)
+{
+    assert(deque);
+    if (deque->size == 0) return 0;
+    deque->size -= 1;
+    return x__deque_item_take(deque, x__deque_item(deque, deque->head + deque->size));
+}
+
+// remove the first item, and return its data; in flat mode, the data is only valid until the deque
+// is modified again
+static void *deque_pop_front(Deque *deque)
+{
+    assert(deque);
+    if (deque->size == 0) return 0;
+    const char *item = x__deque_item(deque, deque->head);
+    deque->head = (deque->head + 1) & (deque->capacity - 1);
+    deque->size -= 1;
+    return x__deque_item_take(deque, item);
+}
+
+// return the data of the item at a given position (negative positions count from the end)
+static void *deque_get(const Deque *deque, long i)
+{
+    assert(deque);
+    assert(-deque->size <= i && i < deque->size);
+    if (i < 0) i += deque->size;
+    char *item = x__deque_item(deque, deque->head + i);
+    if (deque->flags & DEQUE_FLAT) return item;
+    void *data;
+    memcpy(&data, item, sizeof(data));
+    return data;
+}
+
+// remove all items from the deque
+static void deque_clear(Deque *deque)
+{
+    assert(deque);
+    if (!deque->data) return;
+    if (deque->data_free)
+        for (long i = 0; i < deque->size; ++i) deque->data_free(deque_get(deque, i));
+    allocator_free(&deque->alloc, deque->data);
+    *deque = (Deque){0};
+}
@@ -32,7 +32,33 @@ int main(void)
     printf("a.find(six) = %p\n", dict_find(&a, "six"));
     printf("b.find(six) = %p\n", dict_find(&b, "six"));
 
+    // create a dict that allocates its chained items from slabs of a pool, and insert many items
+    Dict c = dict_create_full(0, sizeof(long), 0.75, strhash_wyhash, memcpy, free, 0, DICT_POOL);
+    for (long i = 0; i < 1000; ++i) {
+        char _key[32];
+        snprintf(_key, sizeof(_key), "%ld", i);
+        dict_insert(&c, _key, &i, 0);
+    }
+    for (long i = 0; i < 1000; i += 2) {
+        char _key[32];
+        snprintf(_key, sizeof(_key), "%ld", i);
+        free(dict_remove(&c, _key));
+    }
+    printf("c.size = %ld\n", c.size);
+    printf("c.find(999) = %ld\n", *(long *)dict_find(&c, "999"));
+
+    // create a dict that interns its keys, and insert keys that are not terminated
+    Dict d = dict_create_full(0, sizeof(int), 0.75, strhash_wyhash, memcpy, free, 0, DICT_INTERN);
+    const char *text = "red,green,blue";
+    for (int i = 0, size; *text; ++i, text += size + (text[size] == ',')) {
+        size = strcspn(text, ",");
+        dict_insert_len(&d, text, size, &i, 0);
+    }
+    printf("d.find(green) = %d\n", *(int *)dict_find_len(&d, "greenish", 5));
+
     // clear items
     dict_clear(&a);
     dict_clear(&b);
+    dict_clear(&c);
+    dict_clear(&d);
 }
@@ -1,10 +1,15 @@
 #pragma once
 
 #include <assert.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "allocator.h"
+#include "arena.h"
 #include "hash.h"
+#include "hashstats.h"
+#include "pool.h"
 
 // general purpose associative array using open chaining
 typedef struct Dict Dict;
@@ -13,109 +18,183 @@ typedef uint64_t DictKeyHash(const char *);
 typedef void *DictDataCopy(void *, const void *, size_t);
 typedef void DictDataFree(void *);
 
+// grow incrementally: keep the old buckets after a resize, and move a few of them to the new
+// buckets with every insert and remove, instead of rehashing all items at once
+enum { DICT_INCREMENTAL = 1 << 0 };
+
+// allocate the chained items from slabs of a pool instead of one by one, which keeps chains close
+// in memory, and lets dict_clear release them at once
+enum { DICT_POOL = 1 << 1 };
+
+// store the keys that are passed to insert instead of copies of them; the keys must outlive the
+// dict, and they are not freed
+enum { DICT_BORROW = 1 << 2 };
+
+// copy the keys into an arena that is owned by the dict instead of allocating every key on its
+// own; the keys are only released by dict_clear
+enum { DICT_INTERN = 1 << 3 };
+
+// number of old buckets that are moved with every insert and remove in incremental mode
+enum { X__DICT_MOVE = 16 };
+
+// keys up to this size are terminated on the stack before they are hashed, and block size of the
+// first block of the arena of interned keys
+enum { X__DICT_KEY_BUFFER = 256, X__DICT_INTERN = 1 << 12 };
+
+// number of chained items per slab in pool mode
+enum { X__DICT_POOL_COUNT = 256 };
+
 struct Dict {
     long size, capacity, data_size;
     double load_factor;
+    int flags;
     DictKeyHash *key_hash;
     DictDataCopy *data_copy;
     DictDataFree *data_free;
+    Allocator alloc;
     DictItem *bucket;
+    Dict *old;
+    long old_index;
+    Pool pool;
+    Arena intern;
+#ifdef HASH_STATS
+    HashStats *stats;
+#endif
 };
 
+// the key is only terminated if it was copied, or if the borrowed key was terminated
 struct DictItem {
     char *key;
     void *data;
     uint64_t hash;
+    long key_size;
     DictItem *next;
 };
 
-#define DictForEach(item, dict)                                                                   \
-    for (DictItem *bucket = (dict)->bucket; bucket < (dict)->bucket + (dict)->capacity; ++bucket) \
-        if (bucket->key)                                                                          \
-            for (DictItem *item = bucket; item; item = item->next)
+#define DictForEach(item, dict)                                                          \
+    for (const Dict *x__##item = (dict); x__##item; x__##item = x__##item->old)          \
+        for (DictItem *bucket = x__##item->bucket;                                       \
+             bucket < x__##item->bucket + x__##item->capacity; ++bucket)                 \
+            if (bucket->key)                                                             \
+                for (DictItem *item = bucket; item; item = item->next)
 
-// create an empty dict
+// create an empty dict; the capacity is rounded up to a power of two
 static Dict dict_create_full(long capacity, long data_size, double load_factor,
                              DictKeyHash *key_hash, DictDataCopy *data_copy,
-                             DictDataFree *data_free)
+                             DictDataFree *data_free, const Allocator *alloc, int flags)
 {
     assert(capacity >= 0);
     assert(data_size >= 0);
     assert(0 < load_factor && load_factor < 1);
     assert(key_hash);
-    return (Dict){
-        .capacity = capacity / load_factor + 1,
+    Dict dict = {
+        .capacity = hash_capacity(capacity / load_factor + 1),
         .data_size = data_size,
         .load_factor = load_factor,
+        .flags = flags,
         .key_hash = key_hash,
         .data_copy = data_copy,
         .data_free = data_free,
+        .alloc = (alloc ? *alloc : allocator_std),
     };
+    if (flags & DICT_POOL)
+        dict.pool = pool_create(sizeof(DictItem), X__DICT_POOL_COUNT, &dict.alloc);
+    return dict;
 }
 static Dict dict_create(long capacity, long data_size)
 {
-    return dict_create_full(capacity, data_size, 0.75, strhash_fnv1a, memcpy, free);
+    return dict_create_full(capacity, data_size, 0.75, strhash_wyhash, memcpy, free, 0, 0);
 }
 
 static void x__dict_create_buckets(Dict *dict)
 {
-    dict->bucket = calloc(dict->capacity, sizeof(*dict->bucket));
+    dict->bucket = allocator_alloc(&dict->alloc, dict->capacity, sizeof(*dict->bucket), 1);
     assert(dict->bucket);
+    X__HASH_STATS(dict->stats = x__hash_stats_create(dict->stats, &dict->alloc));
+    X__HASH_STATS(x__hash_stats_alloc(dict->stats, dict->capacity * sizeof(*dict->bucket)));
 }
 
-static void x__dict_resize_buckets(Dict *dict)
+static DictItem *x__dict_bucket(const Dict *dict, uint64_t hash)
 {
-    assert(dict);
-    const long _capacity = dict->capacity / dict->load_factor + 1;
-    DictItem *_bucket = calloc(_capacity, sizeof(*_bucket));
-    assert(_bucket);
-    for (DictItem *bucket = dict->bucket; bucket < dict->bucket + dict->capacity; ++bucket) {
-        if (!bucket->key) continue;
-        for (DictItem *item = bucket, *next; item; item = next) {
-            next = item->next;
-            DictItem *_item = &_bucket[item->hash % _capacity];
-            DictItem *_prev = 0;
-            while (_item && _item->key) {
-                _prev = _item;
-                _item = _item->next;
-            }
-            if (!_item) {
-                if (item == bucket) {
-                    _item = malloc(sizeof(*_item));
-                    assert(_item);
-                    _item->key = item->key;
-                    _item->data = item->data;
-                    _item->hash = item->hash;
-                }
-                else {
-                    _item = item;
-                }
-                _item->next = 0;
-                assert(_prev);
-                _prev->next = _item;
-            }
-            else {
-                _item->key = item->key;
-                _item->data = item->data;
-                _item->hash = item->hash;
-                if (item != bucket) free(item);
-            }
-        }
+    return &dict->bucket[hash_mix(hash) & (dict->capacity - 1)];
+}
+
+// allocate a chained item; in pool mode, all tables share the pool of the current one
+static DictItem *x__dict_chain_create(Dict *dict)
+{
+    DictItem *item = (dict->flags & DICT_POOL
+                          ? pool_alloc(&dict->pool, 0)
+                          : allocator_alloc(&dict->alloc, 1, sizeof(*item), 0));
+    assert(item);
+    X__HASH_STATS(x__hash_stats_alloc(dict->stats, sizeof(*item)));
+    return item;
+}
+
+static void x__dict_chain_free(Dict *dict, DictItem *item)
+{
+    if (dict->flags & DICT_POOL)
+        pool_free(&dict->pool, item);
+    else
+        allocator_free(&dict->alloc, item);
+}
+
+// return the hash of a key of a given size, which is not necessarily terminated
+static uint64_t x__dict_key_hash(const Dict *dict, const char *key, long size)
+{
+    char buffer[X__DICT_KEY_BUFFER], *_key = buffer;
+    if (size >= X__DICT_KEY_BUFFER) _key = allocator_alloc(&dict->alloc, 1, size + 1, 0);
+    assert(_key);
+    memcpy(_key, key, size);
+    _key[size] = 0;
+    const uint64_t hash = dict->key_hash(_key);
+    if (_key != buffer) allocator_free(&dict->alloc, _key);
+    return hash;
+}
+
+// compare the keys of an item, which is one step of a probe along a chain (counted in probe)
+static int x__dict_key_equal(const Dict *dict, const DictItem *item, const char *key, long size,
+                             uint64_t hash, [[maybe_unused]] long *probe)
+{
+    X__HASH_STATS(*probe += 1);
+    X__HASH_STATS(x__hash_stats_compare(dict->stats, item->hash == hash));
+    (void)dict;
+    return item->hash == hash && item->key_size == size && !memcmp(item->key, key, size);
+}
+
+// return the key that is stored in an item: the key itself, or a terminated copy of it
+static char *x__dict_key_create(Dict *dict, const char *key, long size)
+{
+    if (dict->flags & DICT_BORROW) return (char *)key;
+    X__HASH_STATS(x__hash_stats_alloc(dict->stats, size + 1));
+    char *_key;
+    if (dict->flags & DICT_INTERN) {
+        if (!dict->intern.data) dict->intern = arena_create_full(X__DICT_INTERN, &dict->alloc);
+        _key = arena_alloc(&dict->intern, 1, size + 1, 1, 0);
+    }
+    else {
+        _key = allocator_alloc(&dict->alloc, 1, size + 1, 0);
     }
-    free(dict->bucket);
-    dict->bucket = _bucket;
-    dict->capacity = _capacity;
+    assert(_key);
+    memcpy(_key, key, size);
+    _key[size] = 0;
+    return _key;
 }
 
-static void x__dict_item_create(const Dict *dict, DictItem *item, const char *key, void *data,
+static void x__dict_key_free(const Dict *dict, char *key)
+{
+    if (!(dict->flags & (DICT_BORROW | DICT_INTERN))) allocator_free(&dict->alloc, key);
+}
+
+static void x__dict_item_create(Dict *dict, DictItem *item, const char *key, long size, void *data,
                                 uint64_t hash)
 {
-    item->key = strdup(key);
-    assert(item->key);
+    item->key = x__dict_key_create(dict, key, size);
+    item->key_size = size;
     if (data && dict->data_copy) {
-        item->data = malloc(dict->data_size);
+        item->data = allocator_alloc(&dict->alloc, 1, dict->data_size, 0);
         assert(item->data);
         dict->data_copy(item->data, data, dict->data_size);
+        X__HASH_STATS(x__hash_stats_alloc(dict->stats, dict->data_size));
     }
     else {
         item->data = data;
@@ -123,30 +202,112 @@ static void x__dict_item_create(const Dict *dict, DictItem *item, const char *ke
     item->hash = hash;
 }
 
-// insert an item with a given key; on collision, keep or replace data and return old data
-static void *dict_insert(Dict *dict, const char *key, void *data, int keep)
+// return the item with a given key from the current table (not the old one); the probe length is
+// added to probe
+static DictItem *x__dict_find_item(const Dict *dict, const char *key, long size, uint64_t hash,
+                                   long *probe)
+{
+    DictItem *item = x__dict_bucket(dict, hash);
+    while (item && item->key && !x__dict_key_equal(dict, item, key, size, hash, probe))
+        item = item->next;
+    return (!item || !item->key ? 0 : item);
+}
+
+// move the items of a bucket of another table to the end of their buckets in the current table,
+// reusing the chained items
+static void x__dict_move_bucket(Dict *dict, DictItem *bucket)
+{
+    if (!bucket->key) return;
+    for (DictItem *item = bucket, *next; item; item = next) {
+        next = item->next;
+        DictItem *_item = x__dict_bucket(dict, item->hash);
+        DictItem *_prev = 0;
+        while (_item && _item->key) {
+            _prev = _item;
+            _item = _item->next;
+        }
+        if (!_item) {
+            if (item == bucket) {
+                _item = x__dict_chain_create(dict);
+                *_item = *item;
+            }
+            else {
+                _item = item;
+            }
+            _item->next = 0;
+            assert(_prev);
+            _prev->next = _item;
+        }
+        else {
+            DictItem *_next = _item->next;
+            *_item = *item;
+            _item->next = _next;
+            if (item != bucket) x__dict_chain_free(dict, item);
+        }
+    }
+    memset(bucket, 0, sizeof(*bucket));
+}
+
+// move a few buckets of the old table to the current one, and release the old table once all of
+// them are moved
+static void x__dict_move_buckets(Dict *dict)
+{
+    Dict *old = dict->old;
+    for (long n = 0; n < X__DICT_MOVE && dict->old_index < old->capacity; ++n)
+        x__dict_move_bucket(dict, &old->bucket[dict->old_index++]);
+    if (dict->old_index < old->capacity) return;
+    allocator_free(&dict->alloc, old->bucket);
+    allocator_free(&dict->alloc, old);
+    dict->old = 0;
+}
+
+// grow the table; in incremental mode, the items are moved later by x__dict_move_buckets
+static void x__dict_resize_buckets(Dict *dict)
 {
     assert(dict);
-    assert(key);
-    if (!dict->bucket) x__dict_create_buckets(dict);
-    if (dict->size + 1 > dict->capacity * dict->load_factor) x__dict_resize_buckets(dict);
-    const uint64_t hash = dict->key_hash(key);
-    DictItem *item = &dict->bucket[hash % dict->capacity];
+    while (dict->old) x__dict_move_buckets(dict);
+    const long capacity = dict->capacity;
+    DictItem *bucket = dict->bucket;
+    if (dict->flags & DICT_INCREMENTAL) {
+        Dict *old = allocator_alloc(&dict->alloc, 1, sizeof(*old), 0);
+        assert(old);
+        *old = *dict;
+        old->pool = (Pool){0};
+        old->intern = (Arena){0};
+        dict->old = old;
+        dict->old_index = 0;
+    }
+    dict->capacity = 2 * capacity;
+    x__dict_create_buckets(dict);
+    if (dict->flags & DICT_INCREMENTAL) return;
+    for (long i = 0; i < capacity; ++i) x__dict_move_bucket(dict, &bucket[i]);
+    allocator_free(&dict->alloc, bucket);
+}
+
+static void *x__dict_insert_item(Dict *dict, const char *key, long size, void *data,
+                                 uint64_t hash, int keep, long *probe)
+{
+    DictItem *item = (dict->old ? x__dict_find_item(dict->old, key, size, hash, probe) : 0);
+    if (item) {
+        void *item_data = item->data;
+        if (!keep) item->data = data;
+        return item_data;
+    }
+    item = x__dict_bucket(dict, hash);
     DictItem *prev = 0;
-    while (item && item->key && (item->hash != hash || strcmp(item->key, key))) {
+    while (item && item->key && !x__dict_key_equal(dict, item, key, size, hash, probe)) {
         prev = item;
         item = item->next;
     }
     if (!item) {
-        item = malloc(sizeof(*item));
-        assert(item);
-        x__dict_item_create(dict, item, key, data, hash);
+        item = x__dict_chain_create(dict);
+        x__dict_item_create(dict, item, key, size, data, hash);
         item->next = 0;
         assert(prev);
         prev->next = item;
     }
     else if (!item->key) {
-        x__dict_item_create(dict, item, key, data, hash);
+        x__dict_item_create(dict, item, key, size, data, hash);
     }
     else {
         void *item_data = item->data;
@@ -157,82 +318,209 @@ static void *dict_insert(Dict *dict, const char *key, void *data, int keep)
     return 0;
 }
 
+static void *x__dict_insert(Dict *dict, const char *key, long size, void *data, uint64_t hash,
+                            int keep)
+{
+    if (!dict->bucket) x__dict_create_buckets(dict);
+    if (dict->size + 1 > dict->capacity * dict->load_factor) {
+        X__HASH_STATS(const double start = x__hash_stats_now());
+        x__dict_resize_buckets(dict);
+        X__HASH_STATS(x__hash_stats_resize(dict->stats, start));
+    }
+    if (dict->old) x__dict_move_buckets(dict);
+    long probe = 0;
+    void *item_data = x__dict_insert_item(dict, key, size, data, hash, keep, &probe);
+    X__HASH_STATS(x__hash_stats_insert(dict->stats, probe));
+    return item_data;
+}
+
+// insert an item with a given key; on collision, keep or replace data and return old data
+static void *dict_insert(Dict *dict, const char *key, void *data, int keep)
+{
+    assert(dict);
+    assert(key);
+    return x__dict_insert(dict, key, strlen(key), data, dict->key_hash(key), keep);
+}
+
+// insert an item with a key of a given size, which does not need to be terminated (but must not
+// contain null bytes); on collision, keep or replace data and return old data
+static void *dict_insert_len(Dict *dict, const char *key, long size, void *data, int keep)
+{
+    assert(dict);
+    assert(key || size == 0);
+    assert(size >= 0);
+    return x__dict_insert(dict, key, size, data, x__dict_key_hash(dict, key, size), keep);
+}
+
 // return a copy of the dict
 static Dict dict_copy(const Dict *dict)
 {
     assert(dict);
     Dict copy = dict_create_full(dict->size, dict->data_size, dict->load_factor, dict->key_hash,
-                                 dict->data_copy, dict->data_free);
+                                 dict->data_copy, dict->data_free, &dict->alloc, dict->flags);
     if (dict->size == 0) return copy;
-    for (const DictItem *bucket = dict->bucket; bucket < dict->bucket + dict->capacity; ++bucket)
-        if (bucket->key)
-            for (const DictItem *item = bucket; item; item = item->next)
-                dict_insert(&copy, item->key, item->data, 0);
+    DictForEach(item, dict)
+        x__dict_insert(&copy, item->key, item->key_size, item->data, item->hash, 0);
     return copy;
 }
 
-// remove an item with a given key, and return its data
-static void *dict_remove(Dict *dict, const char *key)
+// remove an item with a given key from a table (the current or the old one), and return whether it
+// was found; the probe length is added to probe
+static int x__dict_take_item(Dict *dict, const Dict *table, const char *key, long size,
+                             uint64_t hash, void **data, long *probe)
 {
-    assert(dict);
-    assert(key);
-    if (dict->size == 0) return 0;
-    const uint64_t hash = dict->key_hash(key);
-    DictItem *item = &dict->bucket[hash % dict->capacity];
+    DictItem *item = x__dict_bucket(table, hash);
     DictItem *prev = 0;
-    while (item && item->key && (item->hash != hash || strcmp(item->key, key))) {
+    while (item && item->key && !x__dict_key_equal(dict, item, key, size, hash, probe)) {
         prev = item;
         item = item->next;
     }
     if (!item || !item->key) return 0;
-    void *data = item->data;
+    *data = item->data;
     DictItem *next = item->next;
-    free(item->key);
+    x__dict_key_free(dict, item->key);
     if (!prev) {
         if (next) {
             *item = *next;
-            free(next);
+            x__dict_chain_free(dict, next);
         }
         else {
             memset(item, 0, sizeof(*item));
         }
     }
     else {
-        free(item);
+        x__dict_chain_free(dict, item);
         prev->next = next;
     }
+    return 1;
+}
+
+static void *x__dict_remove(Dict *dict, const char *key, long size, uint64_t hash)
+{
+    if (dict->old) x__dict_move_buckets(dict);
+    void *data = 0;
+    long probe = 0;
+    const int found =
+        x__dict_take_item(dict, dict, key, size, hash, &data, &probe) ||
+        (dict->old && x__dict_take_item(dict, dict->old, key, size, hash, &data, &probe));
+    X__HASH_STATS(x__hash_stats_find(dict->stats, probe));
+    if (!found) return 0;
     dict->size -= 1;
     return data;
 }
 
+// remove an item with a given key, and return its data
+static void *dict_remove(Dict *dict, const char *key)
+{
+    assert(dict);
+    assert(key);
+    if (dict->size == 0) return 0;
+    return x__dict_remove(dict, key, strlen(key), dict->key_hash(key));
+}
+
+// remove an item with a key of a given size (see dict_insert_len), and return its data
+static void *dict_remove_len(Dict *dict, const char *key, long size)
+{
+    assert(dict);
+    assert(key || size == 0);
+    assert(size >= 0);
+    if (dict->size == 0) return 0;
+    return x__dict_remove(dict, key, size, x__dict_key_hash(dict, key, size));
+}
+
+static void *x__dict_find(const Dict *dict, const char *key, long size, uint64_t hash)
+{
+    long probe = 0;
+    DictItem *item = x__dict_find_item(dict, key, size, hash, &probe);
+    if (!item && dict->old) item = x__dict_find_item(dict->old, key, size, hash, &probe);
+    X__HASH_STATS(x__hash_stats_find(dict->stats, probe));
+    return (item ? item->data : 0);
+}
+
 // return the data of an item with a given key
 static void *dict_find(const Dict *dict, const char *key)
 {
     assert(dict);
     assert(key);
     if (dict->size == 0) return 0;
-    const uint64_t hash = dict->key_hash(key);
-    DictItem *item = &dict->bucket[hash % dict->capacity];
-    while (item && item->key && (item->hash != hash || strcmp(item->key, key))) item = item->next;
-    return (!item || !item->key ? 0 : item->data);
+    return x__dict_find(dict, key, strlen(key), dict->key_hash(key));
+}
+
+// return the data of an item with a key of a given size (see dict_insert_len)
+static void *dict_find_len(const Dict *dict, const char *key, long size)
+{
+    assert(dict);
+    assert(key || size == 0);
+    assert(size >= 0);
+    if (dict->size == 0) return 0;
+    return x__dict_find(dict, key, size, x__dict_key_hash(dict, key, size));
 }
 
-// remove all items from the dict
+// remove all items from the dict; in pool mode, the chained items are released at once, and so are
+// interned keys
 static void dict_clear(Dict *dict)
 {
     assert(dict);
     if (!dict->bucket) return;
-    for (DictItem *bucket = dict->bucket; bucket < dict->bucket + dict->capacity; ++bucket) {
-        if (!bucket->key) continue;
-        free(bucket->key);
-        if (dict->data_free) dict->data_free(bucket->data);
-        for (DictItem *item = bucket->next, *next; item; item = next) {
-            next = item->next;
-            free(item->key);
-            if (dict->data_free) dict->data_free(item->data);
-            free(item);
+    if (dict->old) {
+        X__HASH_STATS(dict->old->stats = 0);
+        dict_clear(dict->old);
+        allocator_free(&dict->alloc, dict->old);
+    }
+    // the items are only visited if there is work per item, because the pool and the intern arena
+    // are released at once
+    const int key_free = dict->alloc.deallocate && !(dict->flags & (DICT_BORROW | DICT_INTERN));
+    const int chain_free = dict->alloc.deallocate && !(dict->flags & DICT_POOL);
+    if (dict->data_free || key_free || chain_free) {
+        for (DictItem *bucket = dict->bucket; bucket < dict->bucket + dict->capacity; ++bucket) {
+            if (!bucket->key) continue;
+            x__dict_key_free(dict, bucket->key);
+            if (dict->data_free) dict->data_free(bucket->data);
+            for (DictItem *item = bucket->next, *next; item; item = next) {
+                next = item->next;
+                x__dict_key_free(dict, item->key);
+                if (dict->data_free) dict->data_free(item->data);
+                if (!(dict->flags & DICT_POOL)) allocator_free(&dict->alloc, item);
+            }
         }
     }
-    free(dict->bucket);
+    allocator_free(&dict->alloc, dict->bucket);
+    pool_clear(&dict->pool);
+    if (dict->intern.data) arena_clear(&dict->intern);
+    X__HASH_STATS(allocator_free(&dict->alloc, dict->stats));
     *dict = (Dict){0};
 }
+
+#ifdef HASH_STATS
+// count the buckets of a table by the length of their chains
+static void x__dict_stats_chains(const Dict *dict, long *chain)
+{
+    for (const DictItem *bucket = dict->bucket; bucket < dict->bucket + dict->capacity; ++bucket) {
+        long length = 0;
+        if (bucket->key)
+            for (const DictItem *item = bucket; item; item = item->next) length += 1;
+        chain[length < HASH_STATS_PROBE ? length : HASH_STATS_PROBE - 1] += 1;
+    }
+}
+
+// print the instrumentation counters and the chain length distribution of the dict to file
+static void dict_stats_print(FILE *file, const Dict *dict)
+{
+    assert(file);
+    assert(dict);
+    const double load = (dict->capacity ? (double)dict->size / dict->capacity : 0);
+    fprintf(file, "dict of %ld items in %ld buckets (load %.3f of %.3f)%s\n", dict->size,
+            dict->capacity, load, dict->load_factor, (dict->old ? " while resizing" : ""));
+    if (!dict->stats) return;
+    x__hash_stats_print(file, dict->stats);
+    long chain[HASH_STATS_PROBE] = {0};
+    x__dict_stats_chains(dict, chain);
+    if (dict->old) x__dict_stats_chains(dict->old, chain);
+    long last = 0;
+    for (long i = 0; i < HASH_STATS_PROBE; ++i)
+        if (chain[i]) last = i;
+    fprintf(file, "%8s %12s\n", "chain", "buckets");
+    for (long i = 0; i <= last; ++i)
+        fprintf(file, "%7ld%c %12ld\n", i, (i == HASH_STATS_PROBE - 1 ? '+' : ' '), chain[i]);
+}
+#endif
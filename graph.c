@@ -0,0 +1,62 @@
+#include "graph.h"
+
+#include <stdio.h>
+
+int main(void)
+{
+    // collect the edges of a directed graph with 6 vertices, in which vertex 5 is isolated
+    GraphBuilder builder = graph_builder_create(6, 8, 0);
+    graph_add_edge(&builder, 0, 1, 7);
+    graph_add_edge(&builder, 0, 2, 2);
+    graph_add_edge(&builder, 2, 1, 3);
+    graph_add_edge(&builder, 1, 3, 1);
+    graph_add_edge(&builder, 2, 3, 8);
+    graph_add_edge(&builder, 3, 4, 2);
+
+    // freeze the edges into a graph; the builder is left as it is
+    Graph a = graph_build(&builder, 0);
+
+    // print the edges that leave every vertex
+    for (long v = 0; v < a.vertex_count; ++v) {
+        printf("a[%ld] = [", v);
+        GraphForEachEdge(edge, &a, v) printf("%ld: %g, ", a.target[edge], a.weight[edge]);
+        printf("]\n");
+    }
+
+    // count the edges on the shortest paths from vertex 0, with 2 threads
+    long hops[6];
+    const long reached = graph_bfs(&a, 0, hops, 2);
+    printf("a.bfs(0) = [");
+    for (long v = 0; v < 6; ++v) printf("%ld, ", hops[v]);
+    printf("] (%ld reached)\n", reached);
+
+    // compute the lengths of the shortest paths from vertex 0, and the path to vertex 4
+    double distance[6];
+    long parent[6];
+    graph_dijkstra(&a, 0, distance, parent);
+    printf("a.dijkstra(0) = [");
+    for (long v = 0; v < 6; ++v) printf("%g, ", distance[v]);
+    printf("]\n");
+    printf("a.path(4) = [");
+    for (long v = 4; v >= 0; v = parent[v]) printf("%ld, ", v);
+    printf("]\n");
+
+    // sort the vertices topologically
+    long order[6];
+    const long sorted = graph_toposort(&a, order);
+    printf("a.toposort() = [");
+    for (long i = 0; i < sorted; ++i) printf("%ld, ", order[i]);
+    printf("]\n");
+
+    // build an undirected graph from the same edges, in which vertex 4 reaches vertex 0
+    Graph b = graph_build(&builder, GRAPH_UNDIRECTED);
+    graph_bfs(&b, 4, hops, 1);
+    printf("b.bfs(4) = [");
+    for (long v = 0; v < 6; ++v) printf("%ld, ", hops[v]);
+    printf("]\n");
+
+    // clear the builder and the graphs
+    graph_builder_clear(&builder);
+    graph_clear(&a);
+    graph_clear(&b);
+}
@@ -0,0 +1,358 @@
+#pragma once
+
+#include <assert.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "array.h"
+#include "heap.h"
+
+// directed graph in compressed sparse row layout: the targets and weights of the edges that leave
+// vertex v are stored at positions offset[v] through offset[v + 1] - 1, and the sources of the
+// edges that enter it at positions in_offset[v] through in_offset[v + 1] - 1; a graph is built from
+// the edges that were collected by a graph builder, and does not change afterwards
+typedef struct Graph Graph;
+typedef struct GraphBuilder GraphBuilder;
+typedef struct GraphEdge GraphEdge;
+
+// store every edge in both directions, so that the incoming edges are the outgoing ones
+enum { GRAPH_UNDIRECTED = 1 << 0 };
+
+struct Graph {
+    long vertex_count, edge_count;
+    int flags;
+    Allocator alloc;
+    long *offset, *target, *in_offset, *source;
+    double *weight;
+};
+
+struct GraphBuilder {
+    long vertex_count;
+    Array edge;
+};
+
+struct GraphEdge {
+    long source, target;
+    double weight;
+};
+
+// iterate over the positions of the edges that leave a vertex
+#define GraphForEachEdge(edge, graph, vertex) \
+    for (long edge = (graph)->offset[vertex]; edge < (graph)->offset[(vertex) + 1]; ++edge)
+
+// iterate over the positions of the edges that enter a vertex
+#define GraphForEachInEdge(edge, graph, vertex) \
+    for (long edge = (graph)->in_offset[vertex]; edge < (graph)->in_offset[(vertex) + 1]; ++edge)
+
+// create an empty graph builder for vertex_count vertices, with room for capacity edges; the edges
+// are stored in a flat array
+static GraphBuilder graph_builder_create(long vertex_count, long capacity, const Allocator *alloc)
+{
+    assert(vertex_count >= 0);
+    return (GraphBuilder){
+        .vertex_count = vertex_count,
+        .edge = array_create_full(capacity, sizeof(GraphEdge), 0, memcpy, 0, alloc, ARRAY_FLAT),
+    };
+}
+
+// add an edge with a given weight from source to target; vertices are numbered from 0, and the
+// vertex count grows to include both of them
+static void graph_add_edge(GraphBuilder *builder, long source, long target, double weight)
+{
+    assert(builder);
+    assert(source >= 0 && target >= 0);
+    if (source >= builder->vertex_count) builder->vertex_count = source + 1;
+    if (target >= builder->vertex_count) builder->vertex_count = target + 1;
+    array_append(&builder->edge, &(GraphEdge){source, target, weight});
+}
+
+// remove all edges from the builder
+static void graph_builder_clear(GraphBuilder *builder)
+{
+    assert(builder);
+    array_clear(&builder->edge);
+    *builder = (GraphBuilder){0};
+}
+
+// sort edges into compressed sparse row layout by their sources (or by their targets if reverse is
+// set, and by both if both is set) with a counting sort, which keeps the order of the edges of
+// every vertex; while the edges are placed, offset[v] is the next free position of vertex v
+static void x__graph_sort(const GraphEdge *edge, long count, long vertex_count, int both,
+                          int reverse, long *offset, long *other, double *weight)
+{
+    for (long e = 0; e < count; ++e) {
+        offset[(reverse ? edge[e].target : edge[e].source) + 1] += 1;
+        if (both) offset[edge[e].target + 1] += 1;
+    }
+    for (long v = 0; v < vertex_count; ++v) offset[v + 1] += offset[v];
+    for (long e = 0; e < count; ++e) {
+        const long from = (reverse ? edge[e].target : edge[e].source);
+        const long to = (reverse ? edge[e].source : edge[e].target);
+        long i = offset[from]++;
+        other[i] = to;
+        if (weight) weight[i] = edge[e].weight;
+        if (!both) continue;
+        i = offset[to]++;
+        other[i] = from;
+        if (weight) weight[i] = edge[e].weight;
+    }
+    memmove(offset + 1, offset, vertex_count * sizeof(*offset));
+    offset[0] = 0;
+}
+
+// build a graph from the edges of a builder in O(vertices + edges) time; an undirected graph stores
+// every edge twice, once for each direction, and the edge count includes both
+static Graph graph_build(const GraphBuilder *builder, int flags)
+{
+    assert(builder);
+    assert(builder->edge.alloc.allocate);
+    const int undirected = flags & GRAPH_UNDIRECTED;
+    const long count = builder->edge.size;
+    Graph graph = {
+        .vertex_count = builder->vertex_count,
+        .edge_count = (undirected ? 2 : 1) * count,
+        .flags = flags,
+        .alloc = builder->edge.alloc,
+    };
+    const long n = graph.vertex_count, m = graph.edge_count;
+    graph.offset = allocator_alloc(&graph.alloc, n + 1, sizeof(long), 1);
+    graph.target = allocator_alloc(&graph.alloc, m + 1, sizeof(long), 0);
+    graph.weight = allocator_alloc(&graph.alloc, m + 1, sizeof(double), 0);
+    assert(graph.offset && graph.target && graph.weight);
+    x__graph_sort(builder->edge.data, count, n, undirected, 0, graph.offset, graph.target,
+                  graph.weight);
+    if (undirected) {
+        graph.in_offset = graph.offset;
+        graph.source = graph.target;
+        return graph;
+    }
+    graph.in_offset = allocator_alloc(&graph.alloc, n + 1, sizeof(long), 1);
+    graph.source = allocator_alloc(&graph.alloc, m + 1, sizeof(long), 0);
+    assert(graph.in_offset && graph.source);
+    x__graph_sort(builder->edge.data, count, n, 0, 1, graph.in_offset, graph.source, 0);
+    return graph;
+}
+
+// return the number of edges that leave a vertex
+static long graph_degree(const Graph *graph, long vertex)
+{
+    assert(graph);
+    assert(0 <= vertex && vertex < graph->vertex_count);
+    return graph->offset[vertex + 1] - graph->offset[vertex];
+}
+
+// breadth-first search switches from top-down steps (which follow the edges that leave the
+// frontier) to bottom-up steps (which look for a parent in the frontier among the edges that enter
+// every unvisited vertex) once the edges of the frontier are more than 1 / ALPHA of the edges of
+// the unvisited vertices, and back once the frontier has less than 1 / BETA of all vertices
+enum { X__GRAPH_BFS_ALPHA = 14, X__GRAPH_BFS_BETA = 24 };
+
+// a bottom-up step over the vertices begin through end - 1, which counts the vertices that join
+// the next frontier and their edges
+typedef struct {
+    const Graph *graph;
+    long begin, end, level, size, degree;
+    long *distance;
+    const char *frontier;
+    char *next;
+    int error;
+} x__GraphBfsTask;
+
+static void *x__graph_bfs_bottom_up(void *arg)
+{
+    x__GraphBfsTask *task = arg;
+    const Graph *graph = task->graph;
+    task->size = task->degree = 0;
+    for (long v = task->begin; v < task->end; ++v) {
+        task->next[v] = 0;
+        if (task->distance[v] >= 0) continue;
+        GraphForEachInEdge(edge, graph, v) {
+            if (!task->frontier[graph->source[edge]]) continue;
+            task->distance[v] = task->level + 1;
+            task->next[v] = 1;
+            task->size += 1;
+            task->degree += graph->offset[v + 1] - graph->offset[v];
+            break;
+        }
+    }
+    return 0;
+}
+
+// split a bottom-up step across nthreads threads; every thread owns a range of vertices, and only
+// writes their distances and frontier flags
+static void x__graph_bfs_bottom_up_parallel(x__GraphBfsTask *task, pthread_t *thread, int nthreads,
+                                            long *size, long *degree)
+{
+    const long n = task[0].graph->vertex_count;
+    for (int t = nthreads - 1; t >= 0; --t) {
+        task[t] = task[0];
+        task[t].begin = n * t / nthreads;
+        task[t].end = n * (t + 1) / nthreads;
+        task[t].error = (t == 0 || pthread_create(&thread[t], 0, x__graph_bfs_bottom_up, &task[t]));
+        if (task[t].error) x__graph_bfs_bottom_up(&task[t]);
+    }
+    *size = *degree = 0;
+    for (int t = 0; t < nthreads; ++t) {
+        if (!task[t].error) pthread_join(thread[t], 0);
+        *size += task[t].size;
+        *degree += task[t].degree;
+    }
+}
+
+// store the number of edges on the shortest path from source to every vertex in distance (-1 for
+// unreachable vertices), and return the number of reachable vertices; the search is direction
+// optimizing, and its bottom-up steps are split across nthreads threads
+static long graph_bfs(const Graph *graph, long source, long *distance, int nthreads)
+{
+    assert(graph);
+    assert(0 <= source && source < graph->vertex_count);
+    assert(distance);
+    assert(nthreads > 0);
+    const long n = graph->vertex_count;
+    long *queue = allocator_alloc(&graph->alloc, n, sizeof(long), 0);
+    char *frontier = allocator_alloc(&graph->alloc, n, 1, 1);
+    char *next = allocator_alloc(&graph->alloc, n, 1, 0);
+    x__GraphBfsTask *task = allocator_alloc(&graph->alloc, nthreads, sizeof(*task), 0);
+    pthread_t *thread = allocator_alloc(&graph->alloc, nthreads, sizeof(*thread), 0);
+    assert(queue && frontier && next && task && thread);
+    for (long v = 0; v < n; ++v) distance[v] = -1;
+    distance[source] = 0;
+
+    // a top-down frontier is stored in queue[head] through queue[tail - 1], and a bottom-up one in
+    // the flags of frontier
+    long head = 0, tail = 0, level = 0, reached = 1;
+    queue[tail++] = source;
+    long size = 1, degree = graph_degree(graph, source), unvisited = graph->edge_count - degree;
+    int bottom_up = 0;
+    while (size > 0) {
+        if (!bottom_up && degree > unvisited / X__GRAPH_BFS_ALPHA) {
+            bottom_up = 1;
+            memset(frontier, 0, n);
+            for (long i = head; i < tail; ++i) frontier[queue[i]] = 1;
+        }
+        else if (bottom_up && size < n / X__GRAPH_BFS_BETA) {
+            bottom_up = 0;
+            head = tail;
+            for (long v = 0; v < n; ++v)
+                if (frontier[v]) queue[tail++] = v;
+        }
+        if (bottom_up) {
+            task[0] = (x__GraphBfsTask){
+                .graph = graph,
+                .level = level,
+                .distance = distance,
+                .frontier = frontier,
+                .next = next,
+            };
+            x__graph_bfs_bottom_up_parallel(task, thread, nthreads, &size, &degree);
+            char *swap = frontier;
+            frontier = next;
+            next = swap;
+        }
+        else {
+            size = degree = 0;
+            for (const long end = tail; head < end; ++head) {
+                GraphForEachEdge(edge, graph, queue[head]) {
+                    const long v = graph->target[edge];
+                    if (distance[v] >= 0) continue;
+                    distance[v] = level + 1;
+                    queue[tail++] = v;
+                    size += 1;
+                    degree += graph_degree(graph, v);
+                }
+            }
+        }
+        unvisited -= degree;
+        reached += size;
+        level += 1;
+    }
+    allocator_free(&graph->alloc, queue);
+    allocator_free(&graph->alloc, frontier);
+    allocator_free(&graph->alloc, next);
+    allocator_free(&graph->alloc, task);
+    allocator_free(&graph->alloc, thread);
+    return reached;
+}
+
+// store the length of the shortest path from source to every vertex in distance (INFINITY for
+// unreachable vertices), and the previous vertex on that path in parent (unless it is 0; -1 for
+// the source and unreachable vertices); the weights must not be negative; the vertices that wait
+// to be visited are kept in an indexed heap, whose handles let shorter paths update them in place
+static void graph_dijkstra(const Graph *graph, long source, double *distance, long *parent)
+{
+    assert(graph);
+    assert(0 <= source && source < graph->vertex_count);
+    assert(distance);
+    const long n = graph->vertex_count;
+    long *handle = allocator_alloc(&graph->alloc, n, sizeof(long), 0);
+    assert(handle);
+    for (long v = 0; v < n; ++v) {
+        distance[v] = INFINITY;
+        handle[v] = -1;
+        if (parent) parent[v] = -1;
+    }
+    const int flags = HEAP_FLAT | HEAP_INDEXED;
+    Heap heap = heap_create_full(0, sizeof(long), memcpy, 0, &graph->alloc, flags);
+    distance[source] = 0;
+    handle[source] = heap_push(&heap, 0, &source);
+    while (heap.size > 0) {
+        const long u = *(long *)heap_pop(&heap);
+        GraphForEachEdge(edge, graph, u) {
+            assert(graph->weight[edge] >= 0);
+            long v = graph->target[edge];
+            const double length = distance[u] + graph->weight[edge];
+            if (length >= distance[v]) continue;
+            distance[v] = length;
+            if (parent) parent[v] = u;
+            if (handle[v] < 0)
+                handle[v] = heap_push(&heap, -length, &v);
+            else
+                heap_update(&heap, handle[v], -length);
+        }
+    }
+    heap_clear(&heap);
+    allocator_free(&graph->alloc, handle);
+}
+
+// store the vertices in order, such that every edge leads to a later vertex, and return the number
+// of stored vertices, which is less than the vertex count if the graph has a cycle (Kahn's
+// algorithm, with order as its queue)
+static long graph_toposort(const Graph *graph, long *order)
+{
+    assert(graph);
+    assert(order);
+    const long n = graph->vertex_count;
+    long *degree = allocator_alloc(&graph->alloc, n + 1, sizeof(long), 0);
+    assert(degree);
+    long tail = 0;
+    for (long v = 0; v < n; ++v) {
+        degree[v] = graph->in_offset[v + 1] - graph->in_offset[v];
+        if (degree[v] == 0) order[tail++] = v;
+    }
+    for (long head = 0; head < tail; ++head) {
+        GraphForEachEdge(edge, graph, order[head]) {
+            const long v = graph->target[edge];
+            if (--degree[v] == 0) order[tail++] = v;
+        }
+    }
+    allocator_free(&graph->alloc, degree);
+    return tail;
+}
+
+// release the graph
+static void graph_clear(Graph *graph)
+{
+    assert(graph);
+    if (!graph->offset) return;
+    if (!(graph->flags & GRAPH_UNDIRECTED)) {
+        allocator_free(&graph->alloc, graph->in_offset);
+        allocator_free(&graph->alloc, graph->source);
+    }
+    allocator_free(&graph->alloc, graph->offset);
+    allocator_free(&graph->alloc, graph->target);
+    allocator_free(&graph->alloc, graph->weight);
+    *graph = (Graph){0};
+}
@@ -10,9 +10,15 @@ int main(void)
     printf("fnv1a(str) = %lu\n", memhash_fnv1a(str, strlen(str)));
     printf("fnv1a(str) = %lu\n", strhash_fnv1a(str));
 
-    printf("fnv1a(str) = %lu\n", memhash_djb2(str, strlen(str)));
+    printf("djb2(str)  = %lu\n", memhash_djb2(str, strlen(str)));
     printf("djb2(str)  = %lu\n", strhash_djb2(str));
 
-    printf("fnv1a(str) = %lu\n", memhash_sdbm(str, strlen(str)));
+    printf("sdbm(str)  = %lu\n", memhash_sdbm(str, strlen(str)));
     printf("sdbm(str)  = %lu\n", strhash_sdbm(str));
+
+    printf("wyhash(str) = %lu\n", memhash_wyhash(str, strlen(str)));
+    printf("wyhash(str) = %lu\n", strhash_wyhash(str));
+
+    // use a different seed (for example a random one) to get unpredictable hashes
+    printf("wyhash(str, 42) = %lu\n", strhash_wyhash_seed(str, 42));
 }
@@ -1,13 +1,14 @@
 #pragma once
 
 #include <stdint.h>
+#include <string.h>
 
 // Fowler–Noll–Vo hash function
 static uint64_t strhash_fnv1a(const char *str)
 {
     uint64_t hash = 0xcbf29ce484222325;
     int c;
-    while ((c = *str++)) {
+    while ((c = (unsigned char)*str++)) {
         hash ^= c;
         hash *= 0x00000100000001b3;
     }
@@ -16,7 +17,7 @@ static uint64_t strhash_fnv1a(const char *str)
 static uint64_t memhash_fnv1a(const void *mem, long size)
 {
     uint64_t hash = 0xcbf29ce484222325;
-    for (const char *byte = mem; byte < (char *)mem + size; ++byte) {
+    for (const unsigned char *byte = mem; byte < (unsigned char *)mem + size; ++byte) {
         hash ^= *byte;
         hash *= 0x00000100000001b3;
     }
@@ -28,13 +29,13 @@ static uint64_t strhash_djb2(const char *str)
 {
     uint64_t hash = 5381;
     int c;
-    while ((c = *str++)) hash = ((hash << 5) + hash) + c;
+    while ((c = (unsigned char)*str++)) hash = ((hash << 5) + hash) + c;
     return hash;
 }
 static uint64_t memhash_djb2(const void *mem, long size)
 {
     uint64_t hash = 5381;
-    for (const char *byte = mem; byte < (char *)mem + size; ++byte)
+    for (const unsigned char *byte = mem; byte < (unsigned char *)mem + size; ++byte)
         hash = ((hash << 5) + hash) + *byte;
     return hash;
 }
@@ -44,13 +45,162 @@ static uint64_t strhash_sdbm(const char *str)
 {
     uint64_t hash = 0;
     int c;
-    while ((c = *str++)) hash = c + (hash << 6) + (hash << 16) - hash;
+    while ((c = (unsigned char)*str++)) hash = c + (hash << 6) + (hash << 16) - hash;
     return hash;
 }
 static uint64_t memhash_sdbm(const void *mem, long size)
 {
     uint64_t hash = 0;
-    for (const char *byte = mem; byte < (char *)mem + size; ++byte)
+    for (const unsigned char *byte = mem; byte < (unsigned char *)mem + size; ++byte)
         hash = *byte + (hash << 6) + (hash << 16) - hash;
     return hash;
 }
+
+// mix a hash by multiplying it with 2^64 divided by the golden ratio (fibonacci hashing), and by
+// folding its high bits into its low bits, so that even weak hashes have well spread low bits
+static uint64_t hash_mix(uint64_t hash)
+{
+    hash *= 0x9e3779b97f4a7c15;
+    return hash ^ (hash >> 32);
+}
+
+// return the smallest power of two that is not smaller than size, so that hash tables can index
+// with hash_mix(hash) & (capacity - 1) instead of a division
+static long hash_capacity(long size)
+{
+    long capacity = 1;
+    while (capacity < size) capacity *= 2;
+    return capacity;
+}
+
+// hint that the memory at ptr is about to be read (as by the batched lookups of the hash tables);
+// does nothing on compilers without __builtin_prefetch
+static void x__hash_prefetch(const void *ptr)
+{
+#if defined(__GNUC__)
+    __builtin_prefetch(ptr);
+#else
+    (void)ptr;
+#endif
+}
+
+// seed of the wyhash functions without seed parameter; it is one variable of the whole program (a
+// weak definition in every translation unit, which the linker merges), so that a seed that is set
+// in one translation unit is used by the tables of all of them
+[[gnu::weak]] uint64_t x__hash_seed = 0;
+
+// set the seed of the wyhash functions without seed parameter; set it to a random value at program
+// start to protect hash tables against hash flooding (but do not change it while they still
+// contain items)
+static void hash_set_seed(uint64_t seed)
+{
+    x__hash_seed = seed;
+}
+
+// return the seed of the wyhash functions without seed parameter
+static uint64_t hash_get_seed(void)
+{
+    return x__hash_seed;
+}
+
+// return the low 64 bits of the 128-bit product of a and b, and store the high 64 bits in high
+static uint64_t x__hash_mul128(uint64_t a, uint64_t b, uint64_t *high)
+{
+#ifdef __SIZEOF_INT128__
+    const __uint128_t r = (__uint128_t)a * b;
+    *high = r >> 64;
+    return r;
+#else
+    const uint64_t a_lo = a & 0xffffffff, a_hi = a >> 32, b_lo = b & 0xffffffff, b_hi = b >> 32;
+    const uint64_t lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo, lo_hi = a_lo * b_hi;
+    const uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+    *high = a_hi * b_hi + (hi_lo >> 32) + (cross >> 32);
+    return (cross << 32) | (lo_lo & 0xffffffff);
+#endif
+}
+
+static void x__wyhash_mum(uint64_t *a, uint64_t *b)
+{
+    *a = x__hash_mul128(*a, *b, b);
+}
+
+static uint64_t x__wyhash_mix(uint64_t a, uint64_t b)
+{
+    x__wyhash_mum(&a, &b);
+    return a ^ b;
+}
+
+static uint64_t x__wyhash_read8(const unsigned char *byte)
+{
+    uint64_t word;
+    memcpy(&word, byte, sizeof(word));
+    return word;
+}
+
+static uint64_t x__wyhash_read4(const unsigned char *byte)
+{
+    uint32_t word;
+    memcpy(&word, byte, sizeof(word));
+    return word;
+}
+
+// wyhash by Wang Yi, which processes 16 bytes (or three independent streams of 16 bytes) per step
+static uint64_t memhash_wyhash_seed(const void *mem, long size, uint64_t seed)
+{
+    static const uint64_t secret[] = {0x2d358dccaa6c78a5, 0x8bb84b93962eacc9, 0x4b33a62ed433d4a3,
+                                      0x4d5a2da51de1aa47};
+    const unsigned char *byte = mem;
+    seed ^= x__wyhash_mix(seed ^ secret[0], secret[1]);
+    uint64_t a = 0, b = 0;
+    if (size <= 16) {
+        if (size >= 4) {
+            const long shift = (size >> 3) << 2;
+            a = (x__wyhash_read4(byte) << 32) | x__wyhash_read4(byte + shift);
+            b = (x__wyhash_read4(byte + size - 4) << 32) | x__wyhash_read4(byte + size - 4 - shift);
+        }
+        else if (size > 0) {
+            a = ((uint64_t)byte[0] << 16) | ((uint64_t)byte[size >> 1] << 8) | byte[size - 1];
+        }
+    }
+    else {
+        long i = size;
+        if (i >= 48) {
+            uint64_t seed1 = seed, seed2 = seed;
+            do {
+                seed = x__wyhash_mix(x__wyhash_read8(byte) ^ secret[1],
+                                     x__wyhash_read8(byte + 8) ^ seed);
+                seed1 = x__wyhash_mix(x__wyhash_read8(byte + 16) ^ secret[2],
+                                      x__wyhash_read8(byte + 24) ^ seed1);
+                seed2 = x__wyhash_mix(x__wyhash_read8(byte + 32) ^ secret[3],
+                                      x__wyhash_read8(byte + 40) ^ seed2);
+                byte += 48;
+                i -= 48;
+            } while (i >= 48);
+            seed ^= seed1 ^ seed2;
+        }
+        while (i > 16) {
+            seed = x__wyhash_mix(x__wyhash_read8(byte) ^ secret[1],
+                                 x__wyhash_read8(byte + 8) ^ seed);
+            byte += 16;
+            i -= 16;
+        }
+        a = x__wyhash_read8(byte + i - 16);
+        b = x__wyhash_read8(byte + i - 8);
+    }
+    a ^= secret[1];
+    b ^= seed;
+    x__wyhash_mum(&a, &b);
+    return x__wyhash_mix(a ^ secret[0] ^ size, b ^ secret[1]);
+}
+static uint64_t strhash_wyhash_seed(const char *str, uint64_t seed)
+{
+    return memhash_wyhash_seed(str, strlen(str), seed);
+}
+static uint64_t memhash_wyhash(const void *mem, long size)
+{
+    return memhash_wyhash_seed(mem, size, x__hash_seed);
+}
+static uint64_t strhash_wyhash(const char *str)
+{
+    return memhash_wyhash_seed(str, strlen(str), x__hash_seed);
+}
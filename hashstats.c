@@ -0,0 +1,43 @@
+// the counters are only compiled into the tables if this is defined before their headers
+#define HASH_STATS
+
+#include "dict.h"
+#include "hmap.h"
+#include "set.h"
+
+#include <stdio.h>
+
+int main(void)
+{
+    // create a hmap, a dict, and a set that count their probes
+    Hmap hmap = hmap_create(0, sizeof(long));
+    Dict dict = dict_create(0, sizeof(long));
+    Set set = set_create_full(0, sizeof(long), 0.75, memhash_wyhash, memcpy, 0, 0, SET_FLAT);
+
+    // insert the numbers 0 through 999
+    char key[32];
+    for (long i = 0; i < 1000; ++i) {
+        snprintf(key, sizeof(key), "%ld", i);
+        hmap_insert(&hmap, key, &i, 0);
+        dict_insert(&dict, key, &i, 0);
+        set_insert(&set, &i, 0);
+    }
+
+    // look up the numbers 0 through 1999, half of which are missing
+    for (long i = 0; i < 2000; ++i) {
+        snprintf(key, sizeof(key), "%ld", i);
+        hmap_find(&hmap, key);
+        dict_find(&dict, key);
+        set_find(&set, &i);
+    }
+
+    // print the counters
+    hmap_stats_print(stdout, &hmap);
+    dict_stats_print(stdout, &dict);
+    set_stats_print(stdout, &set);
+
+    // cleanup
+    hmap_clear(&hmap);
+    dict_clear(&dict);
+    set_clear(&set);
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <assert.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "allocator.h"
+
+// instrumentation counters of the hash tables of hmap.h, dict.h, and set.h; they are only compiled
+// into the tables if HASH_STATS is defined before these headers are included, so that the tables
+// pay nothing for them otherwise; the counters are shared by the current and the old table during
+// an incremental resize, and are reset by the clear functions; they are plain (not atomic) counters
+// that are updated by lookups as well, so that a table must not be read by several threads at once
+// while they are compiled in (which is why chmap.h rejects HASH_STATS)
+typedef struct HashStats HashStats;
+
+// number of buckets of the probe length histograms; the last bucket also counts all longer probes
+enum { HASH_STATS_PROBE = 16 };
+
+// the probe length of an operation is the number of items whose hash is compared (in swiss mode,
+// the number of groups whose tags are matched); the lookups include the ones of remove
+struct HashStats {
+    long find[HASH_STATS_PROBE], insert[HASH_STATS_PROBE];
+    long find_probes, insert_probes;
+    long key_compare, hash_reject;
+    long resize;
+    double resize_time;
+    long alloc_bytes;
+};
+
+#ifdef HASH_STATS
+#define X__HASH_STATS(...) __VA_ARGS__
+#else
+#define X__HASH_STATS(...)
+#endif
+
+// allocate the counters of a table, unless they already exist
+static HashStats *x__hash_stats_create(HashStats *stats, const Allocator *alloc)
+{
+    if (stats) return stats;
+    stats = allocator_alloc(alloc, 1, sizeof(*stats), 1);
+    assert(stats);
+    return stats;
+}
+
+// count a comparison of a stored hash: if it matches, the keys are compared, otherwise the item is
+// rejected without touching its key
+static void x__hash_stats_compare(HashStats *stats, int match)
+{
+    if (match)
+        stats->key_compare += 1;
+    else
+        stats->hash_reject += 1;
+}
+
+// add the probe length of an operation that just finished to a histogram; the operation counts its
+// probe length in a local variable, so that the counters are only touched once it is done
+static void x__hash_stats_count(long *histogram, long *probes, long probe)
+{
+    histogram[probe < HASH_STATS_PROBE ? probe : HASH_STATS_PROBE - 1] += 1;
+    *probes += probe;
+}
+
+// count the probe length of a lookup that just finished
+static void x__hash_stats_find(HashStats *stats, long probe)
+{
+    x__hash_stats_count(stats->find, &stats->find_probes, probe);
+}
+
+// count the probe length of an insert that just finished
+static void x__hash_stats_insert(HashStats *stats, long probe)
+{
+    x__hash_stats_count(stats->insert, &stats->insert_probes, probe);
+}
+
+static double x__hash_stats_now(void)
+{
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static void x__hash_stats_resize(HashStats *stats, double start)
+{
+    stats->resize += 1;
+    stats->resize_time += x__hash_stats_now() - start;
+}
+
+static void x__hash_stats_alloc(HashStats *stats, long bytes)
+{
+    stats->alloc_bytes += bytes;
+}
+
+static long x__hash_stats_total(const long *histogram)
+{
+    long total = 0;
+    for (long i = 0; i < HASH_STATS_PROBE; ++i) total += histogram[i];
+    return total;
+}
+
+// print the counters to file (the part that is common to all tables)
+static void x__hash_stats_print(FILE *file, const HashStats *stats)
+{
+    const long finds = x__hash_stats_total(stats->find);
+    const long inserts = x__hash_stats_total(stats->insert);
+    fprintf(file, "%-8s %12ld, %8.3f probes on average\n", "finds", finds,
+            (finds ? (double)stats->find_probes / finds : 0));
+    fprintf(file, "%-8s %12ld, %8.3f probes on average\n", "inserts", inserts,
+            (inserts ? (double)stats->insert_probes / inserts : 0));
+    long last = 0;
+    for (long i = 0; i < HASH_STATS_PROBE; ++i)
+        if (stats->find[i] || stats->insert[i]) last = i;
+    fprintf(file, "%8s %12s %12s\n", "probes", "finds", "inserts");
+    for (long i = 0; i <= last; ++i)
+        fprintf(file, "%7ld%c %12ld %12ld\n", i, (i == HASH_STATS_PROBE - 1 ? '+' : ' '),
+                stats->find[i], stats->insert[i]);
+    fprintf(file, "%-16s %12ld\n", "key compares", stats->key_compare);
+    fprintf(file, "%-16s %12ld\n", "hash rejects", stats->hash_reject);
+    fprintf(file, "%-16s %12ld, %.6f s\n", "resizes", stats->resize, stats->resize_time);
+    fprintf(file, "%-16s %12ld\n", "bytes allocated", stats->alloc_bytes);
+}
@@ -4,6 +4,9 @@
 
 #define ABS(a) ((a) >= 0 ? (a) : -(a))
 
+// define a typed heap of integers
+HEAP_DEFINE(IntHeap, int)
+
 int main(void)
 {
     // create a heap that stores integers
@@ -32,7 +35,79 @@ int main(void)
     printf("a.peek() = %d\n", *(int *)heap_peek(&a));
     printf("b.peek() = %d\n", *(int *)heap_peek(&b));
 
+    // create a flat heap that stores integers inline, with the same priorities as heap a
+    Heap c = heap_create_full(10, sizeof(int), memcpy, 0, 0, HEAP_FLAT);
+    for (int i = 0; i < 10; ++i) heap_push(&c, -ABS(i - 2.1), &i);
+
+    // pop highest priority item from heap c (the data must not be freed)
+    printf("c.pop() = %d\n", *(int *)heap_pop(&c));
+
+    // print items of heap c
+    printf("c = [");
+    HeapForEachFlat(item, &c) printf("%g: %d, ", item->priority, *(int *)item->data);
+    printf("]\n");
+
+    // create a typed heap of integers, with the same priorities as heap a
+    IntHeap d = IntHeap_create(10, 0);
+    for (int i = 0; i < 10; ++i) IntHeap_push(&d, -ABS(i - 2.1), i);
+
+    // pop the highest priority item from heap d, and peek at the next one
+    printf("d.pop() = %d\n", IntHeap_pop(&d));
+    printf("d.peek() = %d\n", *IntHeap_peek(&d));
+
+    // create an indexed heap of integers, whose priorities can be changed through their handles
+    Heap e = heap_create_full(10, sizeof(int), memcpy, free, 0, HEAP_INDEXED);
+    long handle[10];
+    for (int i = 0; i < 10; ++i) handle[i] = heap_push(&e, i, &i);
+
+    // raise the priority of integer 3 to the top, lower the priority of integer 9 to the bottom,
+    // and remove integer 8
+    heap_update(&e, handle[3], 100);
+    heap_update(&e, handle[9], -1);
+    free(heap_remove(&e, handle[8]));
+    printf("e.contains(8) = %d\n", heap_contains(&e, handle[8]));
+    printf("e.priority(9) = %g\n", heap_priority(&e, handle[9]));
+
+    // pop all items from heap e
+    printf("e.pop() = [");
+    while (e.size > 0) {
+        int *data = heap_pop(&e);
+        printf("%d, ", *data);
+        free(data);
+    }
+    printf("]\n");
+
+    // create a heap from integers 0 through 9 and their priorities at once
+    int value[10];
+    double priority[10];
+    for (int i = 0; i < 10; ++i) {
+        value[i] = i;
+        priority[i] = -ABS(i - 6.1);
+    }
+    Heap f = heap_create_from(10, sizeof(int), priority, value);
+    printf("f.peek() = %d\n", *(int *)heap_peek(&f));
+
+    // create a flat 8-ary heap from the same integers and priorities at once
+    Heap h = heap_create_from_full(10, sizeof(int), priority, value, memcpy, 0, 0,
+                                   HEAP_FLAT | HEAP_ARITY_8);
+    printf("h.peek() = %d\n", *(int *)heap_peek(&h));
+
+    // keep the three integers with the lowest priorities in a flat 4-ary heap, by pushing every
+    // integer and popping the highest priority one at the same time
+    Heap g = heap_create_full(3, sizeof(int), memcpy, 0, 0, HEAP_FLAT | HEAP_ARITY_4);
+    for (int i = 0; i < 3; ++i) heap_push(&g, priority[i], &value[i]);
+    for (int i = 3; i < 10; ++i) heap_pushpop(&g, priority[i], &value[i]);
+    printf("g = [");
+    HeapForEachFlat(item, &g) printf("%g: %d, ", item->priority, *(int *)item->data);
+    printf("]\n");
+
     // clear items
     heap_clear(&a);
     heap_clear(&b);
+    heap_clear(&c);
+    IntHeap_clear(&d);
+    heap_clear(&e);
+    heap_clear(&f);
+    heap_clear(&g);
+    heap_clear(&h);
 }
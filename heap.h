@@ -4,17 +4,33 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "allocator.h"
+
 // general purpose priority queue
 typedef struct Heap Heap;
 typedef struct HeapItem HeapItem;
+typedef struct HeapFlatItem HeapFlatItem;
 typedef void *HeapDataCopy(void *, const void *, size_t);
 typedef void HeapDataFree(void *);
 
+// store data inline in one contiguous buffer instead of one allocation per item; or track the
+// position of every item, so that heap_push returns a handle that identifies the item until it is
+// removed, and that can be passed to heap_update and heap_remove; or give every item 4 or 8
+// children instead of 2, so that the heap is shallower and the children of an item are adjacent in
+// memory (a 4-ary heap of pointer items has 64 bytes of children per item)
+enum { HEAP_FLAT = 1 << 0, HEAP_INDEXED = 1 << 1, HEAP_ARITY_4 = 1 << 2, HEAP_ARITY_8 = 1 << 3 };
+
 struct Heap {
-    long size, capacity, data_size;
+    long size, capacity, data_size, item_size;
+    int flags, arity_log2;
     HeapDataCopy *data_copy;
     HeapDataFree *data_free;
-    HeapItem *item;
+    Allocator alloc;
+    union {
+        HeapItem *item;
+        void *data;
+    };
+    long *handle, *position, handle_count, free_handle;
 };
 
 struct HeapItem {
@@ -22,58 +38,248 @@ struct HeapItem {
     void *data;
 };
 
+struct HeapFlatItem {
+    double priority;
+    char data[];
+};
+
 #define HeapForEach(item, heap) \
     for (HeapItem *item = (heap)->item; item < (heap)->item + (heap)->size; ++item)
 
-// create an empty heap
+#define HeapForEachFlat(item, heap)                                                     \
+    for (HeapFlatItem *item = (heap)->data;                                             \
+         (char *)item < (char *)(heap)->data + (heap)->size * (heap)->item_size;        \
+         item = (HeapFlatItem *)((char *)item + (heap)->item_size))
+
+// create an empty heap; in flat mode, data_copy is required and data_free must not free the data
 static Heap heap_create_full(long capacity, long data_size, HeapDataCopy *data_copy,
-                             HeapDataFree *data_free)
+                             HeapDataFree *data_free, const Allocator *alloc, int flags)
 {
     assert(capacity >= 0);
     assert(data_size >= 0);
+    assert(!(flags & HEAP_FLAT) || data_copy);
+    assert(!(flags & HEAP_ARITY_4) || !(flags & HEAP_ARITY_8));
+    const long align = alignof(HeapFlatItem);
+    const long flat_size = (sizeof(HeapFlatItem) + data_size + align - 1) / align * align;
     return (Heap){
         .capacity = capacity,
         .data_size = data_size,
+        .item_size = (flags & HEAP_FLAT ? flat_size : (long)sizeof(HeapItem)),
+        .flags = flags,
+        .arity_log2 = (flags & HEAP_ARITY_8 ? 3 : flags & HEAP_ARITY_4 ? 2 : 1),
         .data_copy = data_copy,
         .data_free = data_free,
+        .alloc = (alloc ? *alloc : allocator_std),
+        .free_handle = -1,
     };
 }
 static Heap heap_create(long capacity, long data_size)
 {
-    return heap_create_full(capacity, data_size, memcpy, free);
+    return heap_create_full(capacity, data_size, memcpy, free, 0, 0);
+}
+
+static long x__heap_slots(const Heap *heap)
+{
+    return heap->capacity + (heap->flags & HEAP_FLAT ? 1 : 0);
+}
+
+// in indexed mode, handle[i] is the handle of the item at position i, and position[h] is the
+// position of the item with handle h; the position of a released handle encodes the next released
+// handle h as -2 - h (or -1 at the end of the list)
+static void x__heap_resize_index(Heap *heap)
+{
+    if (!(heap->flags & HEAP_INDEXED)) return;
+    const long size = heap->capacity * sizeof(long);
+    heap->handle = allocator_realloc(&heap->alloc, heap->handle, size);
+    heap->position = allocator_realloc(&heap->alloc, heap->position, size);
+    assert(heap->handle && heap->position);
 }
 
 static void x__heap_create_items(Heap *heap)
 {
-    heap->item = calloc(heap->capacity, sizeof(*heap->item));
-    assert(heap->item);
+    heap->data = allocator_alloc(&heap->alloc, x__heap_slots(heap), heap->item_size, 1);
+    assert(heap->data);
+    x__heap_resize_index(heap);
+}
+
+static void x__heap_reserve_items(Heap *heap, long capacity)
+{
+    heap->capacity = capacity;
+    heap->data = allocator_realloc(&heap->alloc, heap->data, x__heap_slots(heap) * heap->item_size);
+    assert(heap->data);
+    x__heap_resize_index(heap);
 }
 
 static void x__heap_resize_items(Heap *heap)
 {
     assert(heap);
-    heap->capacity = 2 * heap->capacity + 1;
-    heap->item = realloc(heap->item, heap->capacity * sizeof(*heap->item));
-    assert(heap->item);
+    x__heap_reserve_items(heap, 2 * heap->capacity + 1);
+}
+
+static long x__heap_handle_create(Heap *heap)
+{
+    const long handle = heap->free_handle;
+    if (handle < 0) return heap->handle_count++;
+    heap->free_handle = -2 - heap->position[handle];
+    return handle;
+}
+
+static void x__heap_handle_free(Heap *heap, long handle)
+{
+    heap->position[handle] = -2 - heap->free_handle;
+    heap->free_handle = handle;
+}
+
+static HeapFlatItem *x__heap_flat_item(const Heap *heap, long i)
+{
+    return (HeapFlatItem *)((char *)heap->data + i * heap->item_size);
+}
+
+// both kinds of items start with their priority
+static double x__heap_priority(const Heap *heap, long i)
+{
+    double priority;
+    memcpy(&priority, (char *)heap->data + i * heap->item_size, sizeof(priority));
+    return priority;
+}
+
+// in indexed mode, the handle of a moved item follows it, and its position is updated
+static void x__heap_move_handle(long *handle, long *position, long dst, long src)
+{
+    if (!handle) return;
+    handle[dst] = handle[src];
+    position[handle[dst]] = dst;
 }
 
-static long x__heap_sift_up(HeapItem *item, long size, double priority)
+// move the item at position src to position dst
+static void x__heap_move(const Heap *heap, long dst, long src)
 {
-    long i = size;
+    if (heap->flags & HEAP_FLAT)
+        memcpy(x__heap_flat_item(heap, dst), x__heap_flat_item(heap, src), heap->item_size);
+    else
+        heap->item[dst] = heap->item[src];
+    x__heap_move_handle(heap->handle, heap->position, dst, src);
+}
+
+static long x__heap_flat_sift_up(const Heap *heap, long i, double priority)
+{
+    long *handle = heap->handle, *position = heap->position;
+    const int arity_log2 = heap->arity_log2;
+    while (i > 0) {
+        const long parent = (i - 1) >> arity_log2;
+        if (priority <= x__heap_flat_item(heap, parent)->priority) break;
+        memcpy(x__heap_flat_item(heap, i), x__heap_flat_item(heap, parent), heap->item_size);
+        x__heap_move_handle(handle, position, i, parent);
+        i = parent;
+    }
+    return i;
+}
+
+static long x__heap_flat_sift_down(const Heap *heap, long i, long size, double priority)
+{
+    long *handle = heap->handle, *position = heap->position, first;
+    const int arity_log2 = heap->arity_log2;
+    if (!handle && arity_log2 == 1) {
+        while ((first = 2 * i + 1) < size) {
+            const long right = first + 1;
+            const long largest = (right < size && x__heap_flat_item(heap, right)->priority >
+                                                      x__heap_flat_item(heap, first)->priority
+                                      ? right
+                                      : first);
+            if (priority >= x__heap_flat_item(heap, largest)->priority) break;
+            memcpy(x__heap_flat_item(heap, i), x__heap_flat_item(heap, largest), heap->item_size);
+            i = largest;
+        }
+        return i;
+    }
+    while ((first = (i << arity_log2) + 1) < size) {
+        const long end = (first + (1L << arity_log2) < size ? first + (1L << arity_log2) : size);
+        long largest = first;
+        for (long child = first + 1; child < end; ++child)
+            largest = (x__heap_flat_item(heap, child)->priority >
+                               x__heap_flat_item(heap, largest)->priority
+                           ? child
+                           : largest);
+        if (priority >= x__heap_flat_item(heap, largest)->priority) break;
+        memcpy(x__heap_flat_item(heap, i), x__heap_flat_item(heap, largest), heap->item_size);
+        x__heap_move_handle(handle, position, i, largest);
+        i = largest;
+    }
+    return i;
+}
+
+// move the parents of position i down until an item with a given priority fits into position i,
+// and return that position
+static long x__heap_sift_up(const Heap *heap, long i, double priority)
+{
+    if (heap->flags & HEAP_FLAT) return x__heap_flat_sift_up(heap, i, priority);
+    HeapItem *item = heap->item;
+    long *handle = heap->handle, *position = heap->position;
+    const int arity_log2 = heap->arity_log2;
     while (i > 0) {
-        const long parent = (i - 1) / 2;
+        const long parent = (i - 1) >> arity_log2;
         if (priority <= item[parent].priority) break;
         item[i] = item[parent];
+        x__heap_move_handle(handle, position, i, parent);
         i = parent;
     }
     return i;
 }
 
-static void x__heap_item_create(const Heap *heap, HeapItem *item, double priority, void *data)
+// move the children of position i up until an item with a given priority fits into position i,
+// and return that position; binary heaps without handles, which are the most common ones, take a
+// shorter loop
+static long x__heap_sift_down(const Heap *heap, long i, long size, double priority)
+{
+    if (heap->flags & HEAP_FLAT) return x__heap_flat_sift_down(heap, i, size, priority);
+    HeapItem *item = heap->item;
+    long *handle = heap->handle, *position = heap->position, first;
+    const int arity_log2 = heap->arity_log2;
+    if (!handle && arity_log2 == 1) {
+        while ((first = 2 * i + 1) < size) {
+            const long right = first + 1;
+            const long largest =
+                (right < size && item[right].priority > item[first].priority ? right : first);
+            if (priority >= item[largest].priority) break;
+            item[i] = item[largest];
+            i = largest;
+        }
+        return i;
+    }
+    while ((first = (i << arity_log2) + 1) < size) {
+        const long end = first + (1L << arity_log2);
+        long largest = first;
+        for (long child = first + 1; child < end && child < size; ++child)
+            largest = (item[child].priority > item[largest].priority ? child : largest);
+        if (priority >= item[largest].priority) break;
+        item[i] = item[largest];
+        x__heap_move_handle(handle, position, i, largest);
+        i = largest;
+    }
+    return i;
+}
+
+// move the item at position i to the position where an item with a given priority fits, and return
+// that position
+static long x__heap_sift(Heap *heap, long i, long size, double priority)
+{
+    const long j = x__heap_sift_up(heap, i, priority);
+    return (j != i ? j : x__heap_sift_down(heap, i, size, priority));
+}
+
+static void x__heap_item_create(Heap *heap, long i, double priority, void *data)
 {
+    if (heap->flags & HEAP_FLAT) {
+        assert(data);
+        HeapFlatItem *item = x__heap_flat_item(heap, i);
+        item->priority = priority;
+        heap->data_copy(item->data, data, heap->data_size);
+        return;
+    }
+    HeapItem *item = &heap->item[i];
     item->priority = priority;
     if (heap->data_copy) {
-        item->data = malloc(heap->data_size);
+        item->data = allocator_alloc(&heap->alloc, 1, heap->data_size, 0);
         assert(item->data);
         heap->data_copy(item->data, data, heap->data_size);
     }
@@ -82,55 +288,196 @@ static void x__heap_item_create(const Heap *heap, HeapItem *item, double priorit
     }
 }
 
-// push an item with a given priority
-static void heap_push(Heap *heap, double priority, void *data)
+// give the item at position i a handle in indexed mode, and return it (and -1 otherwise)
+static long x__heap_handle_assign(Heap *heap, long i)
+{
+    if (!(heap->flags & HEAP_INDEXED)) return -1;
+    const long handle = x__heap_handle_create(heap);
+    heap->handle[i] = handle;
+    heap->position[handle] = i;
+    return handle;
+}
+
+// give the item at position i a given priority, and move it to the position where it fits; unless
+// up is set, the item is only moved down
+static void x__heap_fix(Heap *heap, long i, double priority, int up)
+{
+    const long handle = (heap->handle ? heap->handle[i] : -1);
+    long j;
+    if (heap->flags & HEAP_FLAT) {
+        HeapFlatItem *scratch = x__heap_flat_item(heap, heap->capacity);
+        memcpy(scratch, x__heap_flat_item(heap, i), heap->item_size);
+        scratch->priority = priority;
+        j = (up ? x__heap_sift(heap, i, heap->size, priority)
+                : x__heap_sift_down(heap, i, heap->size, priority));
+        memcpy(x__heap_flat_item(heap, j), scratch, heap->item_size);
+    }
+    else {
+        const HeapItem item = {priority, heap->item[i].data};
+        j = (up ? x__heap_sift(heap, i, heap->size, priority)
+                : x__heap_sift_down(heap, i, heap->size, priority));
+        heap->item[j] = item;
+    }
+    if (handle < 0) return;
+    heap->handle[j] = handle;
+    heap->position[handle] = j;
+}
+
+// push an item with a given priority; return its handle in indexed mode (and -1 otherwise)
+static long heap_push(Heap *heap, double priority, void *data)
 {
     assert(heap);
     if (!heap->item) x__heap_create_items(heap);
     if (heap->size + 1 > heap->capacity) x__heap_resize_items(heap);
-    const long i = x__heap_sift_up(heap->item, heap->size, priority);
-    x__heap_item_create(heap, &heap->item[i], priority, data);
+    const long i = x__heap_sift_up(heap, heap->size, priority);
+    x__heap_item_create(heap, i, priority, data);
     heap->size += 1;
+    return x__heap_handle_assign(heap, i);
+}
+
+// restore the heap order in O(size) time, for example after the priorities of many items were
+// changed through HeapForEach
+static void heap_heapify(Heap *heap)
+{
+    assert(heap);
+    if (heap->size < 2) return;
+    for (long i = (heap->size - 2) >> heap->arity_log2; i >= 0; --i)
+        x__heap_fix(heap, i, x__heap_priority(heap, i), 0);
+}
+
+// push count items with given priorities, whose data is stored in count * data_size consecutive
+// bytes, with at most one resize; in indexed mode, their handles are stored in handle (unless it is
+// 0); if there are at least as many new items as old ones, the heap order is restored by
+// heap_heapify instead of pushing the items one by one
+static void heap_push_many(Heap *heap, const double *priority, void *data, long count, long *handle)
+{
+    assert(heap);
+    assert(count >= 0);
+    assert((priority && data) || count == 0);
+    const long capacity = heap->size + count;
+    if (!heap->item) {
+        if (capacity > heap->capacity) heap->capacity = capacity;
+        x__heap_create_items(heap);
+    }
+    else if (capacity > heap->capacity) {
+        const long grown = 2 * heap->capacity + 1;
+        x__heap_reserve_items(heap, (capacity > grown ? capacity : grown));
+    }
+    const int heapify = (count >= heap->size);
+    for (long k = 0; k < count; ++k) {
+        const long i = (heapify ? heap->size : x__heap_sift_up(heap, heap->size, priority[k]));
+        x__heap_item_create(heap, i, priority[k], (char *)data + k * heap->data_size);
+        heap->size += 1;
+        const long h = x__heap_handle_assign(heap, i);
+        if (handle) handle[k] = h;
+    }
+    if (heapify) heap_heapify(heap);
+}
+
+// create a heap from count items with given priorities, whose data is stored in count * data_size
+// consecutive bytes, in O(count) time; the other parameters are those of heap_create_full, and in
+// indexed mode, item k gets handle k
+static Heap heap_create_from_full(long count, long data_size, const double *priority, void *data,
+                                  HeapDataCopy *data_copy, HeapDataFree *data_free,
+                                  const Allocator *alloc, int flags)
+{
+    Heap heap = heap_create_full(count, data_size, data_copy, data_free, alloc, flags);
+    heap_push_many(&heap, priority, data, count, 0);
+    return heap;
+}
+static Heap heap_create_from(long count, long data_size, const double *priority, void *data)
+{
+    return heap_create_from_full(count, data_size, priority, data, memcpy, free, 0, 0);
 }
 
-// return a copy of the heap
+// return a copy of the heap; in indexed mode, the items of the copy have the same handles
 static Heap heap_copy(const Heap *heap)
 {
     assert(heap);
-    Heap copy = heap_create_full(heap->capacity, heap->data_size, heap->data_copy, heap->data_free);
+    Heap copy = heap_create_full(heap->capacity, heap->data_size, heap->data_copy, heap->data_free,
+                                 &heap->alloc, heap->flags);
     if (heap->size == 0) return copy;
-    for (const HeapItem *item = heap->item; item < heap->item + heap->size; ++item)
-        heap_push(&copy, item->priority, item->data);
+    x__heap_create_items(&copy);
+    memcpy(copy.data, heap->data, heap->size * heap->item_size);
+    copy.size = heap->size;
+    if (heap->flags & HEAP_FLAT) {
+        if (heap->data_copy != memcpy)
+            for (long i = 0; i < heap->size; ++i)
+                heap->data_copy(x__heap_flat_item(&copy, i)->data,
+                                x__heap_flat_item(heap, i)->data, heap->data_size);
+    }
+    else if (heap->data_copy) {
+        for (long i = 0; i < heap->size; ++i)
+            x__heap_item_create(&copy, i, heap->item[i].priority, heap->item[i].data);
+    }
+    if (heap->flags & HEAP_INDEXED) {
+        memcpy(copy.handle, heap->handle, heap->size * sizeof(long));
+        memcpy(copy.position, heap->position, heap->handle_count * sizeof(long));
+        copy.handle_count = heap->handle_count;
+        copy.free_handle = heap->free_handle;
+    }
     return copy;
 }
 
-static long x__heap_sift_down(HeapItem *item, long size, double priority)
+// remove the item at position i, and return its data; a flat item is moved to the scratch slot past
+// the capacity
+static void *x__heap_remove(Heap *heap, long i)
 {
-    long i = 0, left;
-    while ((left = 2 * i + 1) < size) {
-        const long right = left + 1;
-        const long largest =
-            (right < size && item[right].priority > item[left].priority ? right : left);
-        if (priority >= item[largest].priority) break;
-        item[i] = item[largest];
-        i = largest;
+    void *data;
+    if (heap->flags & HEAP_FLAT) {
+        HeapFlatItem *scratch = x__heap_flat_item(heap, heap->capacity);
+        memcpy(scratch, x__heap_flat_item(heap, i), heap->item_size);
+        data = scratch->data;
     }
-    return i;
+    else {
+        data = heap->item[i].data;
+    }
+    if (heap->flags & HEAP_INDEXED) x__heap_handle_free(heap, heap->handle[i]);
+    heap->size -= 1;
+    if (i < heap->size) {
+        const long last = heap->size;
+        const double priority = x__heap_priority(heap, last);
+        const long j = (i == 0 ? x__heap_sift_down(heap, 0, last, priority)
+                               : x__heap_sift(heap, i, last, priority));
+        x__heap_move(heap, j, last);
+    }
+    return data;
 }
 
-// remove the item with the highest priority, and return its data
+// remove the item with the highest priority, and return its data; in flat mode, the data is only
+// valid until the heap is modified again
 static void *heap_pop(Heap *heap)
 {
     assert(heap);
     if (heap->size == 0) return 0;
-    void *data = heap->item[0].data;
-    heap->size -= 1;
-    if (heap->size > 0) {
-        const double priority = heap->item[heap->size].priority;
-        const long i = x__heap_sift_down(heap->item, heap->size, priority);
-        heap->item[i] = heap->item[heap->size];
+    return x__heap_remove(heap, 0);
+}
+
+// push an item and pop the item with the highest priority in one step, which keeps the size (as to
+// select the top-k items); if the new item would be popped right away, it is not pushed, and data
+// itself is returned; in indexed mode, the new item takes over the handle of the popped item; in
+// flat mode, the data is only valid until the heap is modified again
+static void *heap_pushpop(Heap *heap, double priority, void *data)
+{
+    assert(heap);
+    if (heap->size == 0 || priority >= x__heap_priority(heap, 0)) return data;
+    void *top;
+    if (heap->flags & HEAP_FLAT) {
+        HeapFlatItem *scratch = x__heap_flat_item(heap, heap->capacity);
+        memcpy(scratch, x__heap_flat_item(heap, 0), heap->item_size);
+        top = scratch->data;
     }
-    return data;
+    else {
+        top = heap->item[0].data;
+    }
+    const long handle = (heap->handle ? heap->handle[0] : -1);
+    const long i = x__heap_sift_down(heap, 0, heap->size, priority);
+    x__heap_item_create(heap, i, priority, data);
+    if (handle >= 0) {
+        heap->handle[i] = handle;
+        heap->position[handle] = i;
+    }
+    return top;
 }
 
 // return the data of the first item with the highest priority
@@ -138,16 +485,137 @@ static void *heap_peek(const Heap *heap)
 {
     assert(heap);
     if (heap->size == 0) return 0;
+    if (heap->flags & HEAP_FLAT) return x__heap_flat_item(heap, 0)->data;
     return heap->item[0].data;
 }
 
+// return whether the item with a given handle is still in the heap (indexed mode)
+static int heap_contains(const Heap *heap, long handle)
+{
+    assert(heap);
+    assert(heap->flags & HEAP_INDEXED);
+    return (0 <= handle && handle < heap->handle_count && heap->position[handle] >= 0);
+}
+
+// return the priority of the item with a given handle (indexed mode)
+static double heap_priority(const Heap *heap, long handle)
+{
+    assert(heap_contains(heap, handle));
+    return x__heap_priority(heap, heap->position[handle]);
+}
+
+// change the priority of the item with a given handle, and restore the heap order (indexed mode)
+static void heap_update(Heap *heap, long handle, double priority)
+{
+    assert(heap_contains(heap, handle));
+    x__heap_fix(heap, heap->position[handle], priority, 1);
+}
+
+// remove the item with a given handle, and return its data (indexed mode); in flat mode, the data
+// is only valid until the heap is modified again
+static void *heap_remove(Heap *heap, long handle)
+{
+    assert(heap_contains(heap, handle));
+    return x__heap_remove(heap, heap->position[handle]);
+}
+
 // remove all items from the heap
 static void heap_clear(Heap *heap)
 {
     assert(heap);
-    if (heap->size == 0) return;
-    if (heap->data_free)
-        for (long i = 0; i < heap->size; ++i) heap->data_free(heap->item[i].data);
-    free(heap->item);
+    if (!heap->data) return;
+    if (heap->data_free) {
+        for (long i = 0; i < heap->size; ++i)
+            heap->data_free(heap->flags & HEAP_FLAT ? x__heap_flat_item(heap, i)->data
+                                                    : heap->item[i].data);
+    }
+    allocator_free(&heap->alloc, heap->data);
+    allocator_free(&heap->alloc, heap->handle);
+    allocator_free(&heap->alloc, heap->position);
     *heap = (Heap){0};
 }
+
+// define a typed heap `name` of items of type T; the functions mirror the generic ones, but take
+// and return items by value, and the item type is known at compile time
+#define HEAP_DEFINE(name, T)                                                                     \
+    typedef struct name name;                                                                    \
+    typedef struct name##Item name##Item;                                                        \
+    struct name {                                                                                \
+        long size, capacity;                                                                     \
+        Allocator alloc;                                                                         \
+        name##Item *item;                                                                        \
+    };                                                                                           \
+    struct name##Item {                                                                          \
+        double priority;                                                                         \
+        T data;                                                                                  \
+    };                                                                                           \
+    [[maybe_unused]] static name name##_create(long capacity, const Allocator *alloc)            \
+    {                                                                                            \
+        assert(capacity >= 0);                                                                   \
+        return (name){.capacity = capacity, .alloc = (alloc ? *alloc : allocator_std)};          \
+    }                                                                                            \
+    [[maybe_unused]] static void name##_push(name *heap, double priority, T data)                \
+    {                                                                                            \
+        assert(heap);                                                                            \
+        if (heap->size + 1 > heap->capacity || !heap->item) {                                    \
+            heap->capacity = 2 * heap->capacity + 1;                                             \
+            heap->item = allocator_realloc(&heap->alloc, heap->item,                             \
+                                           heap->capacity * sizeof(name##Item));                 \
+            assert(heap->item);                                                                  \
+        }                                                                                        \
+        long i = heap->size;                                                                     \
+        while (i > 0) {                                                                          \
+            const long parent = (i - 1) / 2;                                                     \
+            if (priority <= heap->item[parent].priority) break;                                  \
+            heap->item[i] = heap->item[parent];                                                  \
+            i = parent;                                                                          \
+        }                                                                                        \
+        heap->item[i] = (name##Item){.priority = priority, .data = data};                        \
+        heap->size += 1;                                                                         \
+    }                                                                                            \
+    [[maybe_unused]] static name name##_copy(const name *heap)                                   \
+    {                                                                                            \
+        assert(heap);                                                                            \
+        name copy = name##_create(heap->size, &heap->alloc);                                     \
+        if (heap->size == 0) return copy;                                                        \
+        copy.item = allocator_alloc(&copy.alloc, copy.capacity, sizeof(name##Item), 0);          \
+        assert(copy.item);                                                                       \
+        memcpy(copy.item, heap->item, heap->size * sizeof(name##Item));                          \
+        copy.size = heap->size;                                                                  \
+        return copy;                                                                             \
+    }                                                                                            \
+    [[maybe_unused]] static T name##_pop(name *heap)                                             \
+    {                                                                                            \
+        assert(heap);                                                                            \
+        assert(heap->size > 0);                                                                  \
+        const T data = heap->item[0].data;                                                       \
+        heap->size -= 1;                                                                         \
+        const name##Item last = heap->item[heap->size];                                          \
+        long i = 0, left;                                                                        \
+        while ((left = 2 * i + 1) < heap->size) {                                                \
+            const long right = left + 1;                                                         \
+            const long largest =                                                                 \
+                (right < heap->size && heap->item[right].priority > heap->item[left].priority    \
+                     ? right                                                                     \
+                     : left);                                                                    \
+            if (last.priority >= heap->item[largest].priority) break;                            \
+            heap->item[i] = heap->item[largest];                                                 \
+            i = largest;                                                                         \
+        }                                                                                        \
+        heap->item[i] = last;                                                                    \
+        return data;                                                                             \
+    }                                                                                            \
+    [[maybe_unused]] static T *name##_peek(const name *heap)                                     \
+    {                                                                                            \
+        assert(heap);                                                                            \
+        return (heap->size > 0 ? &heap->item[0].data : 0);                                       \
+    }                                                                                            \
+    [[maybe_unused]] static void name##_clear(name *heap)                                        \
+    {                                                                                            \
+        assert(heap);                                                                            \
+        allocator_free(&heap->alloc, heap->item);                                                \
+        *heap = (name){0};                                                                       \
+    }
+
+#define HeapForEachTyped(item, heap) \
+    for (typeof((heap)->item) item = (heap)->item; item < (heap)->item + (heap)->size; ++item)
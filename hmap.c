@@ -2,6 +2,39 @@
 
 #include <stdio.h>
 
+// string equality function
+int streq(const char *a, const char *b)
+{
+    return !strcmp(a, b);
+}
+
+// define a typed hmap from strings to integers
+HMAP_DEFINE(StrIntMap, const char *, int, strhash_fnv1a, streq)
+
+// binary key of an IPv4 address and a port
+typedef struct {
+    uint32_t addr;
+    uint16_t port, pad;
+} Endpoint;
+
+// binary key of 16 bytes, with hash and equality functions
+typedef struct {
+    uint64_t hi, lo;
+} Uuid;
+
+uint64_t uuid_hash(Uuid key)
+{
+    return memhash_wyhash(&key, sizeof(key));
+}
+
+int uuid_eq(Uuid a, Uuid b)
+{
+    return a.hi == b.hi && a.lo == b.lo;
+}
+
+// define a typed hmap from 16-byte keys to integers, which stores the keys inline in its slots
+HMAP_DEFINE(UuidMap, Uuid, int, uuid_hash, uuid_eq)
+
 int main(void)
 {
     // create a hmap that stores integers
@@ -32,7 +65,106 @@ int main(void)
     printf("a.find(six) = %p\n", hmap_find(&a, "six"));
     printf("b.find(six) = %p\n", hmap_find(&b, "six"));
 
+    // create a typed hmap that maps the keys to integers (the keys are not copied)
+    StrIntMap c = StrIntMap_create(10, 0);
+    for (int i = 0; i < 10; ++i) StrIntMap_insert(&c, key[i], i, 0);
+
+    // remove the item with key "six" from hmap c
+    StrIntMap_remove(&c, "six", 0);
+
+    // print items of hmap c
+    printf("c = {");
+    HmapForEachTyped(item, &c) printf("%s: %d, ", item->key, item->data);
+    printf("}\n");
+
+    // print value of item with key "seven"
+    printf("c.find(seven) = %d\n", *StrIntMap_find(&c, "seven"));
+
+    // create a hmap that uses the swiss table backend, and insert the key-integer pairs
+    Hmap d = hmap_create_full(10, sizeof(int), 0.75, strhash_fnv1a, memcpy, free, 0, HMAP_SWISS);
+    for (long i = 0; i < 10; ++i) hmap_insert(&d, key[i], &i, 0);
+
+    // remove the item with key "six" from hmap d, and print the remaining items
+    free(hmap_remove(&d, "six"));
+    printf("d = {");
+    HmapForEach(item, &d) printf("%s: %d, ", item->key, *(int *)item->data);
+    printf("}\n");
+
+    // create a hmap that grows incrementally, and insert many items; the resizes only move a few
+    // slots with every insert, and find also checks the old table while the items are moved
+    Hmap e = hmap_create_full(0, sizeof(long), 0.75, strhash_wyhash, memcpy, free, 0,
+                              HMAP_INCREMENTAL);
+    for (long i = 0; i < 1000; ++i) {
+        char str[16];
+        snprintf(str, sizeof(str), "%ld", i);
+        hmap_insert(&e, str, &i, 0);
+    }
+    printf("e.size = %ld, e.find(999) = %ld\n", e.size, *(long *)hmap_find(&e, "999"));
+
+    // insert the key-integer pairs into a hmap at once, and find some of them at once
+    Hmap f = hmap_create(0, sizeof(int));
+    int value[10];
+    void *data[10];
+    for (int i = 0; i < 10; ++i) {
+        value[i] = i;
+        data[i] = &value[i];
+    }
+    hmap_insert_many(&f, key, data, 10, 0);
+    void *found[3];
+    hmap_find_many(&f, (const char *[]){"two", "ten", "four"}, found, 3);
+    printf("f.find_many(two, ten, four) = {%d, %p, %d}\n", *(int *)found[0], found[1],
+           *(int *)found[2]);
+
+    // replace the data of some keys at once; the hmap copies the new data and frees the old
+    int other[2] = {20, 40};
+    hmap_insert_many(&f, (const char *[]){"two", "four"}, (void *[]){&other[0], &other[1]}, 2, 0);
+    printf("f.find(two) = %d\n", *(int *)hmap_find(&f, "two"));
+
+    // create a hmap that borrows its keys from a buffer, where they are not terminated, and one
+    // that interns copies of them
+    const char *text = "alpha beta gamma beta alpha alpha";
+    Hmap g = hmap_create_full(0, sizeof(int), 0.75, strhash_wyhash, memcpy, free, 0, HMAP_BORROW);
+    Hmap h = hmap_create_full(0, 0, 0.75, strhash_wyhash, 0, 0, 0, HMAP_INTERN);
+    for (const char *word = text; *word;) {
+        const long size = strcspn(word, " ");
+        int *count = hmap_find_len(&g, word, size);
+        if (count)
+            *count += 1;
+        else
+            hmap_insert_len(&g, word, size, (int[]){1}, 0);
+        hmap_insert_len(&h, word, size, 0, 1);
+        word += size + (word[size] == ' ');
+    }
+    printf("g = {");
+    HmapForEach(item, &g) printf("%.*s: %d, ", (int)item->key_size, item->key, *(int *)item->data);
+    printf("}\n");
+    printf("h = {");
+    HmapForEach(item, &h) printf("%s, ", item->key);
+    printf("}\n");
+
+    // create a hmap with binary keys, which are hashed and compared together with their size
+    Hmap i = hmap_create_mem(0, sizeof(int));
+    const Endpoint endpoint[] = {{0x7f000001, 80, 0}, {0x7f000001, 443, 0}, {0x0a000001, 80, 0}};
+    for (int n = 0; n < 3; ++n)
+        hmap_insert_len(&i, (const char *)&endpoint[n], sizeof(*endpoint), &n, 0);
+    const Endpoint https = {0x7f000001, 443, 0};
+    const int *port = hmap_find_len(&i, (const char *)&https, sizeof(https));
+    printf("i.find(127.0.0.1:443) = %d\n", *port);
+
+    // create a typed hmap with 16-byte keys
+    UuidMap j = UuidMap_create(0, 0);
+    for (int n = 0; n < 3; ++n) UuidMap_insert(&j, (Uuid){n, ~n}, n, 0);
+    printf("j.find({1, ~1}) = %d\n", *UuidMap_find(&j, (Uuid){1, ~1}));
+
     // clear items
     hmap_clear(&a);
     hmap_clear(&b);
+    StrIntMap_clear(&c);
+    hmap_clear(&d);
+    hmap_clear(&e);
+    hmap_clear(&f);
+    hmap_clear(&g);
+    hmap_clear(&h);
+    hmap_clear(&i);
+    UuidMap_clear(&j);
 }
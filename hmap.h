@@ -1,168 +1,703 @@
 #pragma once
 
 #include <assert.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if __has_include(<stdbit.h>)
+#include <stdbit.h>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "allocator.h"
+#include "arena.h"
 #include "hash.h"
+#include "hashstats.h"
 
-// general purpose associative array using open addressing
+// general purpose associative array using open addressing with robin hood hashing
 typedef struct Hmap Hmap;
 typedef struct HmapItem HmapItem;
 typedef uint64_t HmapKeyHash(const char *);
+typedef uint64_t HmapKeyMemHash(const void *, long);
 typedef void *HmapDataCopy(void *, const void *, size_t);
 typedef void HmapDataFree(void *);
 
+// keep 7 bits of the hash of every item in a separate array of control bytes, and probe groups of
+// 16 slots at once using SIMD instructions (swiss table), instead of using robin hood hashing
+enum { HMAP_SWISS = 1 << 0 };
+
+// grow incrementally: keep the old table after a resize, and move a few of its slots to the new
+// table with every insert and remove, instead of rehashing all items at once
+enum { HMAP_INCREMENTAL = 1 << 1 };
+
+// group size and special control bytes of the swiss table; full slots store a 7-bit tag
+enum { X__HMAP_GROUP = 16, X__HMAP_EMPTY = 0x80, X__HMAP_DELETED = 0xfe };
+
+// number of slots of the old table that are moved with every insert and remove in incremental mode
+enum { X__HMAP_MOVE = 16 };
+
+// store the keys that are passed to insert instead of copies of them; the keys must outlive the
+// hmap, and they are not freed
+enum { HMAP_BORROW = 1 << 2 };
+
+// copy the keys into an arena that is owned by the hmap instead of allocating every key on its
+// own; the keys are only released by hmap_clear
+enum { HMAP_INTERN = 1 << 3 };
+
+// number of keys that are hashed and prefetched at once by the batched functions
+enum { X__HMAP_BATCH = 16 };
+
+// keys up to this size are terminated on the stack before they are hashed, and block size of the
+// first block of the arena of interned keys
+enum { X__HMAP_KEY_BUFFER = 256, X__HMAP_INTERN = 1 << 12 };
+
 struct Hmap {
-    long size, capacity, data_size, max_dist;
+    long size, capacity, data_size, max_dist, deleted;
     double load_factor;
+    int flags;
     HmapKeyHash *key_hash;
+    HmapKeyMemHash *key_memhash;
     HmapDataCopy *data_copy;
     HmapDataFree *data_free;
+    Allocator alloc;
     HmapItem *item;
+    long *dist_count, dist_capacity;
+    uint8_t *ctrl;
+    Hmap *old;
+    long old_index;
+    Arena intern;
+#ifdef HASH_STATS
+    HashStats *stats;
+#endif
 };
 
+// the key is only terminated if it was copied, or if the borrowed key was terminated
 struct HmapItem {
     char *key;
     void *data;
     uint64_t hash;
+    long key_size;
 };
 
-#define HmapForEach(item, hmap)                                                         \
-    for (HmapItem *item = (hmap)->item; item < (hmap)->item + (hmap)->capacity; ++item) \
-        if (item->key)
+// return the item after item (or the first one if item is 0), continuing in the old table after
+// the last item of the current one
+static HmapItem *x__hmap_next(const Hmap *hmap, const HmapItem *item)
+{
+    for (const Hmap *table = hmap; table; table = table->old) {
+        if (!table->item) continue;
+        HmapItem *next = table->item, *end = table->item + table->capacity;
+        if (item) {
+            if (item < table->item || item >= end) continue;
+            next += item - table->item + 1;
+            item = 0;
+        }
+        for (; next < end; ++next)
+            if (next->key) return next;
+    }
+    return 0;
+}
+
+// iterate over the items of the current and the old table in one loop, so that break ends it
+#define HmapForEach(item, hmap)                                    \
+    for (const Hmap *x__##item = (hmap); x__##item; x__##item = 0) \
+        for (HmapItem *item = x__hmap_next(x__##item, 0); item;    \
+             item = x__hmap_next(x__##item, item))
 
-// create an empty hmap
+// create an empty hmap; the capacity is rounded up to a power of two (in swiss mode, at least the
+// group size)
 static Hmap hmap_create_full(long capacity, long data_size, double load_factor,
                              HmapKeyHash *key_hash, HmapDataCopy *data_copy,
-                             HmapDataFree *data_free)
+                             HmapDataFree *data_free, const Allocator *alloc, int flags)
 {
     assert(capacity >= 0);
     assert(data_size >= 0);
     assert(0 < load_factor && load_factor < 1);
     assert(key_hash);
+    long _capacity = hash_capacity(capacity / load_factor + 1);
+    if (flags & HMAP_SWISS && _capacity < X__HMAP_GROUP) _capacity = X__HMAP_GROUP;
     return (Hmap){
-        .capacity = capacity / load_factor + 1,
+        .capacity = _capacity,
         .data_size = data_size,
         .load_factor = load_factor,
+        .flags = flags,
         .key_hash = key_hash,
         .data_copy = data_copy,
         .data_free = data_free,
+        .alloc = (alloc ? *alloc : allocator_std),
     };
 }
 static Hmap hmap_create(long capacity, long data_size)
 {
-    return hmap_create_full(capacity, data_size, 0.75, strhash_fnv1a, memcpy, free);
+    return hmap_create_full(capacity, data_size, 0.75, strhash_wyhash, memcpy, free, 0, 0);
+}
+
+// create an empty hmap for binary keys, which are hashed with a memhash function, such as
+// memhash_wyhash, and which are passed to the *_len functions; the keys may contain null bytes
+static Hmap hmap_create_mem_full(long capacity, long data_size, double load_factor,
+                                 HmapKeyMemHash *key_memhash, HmapDataCopy *data_copy,
+                                 HmapDataFree *data_free, const Allocator *alloc, int flags)
+{
+    assert(key_memhash);
+    Hmap hmap = hmap_create_full(capacity, data_size, load_factor, strhash_wyhash, data_copy,
+                                 data_free, alloc, flags);
+    hmap.key_hash = 0;
+    hmap.key_memhash = key_memhash;
+    return hmap;
+}
+static Hmap hmap_create_mem(long capacity, long data_size)
+{
+    return hmap_create_mem_full(capacity, data_size, 0.75, memhash_wyhash, memcpy, free, 0, 0);
 }
 
 static void x__hmap_create_items(Hmap *hmap)
 {
-    hmap->item = calloc(hmap->capacity, sizeof(*hmap->item));
+    hmap->item = allocator_alloc(&hmap->alloc, hmap->capacity, sizeof(*hmap->item), 1);
     assert(hmap->item);
+    if (hmap->flags & HMAP_SWISS) {
+        hmap->ctrl = allocator_alloc(&hmap->alloc, hmap->capacity, sizeof(*hmap->ctrl), 0);
+        assert(hmap->ctrl);
+        memset(hmap->ctrl, X__HMAP_EMPTY, hmap->capacity * sizeof(*hmap->ctrl));
+    }
+    X__HASH_STATS(hmap->stats = x__hash_stats_create(hmap->stats, &hmap->alloc));
+    X__HASH_STATS(x__hash_stats_alloc(hmap->stats, hmap->capacity * sizeof(*hmap->item)));
+    X__HASH_STATS(if (hmap->ctrl) x__hash_stats_alloc(hmap->stats, hmap->capacity));
 }
 
-static void x__hmap_resize_items(Hmap *hmap)
+static long x__hmap_home(const Hmap *hmap, uint64_t hash)
 {
-    assert(hmap);
-    const long _capacity = hmap->capacity / hmap->load_factor + 1;
-    HmapItem *_item = calloc(_capacity, sizeof(*_item));
-    assert(_item);
-    long _max_dist = 0;
-    for (HmapItem *item = hmap->item; item < hmap->item + hmap->capacity; ++item) {
-        if (!item->key) continue;
-        long _dist = 0, _i = item->hash % _capacity;
-        while (_item[_i].key) {
-            _dist += 1;
-            _i = (_i + 1) % _capacity;
+    return hash_mix(hash) & (hmap->capacity - 1);
+}
+
+static long x__hmap_dist(const Hmap *hmap, long i)
+{
+    return (i - x__hmap_home(hmap, hmap->item[i].hash)) & (hmap->capacity - 1);
+}
+
+// keep track of the number of items per probe distance, so that max_dist can also shrink
+static void x__hmap_count_dist(Hmap *hmap, long dist, long count)
+{
+    if (dist >= hmap->dist_capacity) {
+        const long _dist_capacity = 2 * dist + 1;
+        hmap->dist_count = allocator_realloc(&hmap->alloc, hmap->dist_count,
+                                             _dist_capacity * sizeof(*hmap->dist_count));
+        assert(hmap->dist_count);
+        memset(hmap->dist_count + hmap->dist_capacity, 0,
+               (_dist_capacity - hmap->dist_capacity) * sizeof(*hmap->dist_count));
+        hmap->dist_capacity = _dist_capacity;
+    }
+    hmap->dist_count[dist] += count;
+    if (dist > hmap->max_dist) hmap->max_dist = dist;
+    while (hmap->max_dist > 0 && !hmap->dist_count[hmap->max_dist]) hmap->max_dist -= 1;
+}
+
+// place an item that is not in the hmap, starting at position i with probe distance dist; an item
+// that is further from its home slot takes the slot of one that is closer to it (robin hood)
+static void x__hmap_place_item(Hmap *hmap, HmapItem item, long i, long dist)
+{
+    while (hmap->item[i].key) {
+        const long _dist = x__hmap_dist(hmap, i);
+        if (_dist < dist) {
+            const HmapItem _item = hmap->item[i];
+            hmap->item[i] = item;
+            x__hmap_count_dist(hmap, dist, 1);
+            x__hmap_count_dist(hmap, _dist, -1);
+            item = _item;
+            dist = _dist;
         }
-        _item[_i].key = item->key;
-        _item[_i].data = item->data;
-        _item[_i].hash = item->hash;
-        if (_dist > _max_dist) _max_dist = _dist;
+        dist += 1;
+        i = (i + 1) & (hmap->capacity - 1);
     }
-    free(hmap->item);
-    hmap->item = _item;
-    hmap->capacity = _capacity;
-    hmap->max_dist = _max_dist;
+    hmap->item[i] = item;
+    x__hmap_count_dist(hmap, dist, 1);
 }
 
-static void x__hmap_item_create(const Hmap *hmap, HmapItem *item, const char *key, void *data,
-                                uint64_t hash)
+// remove the item at a given position by shifting back the items that follow it, until one is
+// found that is in its home slot
+static void x__hmap_delete_item(Hmap *hmap, long i)
+{
+    x__hmap_count_dist(hmap, x__hmap_dist(hmap, i), -1);
+    long j = (i + 1) & (hmap->capacity - 1), dist;
+    while (hmap->item[j].key && (dist = x__hmap_dist(hmap, j)) > 0) {
+        x__hmap_count_dist(hmap, dist, -1);
+        x__hmap_count_dist(hmap, dist - 1, 1);
+        hmap->item[i] = hmap->item[j];
+        i = j;
+        j = (j + 1) & (hmap->capacity - 1);
+    }
+    memset(&hmap->item[i], 0, sizeof(*hmap->item));
+}
+
+// return the hash of a terminated key of a given size
+static uint64_t x__hmap_str_hash(const Hmap *hmap, const char *key, long size)
+{
+    return (hmap->key_memhash ? hmap->key_memhash(key, size) : hmap->key_hash(key));
+}
+
+// return the hash of a key of a given size, which is not necessarily terminated
+static uint64_t x__hmap_key_hash(const Hmap *hmap, const char *key, long size)
+{
+    if (hmap->key_memhash) return hmap->key_memhash(key, size);
+    char buffer[X__HMAP_KEY_BUFFER], *_key = buffer;
+    if (size >= X__HMAP_KEY_BUFFER) _key = allocator_alloc(&hmap->alloc, 1, size + 1, 0);
+    assert(_key);
+    memcpy(_key, key, size);
+    _key[size] = 0;
+    const uint64_t hash = hmap->key_hash(_key);
+    if (_key != buffer) allocator_free(&hmap->alloc, _key);
+    return hash;
+}
+
+static int x__hmap_key_equal(const HmapItem *item, const char *key, long size, uint64_t hash)
+{
+    return item->hash == hash && item->key_size == size && !memcmp(item->key, key, size);
+}
+
+// return the key that is stored in an item: the key itself, or a terminated copy of it
+static char *x__hmap_key_create(Hmap *hmap, const char *key, long size)
 {
-    item->key = strdup(key);
-    assert(item->key);
-    if (data && hmap->data_copy) {
-        item->data = malloc(hmap->data_size);
-        assert(item->data);
-        hmap->data_copy(item->data, data, hmap->data_size);
+    if (hmap->flags & HMAP_BORROW) return (char *)key;
+    X__HASH_STATS(x__hash_stats_alloc(hmap->stats, size + 1));
+    char *_key;
+    if (hmap->flags & HMAP_INTERN) {
+        if (!hmap->intern.data) hmap->intern = arena_create_full(X__HMAP_INTERN, &hmap->alloc);
+        _key = arena_alloc(&hmap->intern, 1, size + 1, 1, 0);
     }
     else {
-        item->data = data;
+        _key = allocator_alloc(&hmap->alloc, 1, size + 1, 0);
     }
+    assert(_key);
+    memcpy(_key, key, size);
+    _key[size] = 0;
+    return _key;
+}
+
+static void x__hmap_key_free(const Hmap *hmap, char *key)
+{
+    if (!(hmap->flags & (HMAP_BORROW | HMAP_INTERN))) allocator_free(&hmap->alloc, key);
+}
+
+// return a copy of data that is owned by the hmap (or data itself if there is no copy function)
+static void *x__hmap_data_create(Hmap *hmap, void *data)
+{
+    if (!data || !hmap->data_copy) return data;
+    void *_data = allocator_alloc(&hmap->alloc, 1, hmap->data_size, 0);
+    assert(_data);
+    hmap->data_copy(_data, data, hmap->data_size);
+    X__HASH_STATS(x__hash_stats_alloc(hmap->stats, hmap->data_size));
+    return _data;
+}
+
+static void x__hmap_item_create(Hmap *hmap, HmapItem *item, const char *key, long size, void *data,
+                                uint64_t hash)
+{
+    item->key = x__hmap_key_create(hmap, key, size);
+    item->key_size = size;
+    item->data = x__hmap_data_create(hmap, data);
     item->hash = hash;
 }
 
-// insert an item with a given key; on collision, keep or replace data and return old data
-static void *hmap_insert(Hmap *hmap, const char *key, void *data, int keep)
+// keep or replace the data of an item, and return its old data; the new data is copied if copy is
+// set (as by the bulk inserts, which take ownership of the replaced data)
+static void *x__hmap_item_replace(Hmap *hmap, HmapItem *item, void *data, int keep, int copy)
+{
+    void *item_data = item->data;
+    if (!keep) item->data = (copy ? x__hmap_data_create(hmap, data) : data);
+    return item_data;
+}
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+static unsigned x__hmap_group_mask(uint8x16_t match)
+{
+    const uint8x16_t bit = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t mask = vandq_u8(match, bit);
+    return vaddv_u8(vget_low_u8(mask)) | (unsigned)vaddv_u8(vget_high_u8(mask)) << 8;
+}
+#endif
+
+// return a bit mask of the slots in a group whose control bytes are equal to a given one
+static unsigned x__hmap_group_match(const uint8_t *ctrl, uint8_t byte)
+{
+#if defined(__SSE2__)
+    const __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(byte)));
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    return x__hmap_group_mask(vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(byte)));
+#else
+    unsigned mask = 0;
+    for (int i = 0; i < X__HMAP_GROUP; ++i) mask |= (unsigned)(ctrl[i] == byte) << i;
+    return mask;
+#endif
+}
+
+// return a bit mask of the slots in a group that are empty or deleted
+static unsigned x__hmap_group_free(const uint8_t *ctrl)
+{
+#if defined(__SSE2__)
+    return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)ctrl));
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    return x__hmap_group_mask(vtstq_u8(vld1q_u8(ctrl), vdupq_n_u8(0x80)));
+#else
+    unsigned mask = 0;
+    for (int i = 0; i < X__HMAP_GROUP; ++i) mask |= (unsigned)(ctrl[i] >> 7) << i;
+    return mask;
+#endif
+}
+
+// return the index of the lowest slot in a nonzero group mask
+static int x__hmap_group_first(unsigned mask)
+{
+#if __has_include(<stdbit.h>)
+    return stdc_trailing_zeros(mask);
+#elif defined(__GNUC__)
+    return __builtin_ctz(mask);
+#else
+    int i = 0;
+    for (; !(mask & 1); mask >>= 1) i += 1;
+    return i;
+#endif
+}
+
+// return the tag of a hash, taken from the high bits of the mixed hash, which are not used for the
+// index of its home slot
+static uint8_t x__hmap_swiss_tag(uint64_t hash)
+{
+    return hash_mix(hash) >> 57;
+}
+
+// return the item with a given key, checking only the slots whose tag matches; the probing stops
+// at the first group with an empty slot; the probe length is added to probe
+static HmapItem *x__hmap_swiss_find(const Hmap *hmap, const char *key, long size, uint64_t hash,
+                                    [[maybe_unused]] long *probe)
+{
+    long first = x__hmap_home(hmap, hash) / X__HMAP_GROUP * X__HMAP_GROUP;
+    for (long n = 0; n < hmap->capacity / X__HMAP_GROUP; ++n) {
+        X__HASH_STATS(*probe += 1);
+        unsigned match = x__hmap_group_match(hmap->ctrl + first, x__hmap_swiss_tag(hash));
+        for (; match; match &= match - 1) {
+            HmapItem *item = &hmap->item[first + x__hmap_group_first(match)];
+            X__HASH_STATS(x__hash_stats_compare(hmap->stats, item->hash == hash));
+            if (x__hmap_key_equal(item, key, size, hash)) return item;
+        }
+        if (x__hmap_group_match(hmap->ctrl + first, X__HMAP_EMPTY)) return 0;
+        first = (first + X__HMAP_GROUP) & (hmap->capacity - 1);
+    }
+    return 0;
+}
+
+// return the first empty or deleted slot of the probe sequence of a hash
+static long x__hmap_swiss_slot(const Hmap *hmap, uint64_t hash)
+{
+    long first = x__hmap_home(hmap, hash) / X__HMAP_GROUP * X__HMAP_GROUP;
+    unsigned mask;
+    while (!(mask = x__hmap_group_free(hmap->ctrl + first)))
+        first = (first + X__HMAP_GROUP) & (hmap->capacity - 1);
+    return first + x__hmap_group_first(mask);
+}
+
+// return the item with a given key from the current table (not the old one); the probe length is
+// added to probe
+static HmapItem *x__hmap_find_item(const Hmap *hmap, const char *key, long size, uint64_t hash,
+                                   [[maybe_unused]] long *probe)
+{
+    if (hmap->flags & HMAP_SWISS) return x__hmap_swiss_find(hmap, key, size, hash, probe);
+    long i = x__hmap_home(hmap, hash);
+    for (long dist = 0; hmap->item[i].key && dist <= x__hmap_dist(hmap, i); ++dist) {
+        X__HASH_STATS(*probe += 1);
+        X__HASH_STATS(x__hash_stats_compare(hmap->stats, hmap->item[i].hash == hash));
+        if (x__hmap_key_equal(&hmap->item[i], key, size, hash)) return &hmap->item[i];
+        i = (i + 1) & (hmap->capacity - 1);
+    }
+    return 0;
+}
+
+// insert an item that is not in the current table, without counting it
+static void x__hmap_put_item(Hmap *hmap, HmapItem item)
+{
+    if (hmap->flags & HMAP_SWISS) {
+        const long i = x__hmap_swiss_slot(hmap, item.hash);
+        if (hmap->ctrl[i] == X__HMAP_DELETED) hmap->deleted -= 1;
+        hmap->ctrl[i] = x__hmap_swiss_tag(item.hash);
+        hmap->item[i] = item;
+    }
+    else {
+        x__hmap_place_item(hmap, item, x__hmap_home(hmap, item.hash), 0);
+    }
+}
+
+// remove the item at a given position from the current table; in swiss mode, the slot can only be
+// marked as empty if its group already has an empty slot, because otherwise the probing of other
+// items might have continued past the group
+static void x__hmap_take_item(Hmap *hmap, long i)
+{
+    if (hmap->flags & HMAP_SWISS) {
+        memset(&hmap->item[i], 0, sizeof(*hmap->item));
+        if (x__hmap_group_match(hmap->ctrl + i / X__HMAP_GROUP * X__HMAP_GROUP, X__HMAP_EMPTY)) {
+            hmap->ctrl[i] = X__HMAP_EMPTY;
+        }
+        else {
+            hmap->ctrl[i] = X__HMAP_DELETED;
+            hmap->deleted += 1;
+        }
+    }
+    else {
+        x__hmap_delete_item(hmap, i);
+    }
+    hmap->size -= 1;
+}
+
+// move the items of a few slots of the old table to the current one, and release the old table
+// once it is empty
+static void x__hmap_move_items(Hmap *hmap)
+{
+    Hmap *old = hmap->old;
+    for (long n = 0; n < X__HMAP_MOVE && old->size > 0; ++n) {
+        const HmapItem item = old->item[hmap->old_index];
+        if (!item.key) {
+            hmap->old_index += 1;
+            continue;
+        }
+        x__hmap_take_item(old, hmap->old_index);
+        x__hmap_put_item(hmap, item);
+    }
+    if (old->size > 0) return;
+    allocator_free(&hmap->alloc, old->item);
+    allocator_free(&hmap->alloc, old->dist_count);
+    allocator_free(&hmap->alloc, old->ctrl);
+    allocator_free(&hmap->alloc, old);
+    hmap->old = 0;
+}
+
+// rehash all items at once into a table of a given capacity
+static void x__hmap_rehash_items(Hmap *hmap, long capacity)
+{
+    const long _capacity = hmap->capacity;
+    HmapItem *item = hmap->item;
+    uint8_t *ctrl = hmap->ctrl;
+    hmap->capacity = capacity;
+    if (hmap->dist_count) memset(hmap->dist_count, 0, hmap->dist_capacity * sizeof(long));
+    x__hmap_create_items(hmap);
+    hmap->max_dist = 0;
+    hmap->deleted = 0;
+    for (long i = 0; i < _capacity; ++i)
+        if (item[i].key) x__hmap_put_item(hmap, item[i]);
+    allocator_free(&hmap->alloc, item);
+    allocator_free(&hmap->alloc, ctrl);
+}
+
+// grow the table (a swiss table is only rehashed at the same capacity if most of its used slots
+// are deleted ones); in incremental mode, the items are moved later by x__hmap_move_items
+static void x__hmap_resize_items(Hmap *hmap)
 {
     assert(hmap);
-    assert(key);
-    if (!hmap->item) x__hmap_create_items(hmap);
-    if (hmap->size + 1 > hmap->capacity * hmap->load_factor) x__hmap_resize_items(hmap);
-    const uint64_t hash = hmap->key_hash(key);
-    long dist = 0, i = hash % hmap->capacity;
+    while (hmap->old) x__hmap_move_items(hmap);
+    long capacity = hmap->capacity;
+    if (!(hmap->flags & HMAP_SWISS) || hmap->size + 1 > capacity * hmap->load_factor / 2)
+        capacity *= 2;
+    if (!(hmap->flags & HMAP_INCREMENTAL)) {
+        x__hmap_rehash_items(hmap, capacity);
+        return;
+    }
+    Hmap *old = allocator_alloc(&hmap->alloc, 1, sizeof(*old), 0);
+    assert(old);
+    *old = *hmap;
+    old->intern = (Arena){0};
+    hmap->old = old;
+    hmap->old_index = 0;
+    hmap->capacity = capacity;
+    hmap->dist_count = 0;
+    hmap->dist_capacity = 0;
+    x__hmap_create_items(hmap);
+    hmap->max_dist = 0;
+    hmap->deleted = 0;
+}
+
+// insert an item into a table that has room for it (see x__hmap_item_replace for keep and copy);
+// the probe length is added to probe
+static void *x__hmap_insert_item(Hmap *hmap, const char *key, long size, void *data, uint64_t hash,
+                                 int keep, int copy, long *probe)
+{
+    if (hmap->old) {
+        HmapItem *item = x__hmap_find_item(hmap->old, key, size, hash, probe);
+        if (item) return x__hmap_item_replace(hmap, item, data, keep, copy);
+        x__hmap_move_items(hmap);
+    }
+    HmapItem _item;
+    if (hmap->flags & HMAP_SWISS) {
+        HmapItem *item = x__hmap_swiss_find(hmap, key, size, hash, probe);
+        if (item) return x__hmap_item_replace(hmap, item, data, keep, copy);
+        x__hmap_item_create(hmap, &_item, key, size, data, hash);
+        x__hmap_put_item(hmap, _item);
+        hmap->size += 1;
+        return 0;
+    }
+    long dist = 0, i = x__hmap_home(hmap, hash);
     HmapItem *item = &hmap->item[i];
-    while (item->key && (item->hash != hash || strcmp(item->key, key))) {
+    while (item->key && dist <= x__hmap_dist(hmap, i)) {
+        X__HASH_STATS(*probe += 1);
+        X__HASH_STATS(x__hash_stats_compare(hmap->stats, item->hash == hash));
+        if (x__hmap_key_equal(item, key, size, hash))
+            return x__hmap_item_replace(hmap, item, data, keep, copy);
         dist += 1;
-        i = (i + 1) % hmap->capacity;
+        i = (i + 1) & (hmap->capacity - 1);
         item = &hmap->item[i];
     }
-    if (!item->key) {
-        x__hmap_item_create(hmap, item, key, data, hash);
-        if (dist > hmap->max_dist) hmap->max_dist = dist;
-    }
-    else {
-        void *item_data = item->data;
-        if (!keep) item->data = data;
-        return item_data;
-    }
+    x__hmap_item_create(hmap, &_item, key, size, data, hash);
+    x__hmap_place_item(hmap, _item, i, dist);
     hmap->size += 1;
     return 0;
 }
 
+// prefetch the home slot of a hash in the current and the old table
+static void x__hmap_prefetch(const Hmap *hmap, uint64_t hash)
+{
+    for (const Hmap *table = hmap; table; table = table->old) {
+        const long i = x__hmap_home(table, hash);
+        x__hash_prefetch(&table->item[i]);
+        if (table->flags & HMAP_SWISS) x__hash_prefetch(&table->ctrl[i]);
+    }
+}
+
+static void *x__hmap_insert(Hmap *hmap, const char *key, long size, void *data, uint64_t hash,
+                            int keep)
+{
+    if (!hmap->item) x__hmap_create_items(hmap);
+    if (hmap->size + hmap->deleted + 1 > hmap->capacity * hmap->load_factor) {
+        X__HASH_STATS(const double start = x__hash_stats_now());
+        x__hmap_resize_items(hmap);
+        X__HASH_STATS(x__hash_stats_resize(hmap->stats, start));
+    }
+    long probe = 0;
+    void *item_data = x__hmap_insert_item(hmap, key, size, data, hash, keep, 0, &probe);
+    X__HASH_STATS(x__hash_stats_insert(hmap->stats, probe));
+    return item_data;
+}
+
+// insert an item with a given key; on collision, keep or replace data and return old data
+static void *hmap_insert(Hmap *hmap, const char *key, void *data, int keep)
+{
+    assert(hmap);
+    assert(key);
+    const long size = strlen(key);
+    return x__hmap_insert(hmap, key, size, data, x__hmap_str_hash(hmap, key, size), keep);
+}
+
+// insert an item with a key of a given size, which does not need to be terminated (but must not
+// contain null bytes, unless the hmap is created with hmap_create_mem); on collision, keep or
+// replace data and return old data
+static void *hmap_insert_len(Hmap *hmap, const char *key, long size, void *data, int keep)
+{
+    assert(hmap);
+    assert(key || size == 0);
+    assert(size >= 0);
+    return x__hmap_insert(hmap, key, size, data, x__hmap_key_hash(hmap, key, size), keep);
+}
+
+// insert count items with keys key[i] and data data[i] (or no data if data is 0); the table is
+// grown at most once beforehand, and the keys are hashed and their slots prefetched in batches; on
+// collision, keep or replace data (replaced data is freed, and the new data is copied, as for new
+// items)
+static void hmap_insert_many(Hmap *hmap, const char *const *key, void *const *data, long count,
+                             int keep)
+{
+    assert(hmap);
+    assert(key || count == 0);
+    assert(count >= 0);
+    long capacity = hmap->capacity;
+    while (hmap->size + count > capacity * hmap->load_factor) capacity *= 2;
+    if (!hmap->item) {
+        hmap->capacity = capacity;
+        x__hmap_create_items(hmap);
+    }
+    else if (hmap->size + hmap->deleted + count > hmap->capacity * hmap->load_factor) {
+        X__HASH_STATS(const double start = x__hash_stats_now());
+        while (hmap->old) x__hmap_move_items(hmap);
+        x__hmap_rehash_items(hmap, capacity);
+        X__HASH_STATS(x__hash_stats_resize(hmap->stats, start));
+    }
+    uint64_t hash[X__HMAP_BATCH];
+    for (long first = 0; first < count; first += X__HMAP_BATCH) {
+        const long n = (count - first < X__HMAP_BATCH ? count - first : X__HMAP_BATCH);
+        for (long i = 0; i < n; ++i) {
+            hash[i] = x__hmap_str_hash(hmap, key[first + i], strlen(key[first + i]));
+            x__hmap_prefetch(hmap, hash[i]);
+        }
+        for (long i = 0; i < n; ++i) {
+            void *item_data = (data ? data[first + i] : 0);
+            const char *_key = key[first + i];
+            long probe = 0;
+            void *replaced = x__hmap_insert_item(hmap, _key, strlen(_key), item_data, hash[i],
+                                                 keep, 1, &probe);
+            X__HASH_STATS(x__hash_stats_insert(hmap->stats, probe));
+            if (replaced && !keep && hmap->data_free) hmap->data_free(replaced);
+        }
+    }
+}
+
 // return a copy of the hmap
 static Hmap hmap_copy(const Hmap *hmap)
 {
     assert(hmap);
-    Hmap copy = hmap_create_full(hmap->size, hmap->data_size, hmap->load_factor, hmap->key_hash,
-                                 hmap->data_copy, hmap->data_free);
+    Hmap copy = hmap_create_full(hmap->size, hmap->data_size, hmap->load_factor, strhash_wyhash,
+                                 hmap->data_copy, hmap->data_free, &hmap->alloc, hmap->flags);
+    copy.key_hash = hmap->key_hash;
+    copy.key_memhash = hmap->key_memhash;
     if (hmap->size == 0) return copy;
-    for (const HmapItem *item = hmap->item; item < hmap->item + hmap->capacity; ++item)
-        if (item->key) hmap_insert(&copy, item->key, item->data, 0);
+    HmapForEach(item, hmap)
+        x__hmap_insert(&copy, item->key, item->key_size, item->data, item->hash, 0);
     return copy;
 }
 
+static void *x__hmap_remove(Hmap *hmap, const char *key, long size, uint64_t hash)
+{
+    Hmap *table = hmap;
+    long probe = 0;
+    HmapItem *item = x__hmap_find_item(hmap, key, size, hash, &probe);
+    if (!item && hmap->old && (item = x__hmap_find_item(hmap->old, key, size, hash, &probe)))
+        table = hmap->old;
+    X__HASH_STATS(x__hash_stats_find(hmap->stats, probe));
+    if (!item) return 0;
+    void *data = item->data;
+    x__hmap_key_free(hmap, item->key);
+    x__hmap_take_item(table, item - table->item);
+    if (table != hmap) hmap->size -= 1;
+    if (hmap->old) x__hmap_move_items(hmap);
+    return data;
+}
+
 // remove an item with a given key, and return its data
 static void *hmap_remove(Hmap *hmap, const char *key)
 {
     assert(hmap);
     assert(key);
     if (hmap->size == 0) return 0;
-    const uint64_t hash = hmap->key_hash(key);
-    long i = hash % hmap->capacity;
-    HmapItem *item = &hmap->item[i];
-    for (long dist = 0; dist <= hmap->max_dist; ++dist) {
-        if (item->key && item->hash == hash && !strcmp(item->key, key)) {
-            void *data = item->data;
-            free(item->key);
-            memset(item, 0, sizeof(*item));
-            hmap->size -= 1;
-            return data;
-        }
-        i = (i + 1) % hmap->capacity;
-        item = &hmap->item[i];
-    }
-    return 0;
+    const long size = strlen(key);
+    return x__hmap_remove(hmap, key, size, x__hmap_str_hash(hmap, key, size));
+}
+
+// remove an item with a key of a given size (see hmap_insert_len), and return its data
+static void *hmap_remove_len(Hmap *hmap, const char *key, long size)
+{
+    assert(hmap);
+    assert(key || size == 0);
+    assert(size >= 0);
+    if (hmap->size == 0) return 0;
+    return x__hmap_remove(hmap, key, size, x__hmap_key_hash(hmap, key, size));
+}
+
+// return the item with a given key from the current or the old table
+static HmapItem *x__hmap_find(const Hmap *hmap, const char *key, long size, uint64_t hash)
+{
+    long probe = 0;
+    HmapItem *item = x__hmap_find_item(hmap, key, size, hash, &probe);
+    if (!item && hmap->old) item = x__hmap_find_item(hmap->old, key, size, hash, &probe);
+    X__HASH_STATS(x__hash_stats_find(hmap->stats, probe));
+    return item;
 }
 
 // return the data of an item with a given key
@@ -171,27 +706,203 @@ static void *hmap_find(const Hmap *hmap, const char *key)
     assert(hmap);
     assert(key);
     if (hmap->size == 0) return 0;
-    const uint64_t hash = hmap->key_hash(key);
-    long i = hash % hmap->capacity;
-    HmapItem *item = &hmap->item[i];
-    for (long dist = 0; dist <= hmap->max_dist; ++dist) {
-        if (item->key && item->hash == hash && !strcmp(item->key, key)) return item->data;
-        i = (i + 1) % hmap->capacity;
-        item = &hmap->item[i];
+    const long size = strlen(key);
+    HmapItem *item = x__hmap_find(hmap, key, size, x__hmap_str_hash(hmap, key, size));
+    return (item ? item->data : 0);
+}
+
+// return the data of an item with a key of a given size (see hmap_insert_len)
+static void *hmap_find_len(const Hmap *hmap, const char *key, long size)
+{
+    assert(hmap);
+    assert(key || size == 0);
+    assert(size >= 0);
+    if (hmap->size == 0) return 0;
+    HmapItem *item = x__hmap_find(hmap, key, size, x__hmap_key_hash(hmap, key, size));
+    return (item ? item->data : 0);
+}
+
+// find the data of count items with keys key[i], and store it in data[i]; the keys are hashed and
+// their slots prefetched in batches, so that the memory accesses of a batch overlap
+static void hmap_find_many(const Hmap *hmap, const char *const *key, void **data, long count)
+{
+    assert(hmap);
+    assert((key && data) || count == 0);
+    assert(count >= 0);
+    if (hmap->size == 0) {
+        for (long i = 0; i < count; ++i) data[i] = 0;
+        return;
+    }
+    uint64_t hash[X__HMAP_BATCH];
+    for (long first = 0; first < count; first += X__HMAP_BATCH) {
+        const long n = (count - first < X__HMAP_BATCH ? count - first : X__HMAP_BATCH);
+        for (long i = 0; i < n; ++i) {
+            hash[i] = x__hmap_str_hash(hmap, key[first + i], strlen(key[first + i]));
+            x__hmap_prefetch(hmap, hash[i]);
+        }
+        for (long i = 0; i < n; ++i) {
+            const char *_key = key[first + i];
+            HmapItem *item = x__hmap_find(hmap, _key, strlen(_key), hash[i]);
+            data[first + i] = (item ? item->data : 0);
+        }
     }
-    return 0;
 }
 
-// remove all items from the hmap
+// remove all items from the hmap; interned keys are released at once
 static void hmap_clear(Hmap *hmap)
 {
     assert(hmap);
     if (!hmap->item) return;
-    for (HmapItem *item = hmap->item; item < hmap->item + hmap->capacity; ++item) {
-        if (!item->key) continue;
-        free(item->key);
-        if (hmap->data_free) hmap->data_free(item->data);
+    if (hmap->old) {
+        X__HASH_STATS(hmap->old->stats = 0);
+        hmap_clear(hmap->old);
+        allocator_free(&hmap->alloc, hmap->old);
     }
-    free(hmap->item);
+    if (hmap->alloc.deallocate || hmap->data_free) {
+        for (HmapItem *item = hmap->item; item < hmap->item + hmap->capacity; ++item) {
+            if (!item->key) continue;
+            x__hmap_key_free(hmap, item->key);
+            if (hmap->data_free) hmap->data_free(item->data);
+        }
+    }
+    allocator_free(&hmap->alloc, hmap->item);
+    allocator_free(&hmap->alloc, hmap->dist_count);
+    allocator_free(&hmap->alloc, hmap->ctrl);
+    if (hmap->intern.data) arena_clear(&hmap->intern);
+    X__HASH_STATS(allocator_free(&hmap->alloc, hmap->stats));
     *hmap = (Hmap){0};
 }
+
+#ifdef HASH_STATS
+// print the counters of the hmap to file, with the current distribution of probe distances
+static void hmap_stats_print(FILE *file, const Hmap *hmap)
+{
+    assert(file);
+    assert(hmap);
+    const double load = (hmap->capacity ? (double)hmap->size / hmap->capacity : 0);
+    fprintf(file, "hmap of %ld items in %ld slots (load %.3f of %.3f)%s\n", hmap->size,
+            hmap->capacity, load, hmap->load_factor, (hmap->old ? " while resizing" : ""));
+    if (!hmap->stats) return;
+    x__hash_stats_print(file, hmap->stats);
+    if (!hmap->dist_count) return;
+    fprintf(file, "%8s %12s\n", "distance", "items");
+    for (long dist = 0; dist <= hmap->max_dist; ++dist)
+        fprintf(file, "%8ld %12ld\n", dist, hmap->dist_count[dist]);
+}
+#endif
+
+// define a typed hmap `name` with keys of type K and data of type V, using key_hash(K) and
+// key_eq(K, K); the functions mirror the generic ones, but take and return keys and data by value
+// (keys are not copied), and the types and functions are known at compile time, so they can be
+// inlined
+#define HMAP_DEFINE(name, K, V, key_hash, key_eq)                                               \
+    typedef struct name name;                                                                   \
+    typedef struct name##Item name##Item;                                                       \
+    struct name {                                                                               \
+        long size, capacity;                                                                    \
+        Allocator alloc;                                                                        \
+        name##Item *item;                                                                       \
+    };                                                                                          \
+    struct name##Item {                                                                         \
+        K key;                                                                                  \
+        V data;                                                                                 \
+        uint64_t hash;                                                                          \
+    };                                                                                          \
+    [[maybe_unused]] static name name##_create(long capacity, const Allocator *alloc)           \
+    {                                                                                           \
+        assert(capacity >= 0);                                                                  \
+        const long _capacity = hash_capacity(capacity / 0.75 + 1);                              \
+        return (name){.capacity = _capacity, .alloc = (alloc ? *alloc : allocator_std)};        \
+    }                                                                                           \
+    [[maybe_unused]] static uint64_t x__##name##_hash(K key)                                    \
+    {                                                                                           \
+        const uint64_t _hash = hash_mix(key_hash(key));                                         \
+        return _hash + !_hash;                                                                  \
+    }                                                                                           \
+    [[maybe_unused]] static name##Item *x__##name##_slot(name##Item *item, long capacity,       \
+                                                         K key, uint64_t _hash)                 \
+    {                                                                                           \
+        long i = _hash & (capacity - 1);                                                        \
+        while (item[i].hash && (item[i].hash != _hash || !key_eq(item[i].key, key)))            \
+            i = (i + 1) & (capacity - 1);                                                       \
+        return &item[i];                                                                        \
+    }                                                                                           \
+    [[maybe_unused]] static void x__##name##_resize_items(name *hmap)                           \
+    {                                                                                           \
+        const long _capacity = (hmap->item ? 2 * hmap->capacity : hmap->capacity);              \
+        name##Item *_item = allocator_alloc(&hmap->alloc, _capacity, sizeof(name##Item), 1);    \
+        assert(_item);                                                                          \
+        for (long i = 0; hmap->item && i < hmap->capacity; ++i)                                 \
+            if (hmap->item[i].hash)                                                             \
+                *x__##name##_slot(_item, _capacity, hmap->item[i].key, hmap->item[i].hash) =    \
+                    hmap->item[i];                                                              \
+        allocator_free(&hmap->alloc, hmap->item);                                               \
+        hmap->item = _item;                                                                     \
+        hmap->capacity = _capacity;                                                             \
+    }                                                                                           \
+    [[maybe_unused]] static int name##_insert(name *hmap, K key, V data, int keep)              \
+    {                                                                                           \
+        assert(hmap);                                                                           \
+        if (!hmap->item) x__##name##_resize_items(hmap);                                        \
+        if (hmap->size + 1 > hmap->capacity * 0.75) x__##name##_resize_items(hmap);             \
+        const uint64_t _hash = x__##name##_hash(key);                                           \
+        name##Item *item = x__##name##_slot(hmap->item, hmap->capacity, key, _hash);            \
+        if (item->hash) {                                                                       \
+            if (!keep) item->data = data;                                                       \
+            return 1;                                                                           \
+        }                                                                                       \
+        *item = (name##Item){.key = key, .data = data, .hash = _hash};                          \
+        hmap->size += 1;                                                                        \
+        return 0;                                                                               \
+    }                                                                                           \
+    [[maybe_unused]] static name name##_copy(const name *hmap)                                  \
+    {                                                                                           \
+        assert(hmap);                                                                           \
+        name copy = {.capacity = hmap->capacity, .alloc = hmap->alloc};                         \
+        if (hmap->size == 0) return copy;                                                       \
+        copy.item = allocator_alloc(&copy.alloc, copy.capacity, sizeof(name##Item), 0);         \
+        assert(copy.item);                                                                      \
+        memcpy(copy.item, hmap->item, hmap->capacity * sizeof(name##Item));                     \
+        copy.size = hmap->size;                                                                 \
+        return copy;                                                                            \
+    }                                                                                           \
+    [[maybe_unused]] static int name##_remove(name *hmap, K key, V *data)                       \
+    {                                                                                           \
+        assert(hmap);                                                                           \
+        if (hmap->size == 0) return 0;                                                          \
+        const uint64_t _hash = x__##name##_hash(key);                                           \
+        name##Item *item = x__##name##_slot(hmap->item, hmap->capacity, key, _hash);            \
+        if (!item->hash) return 0;                                                              \
+        if (data) *data = item->data;                                                           \
+        const long mask = hmap->capacity - 1;                                                   \
+        long i = item - hmap->item;                                                             \
+        for (long j = (i + 1) & mask; hmap->item[j].hash; j = (j + 1) & mask) {                 \
+            const long home = hmap->item[j].hash & mask;                                        \
+            if (((j - home) & mask) >= ((j - i) & mask)) {                                      \
+                hmap->item[i] = hmap->item[j];                                                  \
+                i = j;                                                                          \
+            }                                                                                   \
+        }                                                                                       \
+        hmap->item[i].hash = 0;                                                                 \
+        hmap->size -= 1;                                                                        \
+        return 1;                                                                               \
+    }                                                                                           \
+    [[maybe_unused]] static V *name##_find(const name *hmap, K key)                             \
+    {                                                                                           \
+        assert(hmap);                                                                           \
+        if (hmap->size == 0) return 0;                                                          \
+        const uint64_t _hash = x__##name##_hash(key);                                           \
+        name##Item *item = x__##name##_slot(hmap->item, hmap->capacity, key, _hash);            \
+        return (item->hash ? &item->data : 0);                                                  \
+    }                                                                                           \
+    [[maybe_unused]] static void name##_clear(name *hmap)                                       \
+    {                                                                                           \
+        assert(hmap);                                                                           \
+        allocator_free(&hmap->alloc, hmap->item);                                               \
+        *hmap = (name){0};                                                                      \
+    }
+
+#define HmapForEachTyped(item, hmap)                                                     \
+    for (typeof((hmap)->item) item = (hmap)->item; item < (hmap)->item + (hmap)->capacity; \
+         ++item)                                                                         \
+        if (item->hash)
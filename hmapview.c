@@ -0,0 +1,30 @@
+#include "hmapview.h"
+
+int main(void)
+{
+    // create a hmap that stores integers, and insert key-integer pairs 0 through 999
+    Hmap a = hmap_create(1000, sizeof(long));
+    for (long i = 0; i < 1000; ++i) {
+        char key[32];
+        snprintf(key, sizeof(key), "key%ld", i);
+        hmap_insert(&a, key, &i, 0);
+    }
+
+    // save an image of the hmap
+    const char *path = "hmapview.img";
+    FILE *file = fopen(path, "wb");
+    printf("saved = %d\n", file && hmap_save(&a, file));
+    if (file) fclose(file);
+
+    // map the image into memory, and look up some items directly in the mapped pages
+    HmapView b = hmap_open_mmap(path);
+    printf("b.size = %ld\n", b.size);
+    printf("b.find(key42) = %ld\n", *(const long *)hmap_view_find(&b, "key42"));
+    printf("b.find(key999) = %ld\n", *(const long *)hmap_view_find(&b, "key999"));
+    printf("b.find(key1000) = %p\n", hmap_view_find(&b, "key1000"));
+
+    // clear items, and remove the image
+    hmap_clear(&a);
+    hmap_view_close(&b);
+    remove(path);
+}
@@ -0,0 +1,250 @@
+#pragma once
+
+// memory mapped files are part of POSIX, not of standard C, so that this header needs
+// -D_POSIX_C_SOURCE=200809L or -D_DEFAULT_SOURCE (or -std=gnu23) on glibc; defining the macro here
+// would not help if another libc header was already included
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "allocator.h"
+#include "hash.h"
+#include "hmap.h"
+#include "mphf.h"
+
+// read-only view of a hmap image that was written by hmap_save and is mapped into memory by
+// hmap_open_mmap; lookups work directly on the mapped pages, without deserialization, and several
+// processes that map the same file share its pages; an image is only portable between machines
+// with the same byte order
+typedef struct HmapView HmapView;
+typedef struct HmapViewSlot HmapViewSlot;
+typedef struct HmapViewHeader HmapViewHeader;
+
+// an image starts with its header, followed by the slots of a linear probing table; every slot
+// refers to a record of the key size, the terminated key, and the data (all offsets are relative
+// to the start of the image, and records are aligned to alignof(max_align_t))
+enum { X__HMAP_VIEW_HEADER = 64, X__HMAP_VIEW_ALIGN = alignof(max_align_t) };
+
+static const char x__hmap_view_magic[] = "cdshmap1";
+
+struct HmapView {
+    long size, capacity, data_size;
+    uint64_t seed;
+    const HmapViewSlot *slot;
+    const char *image;
+    long image_size;
+};
+
+// an empty slot has hash 0
+struct HmapViewSlot {
+    uint64_t hash, offset;
+};
+
+struct HmapViewHeader {
+    char magic[8];
+    uint64_t size, capacity, data_size, seed, image_size;
+};
+
+// the keys of an image are hashed with wyhash and the seed of the image, independently of the hash
+// function of the hmap that was saved
+static uint64_t x__hmap_view_hash(const char *key, long size, uint64_t seed)
+{
+    const uint64_t hash = memhash_wyhash_seed(key, size, seed);
+    return hash + !hash;
+}
+
+static long x__hmap_view_data_offset(long key_size)
+{
+    const long align = X__HMAP_VIEW_ALIGN;
+    return (sizeof(uint64_t) + key_size + 1 + align - 1) / align * align;
+}
+
+static long x__hmap_view_record_size(long key_size, long data_size)
+{
+    const long align = X__HMAP_VIEW_ALIGN;
+    return (x__hmap_view_data_offset(key_size) + data_size + align - 1) / align * align;
+}
+
+// write a position-independent image of the hmap with the keys and data_size bytes of data of
+// every item (zeros for items without data), and return whether it was written completely
+static int hmap_save(const Hmap *hmap, FILE *file)
+{
+    assert(hmap);
+    assert(file);
+    const long capacity = hash_capacity(hmap->size / 0.5 + 1);
+    const long slots_end = X__HMAP_VIEW_HEADER + capacity * sizeof(HmapViewSlot);
+    HmapViewSlot *slot = allocator_alloc(&hmap->alloc, capacity, sizeof(*slot), 1);
+    assert(slot);
+    long offset = slots_end;
+    if (hmap->item) {
+        HmapForEach(item, hmap) {
+            const uint64_t hash = x__hmap_view_hash(item->key, item->key_size, hash_get_seed());
+            long i = hash_mix(hash) & (capacity - 1);
+            while (slot[i].hash) i = (i + 1) & (capacity - 1);
+            slot[i] = (HmapViewSlot){hash, offset};
+            offset += x__hmap_view_record_size(item->key_size, hmap->data_size);
+        }
+    }
+    HmapViewHeader header = {
+        .size = hmap->size,
+        .capacity = capacity,
+        .data_size = hmap->data_size,
+        .seed = hash_get_seed(),
+        .image_size = offset,
+    };
+    memcpy(header.magic, x__hmap_view_magic, sizeof(header.magic));
+    char padding[X__HMAP_VIEW_HEADER] = {0};
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(padding, X__HMAP_VIEW_HEADER - sizeof(header), 1, file) == 1 &&
+             (long)fwrite(slot, sizeof(*slot), capacity, file) == capacity;
+    allocator_free(&hmap->alloc, slot);
+    char *record = 0;
+    long record_capacity = 0;
+    if (hmap->item) {
+        HmapForEach(item, hmap) {
+            if (!ok) break;
+            const long size = x__hmap_view_record_size(item->key_size, hmap->data_size);
+            if (size > record_capacity) {
+                record_capacity = 2 * size;
+                record = allocator_realloc(&hmap->alloc, record, record_capacity);
+                assert(record);
+            }
+            memset(record, 0, size);
+            const uint64_t key_size = item->key_size;
+            memcpy(record, &key_size, sizeof(key_size));
+            memcpy(record + sizeof(key_size), item->key, item->key_size);
+            const long data_offset = x__hmap_view_data_offset(item->key_size);
+            if (item->data) memcpy(record + data_offset, item->data, hmap->data_size);
+            ok = (long)fwrite(record, 1, size, file) == size;
+        }
+    }
+    allocator_free(&hmap->alloc, record);
+    return ok;
+}
+
+// return whether the header of an image of a given size describes a slot table and records that
+// lie within the image, and a table with at least one empty slot, where every probe ends
+static int x__hmap_view_valid(const HmapViewHeader *header, const char *image, long image_size)
+{
+    const uint64_t size = image_size, capacity = header->capacity;
+    if (capacity == 0 || (capacity & (capacity - 1)) || header->size >= capacity) return 0;
+    if (capacity > (size - X__HMAP_VIEW_HEADER) / sizeof(HmapViewSlot)) return 0;
+    if (header->data_size > size) return 0;
+    const uint64_t slots_end = X__HMAP_VIEW_HEADER + capacity * sizeof(HmapViewSlot);
+    uint64_t count = 0;
+    for (uint64_t i = 0; i < capacity; ++i) {
+        HmapViewSlot slot;
+        memcpy(&slot, image + X__HMAP_VIEW_HEADER + i * sizeof(slot), sizeof(slot));
+        if (!slot.hash) continue;
+        count += 1;
+        if (slot.offset < slots_end || slot.offset > size - sizeof(uint64_t)) return 0;
+        uint64_t key_size;
+        memcpy(&key_size, image + slot.offset, sizeof(key_size));
+        if (key_size > size) return 0;
+        const uint64_t record_size = x__hmap_view_record_size(key_size, header->data_size);
+        if (record_size > size - slot.offset) return 0;
+    }
+    return count == header->size;
+}
+
+// map a hmap image into memory; return an empty view (whose image is 0) if the file cannot be
+// mapped or does not contain a valid hmap image (the header, every slot, and the size of every
+// record are checked, so that a truncated or corrupted file is rejected)
+static HmapView hmap_open_mmap(const char *path)
+{
+    assert(path);
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) return (HmapView){0};
+    struct stat st;
+    void *image = MAP_FAILED;
+    if (!fstat(fd, &st) && st.st_size >= X__HMAP_VIEW_HEADER)
+        image = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) return (HmapView){0};
+    HmapViewHeader header;
+    memcpy(&header, image, sizeof(header));
+    if (memcmp(header.magic, x__hmap_view_magic, sizeof(header.magic)) ||
+        header.image_size != (uint64_t)st.st_size ||
+        !x__hmap_view_valid(&header, image, st.st_size)) {
+        munmap(image, st.st_size);
+        return (HmapView){0};
+    }
+    return (HmapView){
+        .size = header.size,
+        .capacity = header.capacity,
+        .data_size = header.data_size,
+        .seed = header.seed,
+        .slot = (const HmapViewSlot *)((const char *)image + X__HMAP_VIEW_HEADER),
+        .image = image,
+        .image_size = st.st_size,
+    };
+}
+
+// return the data of an item with a key of a given size (see hmap_insert_len)
+static const void *hmap_view_find_len(const HmapView *view, const char *key, long size)
+{
+    assert(view);
+    assert(key || size == 0);
+    assert(size >= 0);
+    if (view->size == 0) return 0;
+    const uint64_t hash = x__hmap_view_hash(key, size, view->seed);
+    for (long i = hash_mix(hash) & (view->capacity - 1); view->slot[i].hash;
+         i = (i + 1) & (view->capacity - 1)) {
+        if (view->slot[i].hash != hash) continue;
+        const char *record = view->image + view->slot[i].offset;
+        uint64_t key_size;
+        memcpy(&key_size, record, sizeof(key_size));
+        if (key_size == (uint64_t)size && !memcmp(record + sizeof(key_size), key, size))
+            return record + x__hmap_view_data_offset(size);
+    }
+    return 0;
+}
+
+// return the data of an item with a given key
+static const void *hmap_view_find(const HmapView *view, const char *key)
+{
+    assert(key);
+    return hmap_view_find_len(view, key, strlen(key));
+}
+
+// unmap the image
+static void hmap_view_close(HmapView *view)
+{
+    assert(view);
+    if (view->image) munmap((void *)view->image, view->image_size);
+    *view = (HmapView){0};
+}
+
+// map a frozen map image that was written by fmap_save into memory; return an empty frozen map
+// (whose image is 0) if the file cannot be mapped or does not contain a frozen map image
+static Fmap fmap_open_mmap(const char *path)
+{
+    assert(path);
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0) return (Fmap){0};
+    struct stat st;
+    void *image = MAP_FAILED;
+    if (!fstat(fd, &st) && st.st_size >= X__FMAP_HEADER)
+        image = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) return (Fmap){0};
+    const Fmap fmap = fmap_view(image, st.st_size);
+    if (!fmap.image) munmap(image, st.st_size);
+    return fmap;
+}
+
+// unmap the image of a frozen map that was mapped by fmap_open_mmap
+static void fmap_close_mmap(Fmap *fmap)
+{
+    assert(fmap);
+    assert(!fmap->alloc.allocate);
+    if (fmap->image) munmap(fmap->image, fmap->image_size);
+    *fmap = (Fmap){0};
+}
@@ -60,7 +60,17 @@ int main(void)
     printf("a.count(33) = %ld\n", list_count(&a, (int[]){33}));
     printf("b.count(33) = %ld\n", list_count(&b, (int[]){33}));
 
+    // create a list that stores integers inside of its items, which come from slabs of a pool
+    List c = list_create_full(sizeof(int), intcmp, memcpy, 0, 0, LIST_POOL);
+    for (int i = 0; i < 10; ++i) list_append(&c, &i);
+    printf("c.pop(0) = %d\n", *(int *)list_pop(&c, 0));
+    list_append(&c, (int[]){10});
+    printf("c = [");
+    ListForEach(item, &c) printf("%d, ", *(int *)item->data);
+    printf("]\n");
+
     // clear items
     list_clear(&a);
     list_clear(&b);
+    list_clear(&c);
 }
@@ -4,6 +4,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "allocator.h"
+#include "pool.h"
+
 // general purpose doubly linked list
 typedef struct List List;
 typedef struct ListItem ListItem;
@@ -11,12 +14,22 @@ typedef int ListDataCompare(const void *, const void *);
 typedef void *ListDataCopy(void *, const void *, size_t);
 typedef void ListDataFree(void *);
 
+// allocate the items together with their data from slabs of a pool instead of one by one, which
+// keeps neighboring items close in memory, and lets list_clear release the slabs at once
+enum { LIST_POOL = 1 << 0 };
+
+// number of items per slab in pool mode
+enum { X__LIST_POOL_COUNT = 256 };
+
 struct List {
     long size, data_size;
+    int flags;
     ListDataCompare *data_cmp;
     ListDataCopy *data_copy;
     ListDataFree *data_free;
+    Allocator alloc;
     ListItem *head, *tail;
+    Pool pool;
 };
 
 struct ListItem {
@@ -28,29 +41,52 @@ struct ListItem {
 
 #define ListForEachReverse(item, list) for (ListItem *item = (list)->tail; item; item = item->prev)
 
-// create an empty list
+// in pool mode, the data of an item follows it in the same block
+static long x__list_data_offset(void)
+{
+    const long align = alignof(max_align_t);
+    return (sizeof(ListItem) + align - 1) / align * align;
+}
+
+// create an empty list; in pool mode, data_free must not free the data
 static List list_create_full(long data_size, ListDataCompare *data_cmp, ListDataCopy *data_copy,
-                             ListDataFree *data_free)
+                             ListDataFree *data_free, const Allocator *alloc, int flags)
 {
     assert(data_size >= 0);
-    return (List){
+    List list = {
         .data_size = data_size,
+        .flags = flags,
         .data_cmp = data_cmp,
         .data_copy = data_copy,
         .data_free = data_free,
+        .alloc = (alloc ? *alloc : allocator_std),
     };
+    if (flags & LIST_POOL)
+        list.pool = pool_create(x__list_data_offset() + data_size, X__LIST_POOL_COUNT, &list.alloc);
+    return list;
 }
 static List list_create(long data_size, ListDataCompare *data_cmp)
 {
-    return list_create_full(data_size, data_cmp, memcpy, free);
+    return list_create_full(data_size, data_cmp, memcpy, free, 0, 0);
 }
 
-static ListItem *x__list_item_create(const List *list, void *data)
+static ListItem *x__list_item_create(List *list, void *data)
 {
-    ListItem *item = malloc(sizeof(*item));
+    if (list->flags & LIST_POOL) {
+        ListItem *item = pool_alloc(&list->pool, 0);
+        item->data = data;
+        if (data && list->data_copy) {
+            item->data = (char *)item + x__list_data_offset();
+            list->data_copy(item->data, data, list->data_size);
+        }
+        item->next = 0;
+        item->prev = 0;
+        return item;
+    }
+    ListItem *item = allocator_alloc(&list->alloc, 1, sizeof(*item), 0);
     assert(item);
     if (data && list->data_copy) {
-        item->data = malloc(list->data_size);
+        item->data = allocator_alloc(&list->alloc, 1, list->data_size, 0);
         assert(item->data);
         list->data_copy(item->data, data, list->data_size);
     }
@@ -62,6 +98,14 @@ static ListItem *x__list_item_create(const List *list, void *data)
     return item;
 }
 
+static void x__list_item_free(List *list, ListItem *item)
+{
+    if (list->flags & LIST_POOL)
+        pool_free(&list->pool, item);
+    else
+        allocator_free(&list->alloc, item);
+}
+
 // insert an item at a given position
 static void list_insert(List *list, long i, void *data)
 {
@@ -111,13 +155,15 @@ static void list_append(List *list, void *data)
 static List list_copy(const List *list)
 {
     assert(list);
-    List copy = list_create_full(list->data_size, list->data_cmp, list->data_copy, list->data_free);
+    List copy = list_create_full(list->data_size, list->data_cmp, list->data_copy, list->data_free,
+                                 &list->alloc, list->flags);
     if (list->size == 0) return copy;
     for (const ListItem *item = list->head; item; item = item->next) list_append(&copy, item->data);
     return copy;
 }
 
-// remove the item at the given position in the list, and return its data
+// remove the item at the given position in the list, and return its data; in pool mode, the data
+// is only valid until the list is modified again
 static void *list_pop(List *list, long i)
 {
     assert(list);
@@ -153,12 +199,13 @@ static void *list_pop(List *list, long i)
         item->prev->next = item->next;
     }
     void *data = item->data;
-    free(item);
+    x__list_item_free(list, item);
     list->size -= 1;
     return data;
 }
 
-// remove the first item from the list whose value is equal to data, and return its data
+// remove the first item from the list whose value is equal to data, and return its data; in pool
+// mode, the data is only valid until the list is modified again
 static void *list_remove(List *list, const void *data)
 {
     assert(list);
@@ -179,7 +226,7 @@ static void *list_remove(List *list, const void *data)
                 item->prev->next = item->next;
             }
             void *item_data = item->data;
-            free(item);
+            x__list_item_free(list, item);
             list->size -= 1;
             return item_data;
         }
@@ -235,21 +282,27 @@ static ListItem *x__list_merge_sort_split(ListItem *first)
     return second;
 }
 
+// merge two sorted lists iteratively, so that the stack depth does not grow with the list size
 static ListItem *x__list_merge_sort_merge(ListItem *first, ListItem *second, ListDataCompare cmp,
                                           int order)
 {
-    if (!first) return second;
-    if (!second) return first;
-    if (order * cmp(first->data, second->data) < 0) {
-        first->next = x__list_merge_sort_merge(first->next, second, cmp, order);
-        if (first->next) first->next->prev = first;
-        first->prev = 0;
-        return first;
+    ListItem head = {0}, *tail = &head;
+    while (first && second) {
+        if (order * cmp(first->data, second->data) < 0) {
+            tail->next = first;
+            first = first->next;
+        }
+        else {
+            tail->next = second;
+            second = second->next;
+        }
+        tail->next->prev = tail;
+        tail = tail->next;
     }
-    second->next = x__list_merge_sort_merge(first, second->next, cmp, order);
-    if (second->next) second->next->prev = second;
-    second->prev = 0;
-    return second;
+    tail->next = (first ? first : second);
+    if (tail->next) tail->next->prev = tail;
+    if (head.next) head.next->prev = 0;
+    return head.next;
 }
 
 static ListItem *x__list_merge_sort(ListItem *first, ListDataCompare cmp, int order)
@@ -290,15 +343,24 @@ static void list_reverse(List *list)
     list->tail = swap;
 }
 
-// remove all items from the list
+// remove all items from the list; in pool mode, the slabs are released at once
 static void list_clear(List *list)
 {
     assert(list);
+    if (list->flags & LIST_POOL) {
+        if (list->data_free)
+            for (ListItem *item = list->head; item; item = item->next) list->data_free(item->data);
+        pool_clear(&list->pool);
+        *list = (List){0};
+        return;
+    }
     if (list->size == 0) return;
-    for (ListItem *item = list->head, *next; item; item = next) {
-        next = item->next;
-        if (list->data_free) list->data_free(item->data);
-        free(item);
+    if (list->alloc.deallocate || list->data_free) {
+        for (ListItem *item = list->head, *next; item; item = next) {
+            next = item->next;
+            if (list->data_free) list->data_free(item->data);
+            allocator_free(&list->alloc, item);
+        }
     }
     *list = (List){0};
 }
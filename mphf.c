@@ -0,0 +1,41 @@
+#include "mphf.h"
+
+#include "hmapview.h"
+
+int main(void)
+{
+    // create a minimal perfect hash function of some keys, which maps them to 0 through 4
+    const char *key[] = {"apple", "banana", "cherry", "date", "elderberry"};
+    Mphf a = mphf_create(key, 5);
+    printf("a.index = {");
+    for (long i = 0; i < 5; ++i) printf("%s: %ld, ", key[i], mphf_index(&a, key[i]));
+    printf("}\n");
+
+    // create a hmap that stores integers, insert key-integer pairs 0 through 999, and freeze it
+    Hmap b = hmap_create(1000, sizeof(long));
+    for (long i = 0; i < 1000; ++i) {
+        char _key[32];
+        snprintf(_key, sizeof(_key), "key%ld", i);
+        hmap_insert(&b, _key, &i, 0);
+    }
+    Fmap c = fmap_create(&b);
+    printf("c.size = %ld\n", c.size);
+    printf("c.bits = %.2f\n", mphf_bits(&c.mphf));
+    printf("c.find(key42) = %ld\n", *(const long *)fmap_find(&c, "key42"));
+    printf("c.find(key1000) = %p\n", fmap_find(&c, "key1000"));
+
+    // save the image of the frozen map, map it into memory, and look up an item in the mapped pages
+    const char *path = "mphf.img";
+    FILE *file = fopen(path, "wb");
+    printf("saved = %d\n", file && fmap_save(&c, file));
+    if (file) fclose(file);
+    Fmap d = fmap_open_mmap(path);
+    printf("d.find(key999) = %ld\n", *(const long *)fmap_find(&d, "key999"));
+
+    // clear items, and remove the image
+    mphf_clear(&a);
+    hmap_clear(&b);
+    fmap_clear(&c);
+    fmap_close_mmap(&d);
+    remove(path);
+}
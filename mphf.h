@@ -0,0 +1,465 @@
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "hash.h"
+#include "hmap.h"
+
+// minimal perfect hash function that maps each key of a static set of distinct keys to a unique
+// index in [0, size), after PTHash by Pibiri and Trani: the keys are split into buckets, and every
+// bucket stores a pilot (in a packed array of a few bits per pilot) that moves its keys to free
+// slots; keys that are not in the set are mapped to an arbitrary index
+typedef struct Mphf Mphf;
+
+// frozen associative array of a static set of keys that locates every key with one evaluation of
+// its minimal perfect hash function and one key comparison; all of its parts are stored in one
+// position-independent image, which can be saved to a file and used directly from memory
+typedef struct Fmap Fmap;
+typedef struct FmapHeader FmapHeader;
+
+// average number of keys per bucket is about bucket_factor / log2(size); the load factor of the
+// slots is 1 / (1 + 1 / X__MPHF_SLACK), and the slots beyond size are remapped to free slots
+enum { X__MPHF_BUCKET_FACTOR = 4, X__MPHF_SLACK = 100 };
+
+// largest pilot that is tried before the build restarts with a different seed, and number of seeds
+// that are tried before the keys are considered to be not distinct
+enum { X__MPHF_MAX_PILOT = 1 << 20, X__MPHF_MAX_SEED = 16 };
+
+// header of a frozen map image, and size of the header in the image
+enum { X__FMAP_HEADER = 64, X__FMAP_ALIGN = alignof(max_align_t) };
+
+struct Mphf {
+    long size, capacity, bucket_count, pilot_bits;
+    uint64_t seed;
+    uint64_t *pilot, *remap;
+    Allocator alloc;
+};
+
+struct Fmap {
+    long size, data_size;
+    Mphf mphf;
+    const uint64_t *offset;
+    char *image;
+    long image_size;
+    Allocator alloc;
+};
+
+struct FmapHeader {
+    char magic[8];
+    uint64_t size, capacity, bucket_count, pilot_bits, seed, data_size, image_size;
+};
+
+static const char x__fmap_magic[] = "cdsfmap1";
+
+static uint64_t x__mphf_hash(const Mphf *mphf, const char *key, long size)
+{
+    return memhash_wyhash_seed(key, size, mphf->seed);
+}
+
+// map a 64-bit value to [0, range) without a division
+static long x__mphf_range(uint64_t value, long range)
+{
+    uint64_t high;
+    x__hash_mul128(value, range, &high);
+    return high;
+}
+
+// about 60% of the keys go to the first 30% of the buckets, which are placed first
+static long x__mphf_bucket(const Mphf *mphf, uint64_t hash)
+{
+    const uint64_t mixed = hash_mix(hash ^ 0x2d358dccaa6c78a5);
+    const long dense = mphf->bucket_count * 3 / 10;
+    if (dense == 0 || (mixed >> 32) >= 0.6 * 4294967296.0)
+        return dense + x__mphf_range(mixed << 32, mphf->bucket_count - dense);
+    return x__mphf_range(mixed << 32, dense);
+}
+
+static long x__mphf_slot(const Mphf *mphf, uint64_t hash, uint64_t pilot)
+{
+    return x__mphf_range(hash ^ hash_mix(pilot + 1), mphf->capacity);
+}
+
+static long x__mphf_pilot_words(long bucket_count, long pilot_bits)
+{
+    return (bucket_count * pilot_bits + 63) / 64 + 1;
+}
+
+static uint64_t x__mphf_pilot(const Mphf *mphf, long bucket)
+{
+    if (mphf->pilot_bits == 0) return 0;
+    const long bit = bucket * mphf->pilot_bits, word = bit / 64, shift = bit % 64;
+    uint64_t value = mphf->pilot[word] >> shift;
+    if (shift + mphf->pilot_bits > 64) value |= mphf->pilot[word + 1] << (64 - shift);
+    return value & (~0ULL >> (64 - mphf->pilot_bits));
+}
+
+static void x__mphf_pilot_set(uint64_t *pilot, long bucket, long pilot_bits, uint64_t value)
+{
+    const long bit = bucket * pilot_bits, word = bit / 64, shift = bit % 64;
+    pilot[word] |= value << shift;
+    if (shift + pilot_bits > 64) pilot[word + 1] |= value >> (64 - shift);
+}
+
+// find a pilot for every bucket, largest buckets first; return whether all pilots were found
+static int x__mphf_search(Mphf *mphf, const uint64_t *hash, uint64_t *value)
+{
+    const long n = mphf->size, nb = mphf->bucket_count;
+    long *start = allocator_alloc(&mphf->alloc, nb + 1, sizeof(*start), 1);
+    long *next = allocator_alloc(&mphf->alloc, nb, sizeof(*next), 0);
+    uint64_t *sorted = allocator_alloc(&mphf->alloc, n, sizeof(*sorted), 0);
+    uint64_t *taken = allocator_alloc(&mphf->alloc, mphf->capacity / 64 + 1, sizeof(*taken), 1);
+    assert(start && next && sorted && taken);
+
+    // group the hashes by bucket
+    for (long i = 0; i < n; ++i) start[x__mphf_bucket(mphf, hash[i]) + 1] += 1;
+    long max_size = 0;
+    for (long b = 0; b < nb; ++b) {
+        if (start[b + 1] > max_size) max_size = start[b + 1];
+        start[b + 1] += start[b];
+    }
+    memcpy(next, start, nb * sizeof(*next));
+    for (long i = 0; i < n; ++i) sorted[next[x__mphf_bucket(mphf, hash[i])]++] = hash[i];
+
+    // order the buckets by decreasing size (counting sort)
+    long *count = allocator_alloc(&mphf->alloc, max_size + 2, sizeof(*count), 1);
+    long *order = allocator_alloc(&mphf->alloc, nb, sizeof(*order), 0);
+    long *slot = allocator_alloc(&mphf->alloc, max_size + 1, sizeof(*slot), 0);
+    assert(count && order && slot);
+    for (long b = 0; b < nb; ++b) count[max_size - (start[b + 1] - start[b]) + 1] += 1;
+    for (long s = 0; s <= max_size; ++s) count[s + 1] += count[s];
+    for (long b = 0; b < nb; ++b) order[count[max_size - (start[b + 1] - start[b])]++] = b;
+
+    int found = 1;
+    for (long o = 0; o < nb && found; ++o) {
+        const long b = order[o], size = start[b + 1] - start[b];
+        if (size == 0) break;
+        const uint64_t *h = sorted + start[b];
+        uint64_t pilot = 0;
+        for (; pilot < X__MPHF_MAX_PILOT; ++pilot) {
+            long i = 0;
+            for (; i < size; ++i) {
+                slot[i] = x__mphf_slot(mphf, h[i], pilot);
+                if (taken[slot[i] / 64] >> (slot[i] % 64) & 1) break;
+                long j = 0;
+                while (j < i && slot[j] != slot[i]) j += 1;
+                if (j < i) break;
+            }
+            if (i == size) break;
+        }
+        if (pilot == X__MPHF_MAX_PILOT) {
+            found = 0;
+            break;
+        }
+        for (long i = 0; i < size; ++i) taken[slot[i] / 64] |= 1ULL << (slot[i] % 64);
+        value[b] = pilot;
+    }
+
+    // remap the taken slots beyond size to the free slots below size, in increasing order
+    if (found) {
+        long free_slot = 0;
+        for (long s = n; s < mphf->capacity; ++s) {
+            if (!(taken[s / 64] >> (s % 64) & 1)) continue;
+            while (taken[free_slot / 64] >> (free_slot % 64) & 1) free_slot += 1;
+            mphf->remap[s - n] = free_slot++;
+        }
+    }
+    allocator_free(&mphf->alloc, start);
+    allocator_free(&mphf->alloc, next);
+    allocator_free(&mphf->alloc, sorted);
+    allocator_free(&mphf->alloc, taken);
+    allocator_free(&mphf->alloc, count);
+    allocator_free(&mphf->alloc, order);
+    allocator_free(&mphf->alloc, slot);
+    return found;
+}
+
+// build the minimal perfect hash function of count distinct keys key[i] of size key_size[i] (or
+// strlen(key[i]) if key_size is 0); abort if the keys are not distinct
+static Mphf mphf_create_full(const char *const *key, const long *key_size, long count,
+                             const Allocator *alloc)
+{
+    assert(key || count == 0);
+    assert(count >= 0);
+    Mphf mphf = {
+        .size = count,
+        .capacity = count + count / X__MPHF_SLACK,
+        .alloc = (alloc ? *alloc : allocator_std),
+    };
+    long log2 = 1;
+    while ((1L << log2) < count) log2 += 1;
+    mphf.bucket_count = (X__MPHF_BUCKET_FACTOR * count) / log2 + 1;
+    uint64_t *hash = allocator_alloc(&mphf.alloc, count + 1, sizeof(*hash), 0);
+    uint64_t *value = allocator_alloc(&mphf.alloc, mphf.bucket_count, sizeof(*value), 0);
+    mphf.remap = allocator_alloc(&mphf.alloc, mphf.capacity - count + 1, sizeof(*mphf.remap), 0);
+    assert(hash && value && mphf.remap);
+    int found = 0;
+    for (int seed = 0; seed < X__MPHF_MAX_SEED && !found; ++seed) {
+        mphf.seed = hash_get_seed() + seed;
+        for (long i = 0; i < count; ++i)
+            hash[i] = x__mphf_hash(&mphf, key[i], (key_size ? key_size[i] : (long)strlen(key[i])));
+        memset(value, 0, mphf.bucket_count * sizeof(*value));
+        found = x__mphf_search(&mphf, hash, value);
+    }
+    if (!found) abort();  // the keys are not distinct
+    uint64_t max_value = 0;
+    for (long b = 0; b < mphf.bucket_count; ++b)
+        if (value[b] > max_value) max_value = value[b];
+    while (max_value >> mphf.pilot_bits) mphf.pilot_bits += 1;
+    const long words = x__mphf_pilot_words(mphf.bucket_count, mphf.pilot_bits);
+    mphf.pilot = allocator_alloc(&mphf.alloc, words, sizeof(*mphf.pilot), 1);
+    assert(mphf.pilot);
+    for (long b = 0; b < mphf.bucket_count; ++b)
+        x__mphf_pilot_set(mphf.pilot, b, mphf.pilot_bits, value[b]);
+    allocator_free(&mphf.alloc, hash);
+    allocator_free(&mphf.alloc, value);
+    return mphf;
+}
+static Mphf mphf_create(const char *const *key, long count)
+{
+    return mphf_create_full(key, 0, count, 0);
+}
+
+static long x__mphf_index(const Mphf *mphf, uint64_t hash)
+{
+    const long slot = x__mphf_slot(mphf, hash, x__mphf_pilot(mphf, x__mphf_bucket(mphf, hash)));
+    return (slot < mphf->size ? slot : (long)mphf->remap[slot - mphf->size]);
+}
+
+// return the index of a key of a given size
+static long mphf_index_len(const Mphf *mphf, const char *key, long size)
+{
+    assert(mphf);
+    assert(mphf->size > 0);
+    assert(key || size == 0);
+    return x__mphf_index(mphf, x__mphf_hash(mphf, key, size));
+}
+
+// return the index of a key
+static long mphf_index(const Mphf *mphf, const char *key)
+{
+    assert(key);
+    return mphf_index_len(mphf, key, strlen(key));
+}
+
+// return the number of bits that the function uses per key
+static double mphf_bits(const Mphf *mphf)
+{
+    assert(mphf);
+    if (mphf->size == 0) return 0;
+    const long words = x__mphf_pilot_words(mphf->bucket_count, mphf->pilot_bits);
+    return 64.0 * (words + mphf->capacity - mphf->size) / mphf->size;
+}
+
+// release the function
+static void mphf_clear(Mphf *mphf)
+{
+    assert(mphf);
+    allocator_free(&mphf->alloc, mphf->pilot);
+    allocator_free(&mphf->alloc, mphf->remap);
+    *mphf = (Mphf){0};
+}
+
+static long x__fmap_align(long size)
+{
+    return (size + X__FMAP_ALIGN - 1) / X__FMAP_ALIGN * X__FMAP_ALIGN;
+}
+
+static long x__fmap_data_offset(long key_size)
+{
+    return x__fmap_align(sizeof(uint64_t) + key_size + 1);
+}
+
+// create a frozen map with the keys and data_size bytes of data of every item of a hmap (zeros for
+// items without data); the image is laid out as header, pilots, remapped slots, record offsets, and
+// records of the key size, the terminated key, and the data
+static Fmap fmap_create(const Hmap *hmap)
+{
+    assert(hmap);
+    const Allocator *alloc = &hmap->alloc;
+    const char **key = allocator_alloc(alloc, hmap->size + 1, sizeof(*key), 0);
+    long *key_size = allocator_alloc(alloc, hmap->size + 1, sizeof(*key_size), 0);
+    void **data = allocator_alloc(alloc, hmap->size + 1, sizeof(*data), 0);
+    assert(key && key_size && data);
+    long n = 0;
+    if (hmap->item) {
+        HmapForEach(item, hmap) {
+            key[n] = item->key;
+            key_size[n] = item->key_size;
+            data[n++] = item->data;
+        }
+    }
+    Mphf mphf = mphf_create_full(key, key_size, n, alloc);
+
+    // place the records in index order
+    long *index = allocator_alloc(alloc, n + 1, sizeof(*index), 0);
+    long *record_size = allocator_alloc(alloc, n + 1, sizeof(*record_size), 0);
+    assert(index && record_size);
+    for (long i = 0; i < n; ++i) {
+        index[i] = mphf_index_len(&mphf, key[i], key_size[i]);
+        record_size[index[i]] = x__fmap_align(x__fmap_data_offset(key_size[i]) + hmap->data_size);
+    }
+    const long pilot_words = x__mphf_pilot_words(mphf.bucket_count, mphf.pilot_bits);
+    const long remap_words = mphf.capacity - mphf.size;
+    const long pilot_offset = X__FMAP_HEADER, remap_offset = pilot_offset + 8 * pilot_words;
+    const long offset_offset = remap_offset + 8 * remap_words;
+    long image_size = x__fmap_align(offset_offset + 8 * n);
+    const long record_offset = image_size;
+    for (long i = 0; i < n; ++i) image_size += record_size[i];
+
+    Fmap fmap = {
+        .size = n,
+        .data_size = hmap->data_size,
+        .image_size = image_size,
+        .alloc = *alloc,
+    };
+    fmap.image = allocator_alloc(alloc, 1, image_size, 1);
+    assert(fmap.image);
+    FmapHeader header = {
+        .size = n,
+        .capacity = mphf.capacity,
+        .bucket_count = mphf.bucket_count,
+        .pilot_bits = mphf.pilot_bits,
+        .seed = mphf.seed,
+        .data_size = hmap->data_size,
+        .image_size = image_size,
+    };
+    memcpy(header.magic, x__fmap_magic, sizeof(header.magic));
+    memcpy(fmap.image, &header, sizeof(header));
+    memcpy(fmap.image + pilot_offset, mphf.pilot, 8 * pilot_words);
+    memcpy(fmap.image + remap_offset, mphf.remap, 8 * remap_words);
+    uint64_t *offset = (uint64_t *)(fmap.image + offset_offset);
+    for (long i = 0, next = record_offset; i < n; next += record_size[i++]) offset[i] = next;
+    for (long i = 0; i < n; ++i) {
+        char *record = fmap.image + offset[index[i]];
+        const uint64_t size = key_size[i];
+        memcpy(record, &size, sizeof(size));
+        memcpy(record + sizeof(size), key[i], key_size[i]);
+        if (data[i]) memcpy(record + x__fmap_data_offset(key_size[i]), data[i], hmap->data_size);
+    }
+    mphf_clear(&mphf);
+    allocator_free(alloc, key);
+    allocator_free(alloc, key_size);
+    allocator_free(alloc, data);
+    allocator_free(alloc, index);
+    allocator_free(alloc, record_size);
+
+    // the function of the frozen map refers to the pilots and remapped slots in the image
+    fmap.mphf = (Mphf){
+        .size = n,
+        .capacity = header.capacity,
+        .bucket_count = header.bucket_count,
+        .pilot_bits = header.pilot_bits,
+        .seed = header.seed,
+        .pilot = (uint64_t *)(fmap.image + pilot_offset),
+        .remap = (uint64_t *)(fmap.image + remap_offset),
+    };
+    fmap.offset = offset;
+    return fmap;
+}
+
+// return whether the header of an image of a given size describes pilots, remapped slots, record
+// offsets, and records that lie within the image, and remapped slots that refer to valid indices
+static int x__fmap_valid(const FmapHeader *header, const char *image, long image_size)
+{
+    const uint64_t size = image_size;
+    if (header->capacity < header->size || header->capacity > size) return 0;
+    if (header->bucket_count == 0 || header->bucket_count > size) return 0;
+    if (header->pilot_bits > 64 || header->data_size > size) return 0;
+    const uint64_t pilot_words = x__mphf_pilot_words(header->bucket_count, header->pilot_bits);
+    const uint64_t remap_words = header->capacity - header->size;
+    if (pilot_words + remap_words + header->size > (size - X__FMAP_HEADER) / 8) return 0;
+    const uint64_t remap_offset = X__FMAP_HEADER + 8 * pilot_words;
+    const uint64_t offset_offset = remap_offset + 8 * remap_words;
+    const uint64_t records = offset_offset + 8 * header->size;
+    for (uint64_t i = 0; i < remap_words; ++i) {
+        uint64_t index;
+        memcpy(&index, image + remap_offset + 8 * i, sizeof(index));
+        if (index >= header->size) return 0;
+    }
+    for (uint64_t i = 0; i < header->size; ++i) {
+        uint64_t offset, key_size;
+        memcpy(&offset, image + offset_offset + 8 * i, sizeof(offset));
+        if (offset < records || offset > size - sizeof(key_size)) return 0;
+        memcpy(&key_size, image + offset, sizeof(key_size));
+        if (key_size > size) return 0;
+        if (x__fmap_data_offset(key_size) + header->data_size > size - offset) return 0;
+    }
+    return 1;
+}
+
+// return a frozen map that uses an image in memory (for example one that was read from a file
+// written by fmap_save), or an empty frozen map (whose image is 0) if it is not a frozen map image;
+// the image must be aligned to alignof(max_align_t) and outlive the frozen map, which does not
+// release it
+static Fmap fmap_view(const void *image, long image_size)
+{
+    assert(image || image_size == 0);
+    FmapHeader header;
+    if (image_size < X__FMAP_HEADER) return (Fmap){0};
+    memcpy(&header, image, sizeof(header));
+    if (memcmp(header.magic, x__fmap_magic, sizeof(header.magic)) ||
+        header.image_size != (uint64_t)image_size || !x__fmap_valid(&header, image, image_size))
+        return (Fmap){0};
+    char *_image = (char *)image;
+    const long pilot_words = x__mphf_pilot_words(header.bucket_count, header.pilot_bits);
+    const long remap_offset = X__FMAP_HEADER + 8 * pilot_words;
+    return (Fmap){
+        .size = header.size,
+        .data_size = header.data_size,
+        .mphf =
+            {
+                .size = header.size,
+                .capacity = header.capacity,
+                .bucket_count = header.bucket_count,
+                .pilot_bits = header.pilot_bits,
+                .seed = header.seed,
+                .pilot = (uint64_t *)(_image + X__FMAP_HEADER),
+                .remap = (uint64_t *)(_image + remap_offset),
+            },
+        .offset = (uint64_t *)(_image + remap_offset + 8 * (header.capacity - header.size)),
+        .image = _image,
+        .image_size = image_size,
+    };
+}
+
+// return the data of an item with a key of a given size
+static const void *fmap_find_len(const Fmap *fmap, const char *key, long size)
+{
+    assert(fmap);
+    assert(key || size == 0);
+    assert(size >= 0);
+    if (fmap->size == 0) return 0;
+    const char *record = fmap->image + fmap->offset[mphf_index_len(&fmap->mphf, key, size)];
+    uint64_t key_size;
+    memcpy(&key_size, record, sizeof(key_size));
+    if (key_size != (uint64_t)size || memcmp(record + sizeof(key_size), key, size)) return 0;
+    return record + x__fmap_data_offset(size);
+}
+
+// return the data of an item with a given key
+static const void *fmap_find(const Fmap *fmap, const char *key)
+{
+    assert(key);
+    return fmap_find_len(fmap, key, strlen(key));
+}
+
+// write the image of the frozen map, and return whether it was written completely
+static int fmap_save(const Fmap *fmap, FILE *file)
+{
+    assert(fmap);
+    assert(file);
+    return (long)fwrite(fmap->image, 1, fmap->image_size, file) == fmap->image_size;
+}
+
+// release the image of a frozen map that was created by fmap_create
+static void fmap_clear(Fmap *fmap)
+{
+    assert(fmap);
+    allocator_free(&fmap->alloc, fmap->image);
+    *fmap = (Fmap){0};
+}
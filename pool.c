@@ -0,0 +1,34 @@
+#include "pool.h"
+
+#include <stdio.h>
+
+typedef struct {
+    double x, y;
+} Point;
+
+int main(void)
+{
+    // create a pool of points with four points per slab
+    Pool pool = pool_create(sizeof(Point), 4, 0);
+
+    // allocate ten points (spread across three slabs)
+    Point *point[10];
+    for (long i = 0; i < 10; ++i) {
+        point[i] = pool_alloc(&pool, 0);
+        *point[i] = (Point){i, -i};
+    }
+
+    // release every other point, and allocate a new point (which reuses the last released block)
+    for (long i = 0; i < 10; i += 2) pool_free(&pool, point[i]);
+    Point *p = pool_alloc(&pool, 1);
+    printf("p == point[8]: %d\n", p == point[8]);
+    printf("p = (%g, %g)\n", p->x, p->y);
+
+    // print the remaining points
+    printf("point = [");
+    for (long i = 1; i < 10; i += 2) printf("(%g, %g), ", point[i]->x, point[i]->y);
+    printf("]\n");
+
+    // release all slabs at once
+    pool_clear(&pool);
+}
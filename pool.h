@@ -0,0 +1,112 @@
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocator.h"
+
+// fixed-size block allocator that carves blocks out of slabs, and recycles released blocks through
+// a free list that is stored in the blocks themselves
+typedef struct Pool Pool;
+
+struct Pool {
+    long size, count;
+    Allocator alloc;
+    char *slab, *head, *tail;
+    void *free;
+};
+
+// the first bytes of a slab link it to the previous one
+enum { X__POOL_HEADER = alignof(max_align_t) };
+
+// create an empty pool of blocks of a given size, which allocates count blocks per slab; the block
+// size is rounded up to a multiple of alignof(max_align_t)
+static Pool pool_create(long size, long count, const Allocator *alloc)
+{
+    assert(size > 0);
+    assert(count > 0);
+    const long align = alignof(max_align_t);
+    return (Pool){
+        .size = (size + align - 1) / align * align,
+        .count = count,
+        .alloc = (alloc ? *alloc : allocator_std),
+    };
+}
+
+// allocate a block; zero it if init is set
+static void *pool_alloc(Pool *pool, int init)
+{
+    assert(pool);
+    void *block = pool->free;
+    if (block) {
+        memcpy(&pool->free, block, sizeof(pool->free));
+    }
+    else {
+        if (pool->head == pool->tail) {
+            const long size = X__POOL_HEADER + pool->count * pool->size;
+            char *slab = allocator_alloc(&pool->alloc, 1, size, 0);
+            assert(slab);
+            memcpy(slab, &pool->slab, sizeof(pool->slab));
+            pool->slab = slab;
+            pool->head = slab + X__POOL_HEADER;
+            pool->tail = pool->head + pool->count * pool->size;
+        }
+        block = pool->head;
+        pool->head += pool->size;
+    }
+    return (init ? memset(block, 0, pool->size) : block);
+}
+
+// release a block, so that it can be reused by the next pool_alloc
+static void pool_free(Pool *pool, void *ptr)
+{
+    assert(pool);
+    if (!ptr) return;
+    memcpy(ptr, &pool->free, sizeof(pool->free));
+    pool->free = ptr;
+}
+
+// release all slabs at once
+static void pool_clear(Pool *pool)
+{
+    assert(pool);
+    for (char *slab = pool->slab, *prev; slab; slab = prev) {
+        memcpy(&prev, slab, sizeof(prev));
+        allocator_free(&pool->alloc, slab);
+    }
+    *pool = (Pool){0};
+}
+
+static void *x__pool_allocate(void *pool, long count, long size, int init)
+{
+    assert(count * size <= ((Pool *)pool)->size);
+    (void)count;
+    (void)size;
+    return pool_alloc(pool, init);
+}
+
+static void *x__pool_reallocate(void *pool, void *ptr, long size)
+{
+    assert(size <= ((Pool *)pool)->size);
+    (void)size;
+    return (ptr ? ptr : pool_alloc(pool, 0));
+}
+
+static void x__pool_deallocate(void *pool, void *ptr)
+{
+    pool_free(pool, ptr);
+}
+
+// return an allocator that allocates blocks from the pool; every allocation must fit into a block
+static Allocator pool_allocator(Pool *pool)
+{
+    assert(pool);
+    return (Allocator){
+        .allocate = x__pool_allocate,
+        .reallocate = x__pool_reallocate,
+        .deallocate = x__pool_deallocate,
+        .context = pool,
+    };
+}
@@ -0,0 +1,74 @@
+#include "queue.h"
+
+#include <pthread.h>
+#include <stdio.h>
+
+enum { THREADS = 2, ITEMS = 100000, BATCH = 8 };
+
+// push the integers 1 through ITEMS, a batch at a time
+void *produce(void *arg)
+{
+    Queue *queue = arg;
+    long value[BATCH];
+    void *data[BATCH];
+    for (long i = 1; i <= ITEMS; i += BATCH) {
+        for (long j = 0; j < BATCH; ++j) {
+            value[j] = i + j;
+            data[j] = &value[j];
+        }
+        for (long n = 0; n < BATCH;) n += queue_push_many(queue, data + n, BATCH - n);
+    }
+    return 0;
+}
+
+// pop ITEMS integers, and return their sum
+void *consume(void *arg)
+{
+    Queue *queue = arg;
+    long data, *sum = calloc(1, sizeof(*sum));
+    for (long n = 0; n < ITEMS;) {
+        if (!queue_pop(queue, &data)) continue;
+        *sum += data;
+        n += 1;
+    }
+    return sum;
+}
+
+int main(void)
+{
+    // create a queue that stores integers, and push integers 0 through 9
+    Queue a = queue_create(10, sizeof(int));
+    for (int i = 0; i < 10; ++i) queue_push(&a, &i);
+
+    // pop the first three items (the caller owns their data)
+    printf("a.pop() = {");
+    for (int i = 0; i < 3; ++i) {
+        int *data;
+        queue_pop(&a, &data);
+        printf("%d, ", *data);
+        free(data);
+    }
+    printf("}\n");
+    printf("a.size = %ld\n", queue_size(&a));
+
+    // create a flat queue that stores integers inline, and pass integers between threads
+    Queue b = queue_create_full(1024, sizeof(long), memcpy, 0, 0, QUEUE_FLAT);
+    pthread_t producer[THREADS], consumer[THREADS];
+    for (long i = 0; i < THREADS; ++i) {
+        pthread_create(&producer[i], 0, produce, &b);
+        pthread_create(&consumer[i], 0, consume, &b);
+    }
+    long sum = 0;
+    for (long i = 0; i < THREADS; ++i) {
+        long *_sum;
+        pthread_join(producer[i], 0);
+        pthread_join(consumer[i], (void **)&_sum);
+        sum += *_sum;
+        free(_sum);
+    }
+    printf("b.sum = %ld (expected %ld)\n", sum, THREADS * (ITEMS * (ITEMS + 1L) / 2));
+
+    // clear items
+    queue_clear(&a);
+    queue_clear(&b);
+}
@@ -0,0 +1,206 @@
+#pragma once
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "hash.h"
+
+// bounded lock-free multi-producer multi-consumer queue (ring buffer with one sequence number per
+// cell, after Dmitry Vyukov); the allocator must be thread-safe if data is copied in pointer mode
+typedef struct Queue Queue;
+typedef struct QueueCell QueueCell;
+typedef void *QueueDataCopy(void *, const void *, size_t);
+typedef void QueueDataFree(void *);
+
+// store data inline in the cells instead of one allocation per item
+enum { QUEUE_FLAT = 1 << 0 };
+
+// head and tail are on separate cache lines, so that producers and consumers do not contend for
+// the same line
+enum { X__QUEUE_ALIGN = 64 };
+
+struct Queue {
+    long capacity, data_size, item_size, cell_size;
+    int flags;
+    QueueDataCopy *data_copy;
+    QueueDataFree *data_free;
+    Allocator alloc;
+    char *cell;
+    alignas(X__QUEUE_ALIGN) atomic_long head;
+    alignas(X__QUEUE_ALIGN) atomic_long tail;
+};
+
+// a cell can be written by the producer of position seq, and read by the consumer of position
+// seq - 1; its item is either the data itself (flat mode) or a pointer to it
+struct QueueCell {
+    atomic_long seq;
+    alignas(max_align_t) unsigned char item[];
+};
+
+// create an empty queue that holds up to capacity items; the capacity is rounded up to a power of
+// two; in flat mode, data_copy is required and data_free must not free the data
+static Queue queue_create_full(long capacity, long data_size, QueueDataCopy *data_copy,
+                               QueueDataFree *data_free, const Allocator *alloc, int flags)
+{
+    assert(capacity > 0);
+    assert(data_size >= 0);
+    assert(!(flags & QUEUE_FLAT) || (data_size > 0 && data_copy));
+    const long item_size = (flags & QUEUE_FLAT ? data_size : (long)sizeof(void *));
+    const long align = alignof(QueueCell);
+    Queue queue = {
+        .capacity = hash_capacity(capacity),
+        .data_size = data_size,
+        .item_size = item_size,
+        .cell_size = (sizeof(QueueCell) + item_size + align - 1) / align * align,
+        .flags = flags,
+        .data_copy = data_copy,
+        .data_free = data_free,
+        .alloc = (alloc ? *alloc : allocator_std),
+    };
+    queue.cell = allocator_alloc(&queue.alloc, queue.capacity, queue.cell_size, 0);
+    assert(queue.cell);
+    for (long i = 0; i < queue.capacity; ++i)
+        atomic_init(&((QueueCell *)(queue.cell + i * queue.cell_size))->seq, i);
+    atomic_init(&queue.head, 0);
+    atomic_init(&queue.tail, 0);
+    return queue;
+}
+static Queue queue_create(long capacity, long data_size)
+{
+    return queue_create_full(capacity, data_size, memcpy, free, 0, 0);
+}
+
+static QueueCell *x__queue_cell(const Queue *queue, long pos)
+{
+    return (QueueCell *)(queue->cell + (pos & (queue->capacity - 1)) * queue->cell_size);
+}
+
+// claim up to count consecutive positions of head or tail whose cells have the sequence number
+// pos + offset, and return the first one; the number of claimed positions is stored in count
+static long x__queue_claim(Queue *queue, atomic_long *end, long offset, long *count)
+{
+    long pos = atomic_load_explicit(end, memory_order_relaxed);
+    while (1) {
+        long n = 0;
+        while (n < *count) {
+            const QueueCell *cell = x__queue_cell(queue, pos + n);
+            const long seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+            if (seq != pos + n + offset) break;
+            n += 1;
+        }
+        if (n == 0) {
+            // the cell is still in use by the previous round, unless another thread was faster
+            const long _pos = atomic_load_explicit(end, memory_order_relaxed);
+            if (_pos == pos) break;
+            pos = _pos;
+        }
+        else if (atomic_compare_exchange_weak_explicit(end, &pos, pos + n, memory_order_relaxed,
+                                                       memory_order_relaxed)) {
+            *count = n;
+            return pos;
+        }
+    }
+    *count = 0;
+    return pos;
+}
+
+static void x__queue_write(Queue *queue, long pos, void *data)
+{
+    QueueCell *cell = x__queue_cell(queue, pos);
+    if (queue->flags & QUEUE_FLAT) {
+        queue->data_copy(cell->item, data, queue->data_size);
+    }
+    else if (data && queue->data_copy) {
+        void *copy = allocator_alloc(&queue->alloc, 1, queue->data_size, 0);
+        assert(copy);
+        queue->data_copy(copy, data, queue->data_size);
+        memcpy(cell->item, &copy, sizeof(copy));
+    }
+    else {
+        memcpy(cell->item, &data, sizeof(data));
+    }
+    atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+}
+
+static void x__queue_read(Queue *queue, long pos, void *data)
+{
+    QueueCell *cell = x__queue_cell(queue, pos);
+    if (data) memcpy(data, cell->item, queue->item_size);
+    atomic_store_explicit(&cell->seq, pos + queue->capacity, memory_order_release);
+}
+
+// append an item, and return whether there was room for it
+static int queue_push(Queue *queue, void *data)
+{
+    assert(queue);
+    long count = 1;
+    const long pos = x__queue_claim(queue, &queue->tail, 0, &count);
+    if (count) x__queue_write(queue, pos, data);
+    return count;
+}
+
+// append up to count items data[i] with a single claim, and return the number of appended items
+static long queue_push_many(Queue *queue, void *const *data, long count)
+{
+    assert(queue);
+    assert(data || count == 0);
+    assert(count >= 0);
+    const long pos = x__queue_claim(queue, &queue->tail, 0, &count);
+    for (long i = 0; i < count; ++i) x__queue_write(queue, pos + i, data[i]);
+    return count;
+}
+
+// remove the first item, copy it to data (if data is not 0), and return whether there was one; the
+// item is the data itself in flat mode, and a pointer to the data otherwise (which the caller then
+// owns)
+static int queue_pop(Queue *queue, void *data)
+{
+    assert(queue);
+    long count = 1;
+    const long pos = x__queue_claim(queue, &queue->head, 1, &count);
+    if (count) x__queue_read(queue, pos, data);
+    return count;
+}
+
+// remove up to count items with a single claim, copy them to consecutive items of data (if data is
+// not 0), and return the number of removed items
+static long queue_pop_many(Queue *queue, void *data, long count)
+{
+    assert(queue);
+    assert(count >= 0);
+    const long pos = x__queue_claim(queue, &queue->head, 1, &count);
+    for (long i = 0; i < count; ++i)
+        x__queue_read(queue, pos + i, (data ? (char *)data + i * queue->item_size : 0));
+    return count;
+}
+
+// return the number of items; the count is only exact if no other thread modifies the queue
+static long queue_size(const Queue *queue)
+{
+    assert(queue);
+    const long head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    const long tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    return (tail > head ? tail - head : 0);
+}
+
+// remove all items from the queue, and release the cells; no other thread may use it anymore
+static void queue_clear(Queue *queue)
+{
+    assert(queue);
+    if (!queue->cell) return;
+    if (queue->data_free) {
+        const long tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+        for (long pos = atomic_load(&queue->head); pos < tail; ++pos) {
+            QueueCell *cell = x__queue_cell(queue, pos);
+            void *data = cell->item;
+            if (!(queue->flags & QUEUE_FLAT)) memcpy(&data, cell->item, sizeof(data));
+            queue->data_free(data);
+        }
+    }
+    allocator_free(&queue->alloc, queue->cell);
+    *queue = (Queue){0};
+}
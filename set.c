@@ -2,6 +2,21 @@
 
 #include <stdio.h>
 
+// integer hash function
+uint64_t inthash(int a)
+{
+    return memhash_fnv1a(&a, sizeof(a));
+}
+
+// integer equality function
+int inteq(int a, int b)
+{
+    return a == b;
+}
+
+// define a typed set of integers
+SET_DEFINE(IntSet, int, inthash, inteq)
+
 int main(void)
 {
     // create a set that stores integers
@@ -30,7 +45,74 @@ int main(void)
     printf("a.find(6) = %p\n", set_find(&a, (int[]){6}));
     printf("b.find(6) = %p\n", set_find(&b, (int[]){6}));
 
+    // create a flat set that stores integers inline, and insert integers 0 through 9
+    Set c = set_create_full(10, sizeof(int), 0.75, memhash_fnv1a, memcpy, 0, 0, SET_FLAT);
+    for (int i = 0; i < 10; ++i) set_insert(&c, &i, 0);
+
+    // remove the item 6 from set c (the data must not be freed)
+    printf("c.remove(6) = %d\n", *(int *)set_remove(&c, (int[]){6}));
+
+    // print items of set c
+    printf("c = {");
+    SetForEachFlat(item, &c) printf("%d, ", *(int *)item->data);
+    printf("}\n");
+
+    // create a typed set of integers, and insert integers 0 through 9
+    IntSet d = IntSet_create(10, 0);
+    for (int i = 0; i < 10; ++i) IntSet_insert(&d, i);
+
+    // remove the item 6 from set d, and print the remaining items
+    IntSet_remove(&d, 6);
+    printf("d = {");
+    SetForEachTyped(item, &d) printf("%d, ", item->data);
+    printf("}\n");
+
+    // insert integers 0 through 9 into a flat set at once, and find some of them at once
+    int value[10];
+    void *data[10];
+    for (int i = 0; i < 10; ++i) {
+        value[i] = i;
+        data[i] = &value[i];
+    }
+    Set e = set_create_full(0, sizeof(int), 0.75, memhash_fnv1a, memcpy, 0, 0, SET_FLAT);
+    set_insert_many(&e, data, 10, 0);
+    void *found[3];
+    set_find_many(&e, (const void *[]){&(int){2}, &(int){12}, &(int){4}}, found, 3);
+    printf("e.find_many(2, 12, 4) = {%d, %p, %d}\n", *(int *)found[0], found[1], *(int *)found[2]);
+
+    // insert the integers twice into a set that stores copies of them; the second time, every copy
+    // is replaced by a new one (and freed), so that the set still owns all of its data
+    Set h = set_create(0, sizeof(int));
+    set_insert_many(&h, data, 10, 0);
+    set_insert_many(&h, data, 10, 0);
+    printf("h.size = %ld\n", h.size);
+
+    // create a flat set of the even integers 0 through 18, and combine it with set c (both must
+    // have the same data size and hash function)
+    Set f = set_create_full(10, sizeof(int), 0.75, memhash_fnv1a, memcpy, 0, 0, SET_FLAT);
+    for (int i = 0; i < 20; i += 2) set_insert(&f, &i, 0);
+    Set g[3] = {set_union(&c, &f), set_intersection(&c, &f), set_difference(&c, &f)};
+    const char *name[3] = {"union", "intersection", "difference"};
+    for (int i = 0; i < 3; ++i) {
+        printf("c.%s(f) = {", name[i]);
+        SetForEachFlat(item, &g[i]) printf("%d, ", *(int *)item->data);
+        printf("}\n");
+    }
+    printf("c.intersection(f).issubset(f) = %d\n", set_issubset(&g[1], &f));
+
+    // keep only the items of set e that are also in set f
+    set_intersection_update(&e, &f);
+    printf("e = {");
+    SetForEachFlat(item, &e) printf("%d, ", *(int *)item->data);
+    printf("}\n");
+
     // clear items
     set_clear(&a);
     set_clear(&b);
+    set_clear(&c);
+    IntSet_clear(&d);
+    set_clear(&e);
+    set_clear(&f);
+    for (int i = 0; i < 3; ++i) set_clear(&g[i]);
+    set_clear(&h);
 }
@@ -1,25 +1,53 @@
 #pragma once
 
 #include <assert.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "allocator.h"
 #include "hash.h"
+#include "hashstats.h"
 
-// general purpose set using hashing and open addressing
+// general purpose set using hashing and open addressing with robin hood hashing
 typedef struct Set Set;
 typedef struct SetItem SetItem;
+typedef struct SetFlatItem SetFlatItem;
 typedef uint64_t SetDataHash(const void *mem, long size);
 typedef void *SetDataCopy(void *, const void *, size_t);
 typedef void SetDataFree(void *);
 
+// store data inline in one contiguous buffer instead of one allocation per item
+enum { SET_FLAT = 1 << 0 };
+
+// grow incrementally: keep the old table after a resize, and move a few of its slots to the new
+// table with every insert and remove, instead of rehashing all items at once
+enum { SET_INCREMENTAL = 1 << 1 };
+
+// number of slots of the old table that are moved with every insert and remove in incremental mode
+enum { X__SET_MOVE = 16 };
+
+// number of items that are hashed and prefetched at once by the batched functions
+enum { X__SET_BATCH = 16 };
+
 struct Set {
-    long size, capacity, data_size, max_dist;
+    long size, capacity, data_size, item_size, max_dist;
     double load_factor;
+    int flags;
     SetDataHash *data_hash;
     SetDataCopy *data_copy;
     SetDataFree *data_free;
-    SetItem *item;
+    Allocator alloc;
+    union {
+        SetItem *item;
+        void *data;
+    };
+    long *dist_count, dist_capacity;
+    Set *old;
+    long old_index;
+#ifdef HASH_STATS
+    HashStats *stats;
+#endif
 };
 
 struct SetItem {
@@ -27,73 +55,347 @@ struct SetItem {
     uint64_t hash;
 };
 
-#define SetForEach(item, set)                                                       \
-    for (SetItem *item = (set)->item; item < (set)->item + (set)->capacity; ++item) \
-        if (item->data)
+struct SetFlatItem {
+    uint64_t hash;
+    char data[];
+};
+
+// iterate over the items of the current and the old table in one loop, so that break ends it
+#define SetForEach(item, set)                                    \
+    for (const Set *x__##item = (set); x__##item; x__##item = 0) \
+        for (SetItem *item = x__set_next(x__##item, 0); item; item = x__set_next(x__##item, item))
 
-// create an empty set
+#define SetForEachFlat(item, set)                                 \
+    for (const Set *x__##item = (set); x__##item; x__##item = 0)  \
+        for (SetFlatItem *item = x__set_next(x__##item, 0); item; \
+             item = x__set_next(x__##item, item))
+
+// create an empty set; the capacity is rounded up to a power of two; in flat mode, data_copy is
+// required and data_free must not free the data
 static Set set_create_full(long capacity, long data_size, double load_factor,
-                           SetDataHash *data_hash, SetDataCopy *data_copy, SetDataFree *data_free)
+                           SetDataHash *data_hash, SetDataCopy *data_copy, SetDataFree *data_free,
+                           const Allocator *alloc, int flags)
 {
     assert(capacity >= 0);
     assert(data_size >= 0);
     assert(0 < load_factor && load_factor < 1);
     assert(data_hash);
+    assert(!(flags & SET_FLAT) || data_copy);
+    const long align = alignof(SetFlatItem);
+    const long flat_size = (sizeof(SetFlatItem) + data_size + align - 1) / align * align;
     return (Set){
-        .capacity = capacity / load_factor + 1,
+        .capacity = hash_capacity(capacity / load_factor + 1),
         .data_size = data_size,
+        .item_size = (flags & SET_FLAT ? flat_size : (long)sizeof(SetItem)),
         .load_factor = load_factor,
+        .flags = flags,
         .data_hash = data_hash,
         .data_copy = data_copy,
         .data_free = data_free,
+        .alloc = (alloc ? *alloc : allocator_std),
     };
 }
 static Set set_create(long capacity, long data_size)
 {
-    return set_create_full(capacity, data_size, 0.75, memhash_fnv1a, memcpy, free);
+    return set_create_full(capacity, data_size, 0.75, memhash_wyhash, memcpy, free, 0, 0);
+}
+
+static long x__set_slots(const Set *set, long capacity)
+{
+    return capacity + (set->flags & SET_FLAT ? 1 : 0);
+}
+
+static void *x__set_item(const Set *set, void *items, long i)
+{
+    return (char *)items + i * set->item_size;
+}
+
+static uint64_t x__set_item_hash(const Set *set, const void *item)
+{
+    if (set->flags & SET_FLAT) return ((const SetFlatItem *)item)->hash;
+    return ((const SetItem *)item)->hash;
+}
+
+static void *x__set_item_data(const Set *set, void *item)
+{
+    if (set->flags & SET_FLAT) {
+        SetFlatItem *flat = item;
+        return (flat->hash ? flat->data : 0);
+    }
+    return ((SetItem *)item)->data;
+}
+
+// return the slot after item (or the first slot if item is 0) whose data is set, continuing in
+// the old table after the last slot of the current one
+static void *x__set_next(const Set *set, const void *item)
+{
+    for (const Set *table = set; table; table = table->old) {
+        if (!table->data) continue;
+        char *next = table->data, *end = next + table->capacity * table->item_size;
+        if (item) {
+            if ((char *)item < next || (char *)item >= end) continue;
+            next = (char *)item + table->item_size;
+            item = 0;
+        }
+        for (; next < end; next += table->item_size)
+            if (x__set_item_data(table, next)) return next;
+    }
+    return 0;
+}
+
+static uint64_t x__set_hash(const Set *set, const void *data)
+{
+    const uint64_t hash = set->data_hash(data, set->data_size);
+    return hash + !hash;  // zero marks empty flat items
 }
 
 static void x__set_create_items(Set *set)
 {
-    set->item = calloc(set->capacity, sizeof(*set->item));
-    assert(set->item);
+    set->data = allocator_alloc(&set->alloc, x__set_slots(set, set->capacity), set->item_size, 1);
+    assert(set->data);
+    X__HASH_STATS(set->stats = x__hash_stats_create(set->stats, &set->alloc));
+    X__HASH_STATS(
+        x__hash_stats_alloc(set->stats, x__set_slots(set, set->capacity) * set->item_size));
 }
 
-static void x__set_resize_items(Set *set)
+static long x__set_home(const Set *set, uint64_t hash)
 {
-    assert(set);
-    const long _capacity = set->capacity / set->load_factor + 1;
-    SetItem *_item = calloc(_capacity, sizeof(*_item));
-    assert(_item);
-    long _max_dist = 0;
-    for (SetItem *item = set->item; item < set->item + set->capacity; ++item) {
-        if (!item->data) continue;
-        long _dist = 0, _i = item->hash % _capacity;
-        while (_item[_i].data) {
-            _dist += 1;
-            _i = (_i + 1) % _capacity;
+    return hash_mix(hash) & (set->capacity - 1);
+}
+
+static long x__set_dist(const Set *set, long i)
+{
+    const uint64_t hash = x__set_item_hash(set, x__set_item(set, set->data, i));
+    return (i - x__set_home(set, hash)) & (set->capacity - 1);
+}
+
+// keep track of the number of items per probe distance, so that max_dist can also shrink
+static void x__set_count_dist(Set *set, long dist, long count)
+{
+    if (dist >= set->dist_capacity) {
+        const long _dist_capacity = 2 * dist + 1;
+        set->dist_count = allocator_realloc(&set->alloc, set->dist_count,
+                                            _dist_capacity * sizeof(*set->dist_count));
+        assert(set->dist_count);
+        memset(set->dist_count + set->dist_capacity, 0,
+               (_dist_capacity - set->dist_capacity) * sizeof(*set->dist_count));
+        set->dist_capacity = _dist_capacity;
+    }
+    set->dist_count[dist] += count;
+    if (dist > set->max_dist) set->max_dist = dist;
+    while (set->max_dist > 0 && !set->dist_count[set->max_dist]) set->max_dist -= 1;
+}
+
+static void x__set_swap_items(const Set *set, void *a, void *b)
+{
+    char *_a = a, *_b = b;
+    for (long i = 0; i < set->item_size; ++i) {
+        const char swap = _a[i];
+        _a[i] = _b[i];
+        _b[i] = swap;
+    }
+}
+
+// place an item that is not in the set, starting at position i with probe distance dist; an item
+// that is further from its home slot takes the slot of one that is closer to it (robin hood); the
+// item is used as scratch space for the displaced items
+static void x__set_place_item(Set *set, void *item, long i, long dist)
+{
+    void *slot;
+    while (x__set_item_data(set, slot = x__set_item(set, set->data, i))) {
+        const long _dist = x__set_dist(set, i);
+        if (_dist < dist) {
+            x__set_swap_items(set, slot, item);
+            x__set_count_dist(set, dist, 1);
+            x__set_count_dist(set, _dist, -1);
+            dist = _dist;
         }
-        _item[_i].data = item->data;
-        _item[_i].hash = item->hash;
-        if (_dist > _max_dist) _max_dist = _dist;
+        dist += 1;
+        i = (i + 1) & (set->capacity - 1);
+    }
+    memcpy(slot, item, set->item_size);
+    x__set_count_dist(set, dist, 1);
+}
+
+// remove the item at a given position by shifting back the items that follow it, until one is
+// found that is in its home slot
+static void x__set_delete_item(Set *set, long i)
+{
+    x__set_count_dist(set, x__set_dist(set, i), -1);
+    long j = (i + 1) & (set->capacity - 1), dist;
+    while (x__set_item_data(set, x__set_item(set, set->data, j)) &&
+           (dist = x__set_dist(set, j)) > 0) {
+        x__set_count_dist(set, dist, -1);
+        x__set_count_dist(set, dist - 1, 1);
+        memcpy(x__set_item(set, set->data, i), x__set_item(set, set->data, j), set->item_size);
+        i = j;
+        j = (j + 1) & (set->capacity - 1);
+    }
+    memset(x__set_item(set, set->data, i), 0, set->item_size);
+}
+
+// return a copy of data that is owned by the set (or data itself if there is no copy function)
+static void *x__set_data_create(const Set *set, void *data)
+{
+    if (!set->data_copy) return data;
+    void *_data = allocator_alloc(&set->alloc, 1, set->data_size, 0);
+    assert(_data);
+    set->data_copy(_data, data, set->data_size);
+    X__HASH_STATS(x__hash_stats_alloc(set->stats, set->data_size));
+    return _data;
+}
+
+static void x__set_item_create(const Set *set, void *item, void *data, uint64_t hash)
+{
+    if (set->flags & SET_FLAT) {
+        SetFlatItem *flat = item;
+        set->data_copy(flat->data, data, set->data_size);
+        flat->hash = hash;
+        return;
+    }
+    SetItem *ptr = item;
+    ptr->data = x__set_data_create(set, data);
+    ptr->hash = hash;
+}
+
+// keep or replace the data of an item (in flat mode, the data is always kept), and return its old
+// data; the new data is copied if copy is set (as by the bulk inserts, which take ownership of the
+// replaced data)
+static void *x__set_item_replace(const Set *set, void *item, void *data, int keep, int copy)
+{
+    void *item_data = x__set_item_data(set, item);
+    if (!keep && !(set->flags & SET_FLAT))
+        ((SetItem *)item)->data = (copy ? x__set_data_create(set, data) : data);
+    return item_data;
+}
+
+// return the position of an item in the current table (not the old one), or -1 if there is none;
+// the probe length is added to probe
+static long x__set_find_item(const Set *set, const void *data, uint64_t hash,
+                             [[maybe_unused]] long *probe)
+{
+    long i = x__set_home(set, hash);
+    void *item = x__set_item(set, set->data, i), *item_data;
+    for (long dist = 0; (item_data = x__set_item_data(set, item)) && dist <= x__set_dist(set, i);
+         ++dist) {
+        X__HASH_STATS(*probe += 1);
+        X__HASH_STATS(x__hash_stats_compare(set->stats, x__set_item_hash(set, item) == hash));
+        if (x__set_item_hash(set, item) == hash && !memcmp(item_data, data, set->data_size))
+            return i;
+        i = (i + 1) & (set->capacity - 1);
+        item = x__set_item(set, set->data, i);
+    }
+    return -1;
+}
+
+// return the data of an item from the current or the old table
+static void *x__set_find_data(const Set *set, const void *data, uint64_t hash)
+{
+    const Set *table = set;
+    long probe = 0;
+    long i = x__set_find_item(set, data, hash, &probe);
+    if (i < 0 && set->old && (i = x__set_find_item(set->old, data, hash, &probe)) >= 0)
+        table = set->old;
+    X__HASH_STATS(x__hash_stats_find(set->stats, probe));
+    return (i < 0 ? 0 : x__set_item_data(table, x__set_item(table, table->data, i)));
+}
+
+// move the items of a few slots of the old table to the current one, and release the old table
+// once it is empty
+static void x__set_move_items(Set *set)
+{
+    Set *old = set->old;
+    SetItem _item;
+    void *carry = (set->flags & SET_FLAT ? x__set_item(set, set->data, set->capacity) : &_item);
+    for (long n = 0; n < X__SET_MOVE && old->size > 0; ++n) {
+        void *item = x__set_item(old, old->data, set->old_index);
+        if (!x__set_item_data(old, item)) {
+            set->old_index += 1;
+            continue;
+        }
+        memcpy(carry, item, set->item_size);
+        x__set_delete_item(old, set->old_index);
+        old->size -= 1;
+        x__set_place_item(set, carry, x__set_home(set, x__set_item_hash(set, carry)), 0);
+    }
+    if (old->size > 0) return;
+    allocator_free(&set->alloc, old->data);
+    allocator_free(&set->alloc, old->dist_count);
+    allocator_free(&set->alloc, old);
+    set->old = 0;
+}
+
+// rehash all items at once into a table of a given capacity
+static void x__set_rehash_items(Set *set, long capacity)
+{
+    const long _capacity = set->capacity;
+    void *data = set->data;
+    set->capacity = capacity;
+    if (set->dist_count) memset(set->dist_count, 0, set->dist_capacity * sizeof(long));
+    x__set_create_items(set);
+    set->max_dist = 0;
+    for (long i = 0; i < _capacity; ++i) {
+        void *item = x__set_item(set, data, i);
+        if (x__set_item_data(set, item))
+            x__set_place_item(set, item, x__set_home(set, x__set_item_hash(set, item)), 0);
     }
-    free(set->item);
-    set->item = _item;
-    set->capacity = _capacity;
-    set->max_dist = _max_dist;
+    allocator_free(&set->alloc, data);
 }
 
-static void x__set_item_create(const Set *set, SetItem *item, void *data, uint64_t hash)
+// grow the table; in incremental mode, the items are moved later by x__set_move_items
+static void x__set_resize_items(Set *set)
 {
-    if (set->data_copy) {
-        item->data = malloc(set->data_size);
-        assert(item->data);
-        set->data_copy(item->data, data, set->data_size);
+    assert(set);
+    while (set->old) x__set_move_items(set);
+    if (!(set->flags & SET_INCREMENTAL)) {
+        x__set_rehash_items(set, 2 * set->capacity);
+        return;
     }
-    else {
-        item->data = data;
+    Set *old = allocator_alloc(&set->alloc, 1, sizeof(*old), 0);
+    assert(old);
+    *old = *set;
+    set->old = old;
+    set->old_index = 0;
+    set->capacity = 2 * set->capacity;
+    set->dist_count = 0;
+    set->dist_capacity = 0;
+    x__set_create_items(set);
+    set->max_dist = 0;
+}
+
+// insert an item into a table that has room for it (see x__set_item_replace for keep and copy); the
+// probe length is added to probe
+static void *x__set_insert_item(Set *set, void *data, uint64_t hash, int keep, int copy,
+                                long *probe)
+{
+    long i;
+    if (set->old && (i = x__set_find_item(set->old, data, hash, probe)) >= 0)
+        return x__set_item_replace(set, x__set_item(set->old, set->old->data, i), data, keep, copy);
+    long dist = 0;
+    i = x__set_home(set, hash);
+    void *item = x__set_item(set, set->data, i), *item_data;
+    while ((item_data = x__set_item_data(set, item)) && dist <= x__set_dist(set, i)) {
+        X__HASH_STATS(*probe += 1);
+        X__HASH_STATS(x__hash_stats_compare(set->stats, x__set_item_hash(set, item) == hash));
+        if (x__set_item_hash(set, item) == hash && !memcmp(item_data, data, set->data_size))
+            return x__set_item_replace(set, item, data, keep, copy);
+        dist += 1;
+        i = (i + 1) & (set->capacity - 1);
+        item = x__set_item(set, set->data, i);
     }
-    item->hash = hash;
+    SetItem _item;
+    void *carry = (set->flags & SET_FLAT ? x__set_item(set, set->data, set->capacity) : &_item);
+    x__set_item_create(set, carry, data, hash);
+    x__set_place_item(set, carry, i, dist);
+    set->size += 1;
+    return 0;
+}
+
+// prefetch the home slot of a hash in the current and the old table
+static void x__set_prefetch(const Set *set, uint64_t hash)
+{
+    for (const Set *table = set; table; table = table->old)
+        x__hash_prefetch(x__set_item(table, table->data, x__set_home(table, hash)));
 }
 
 // insert an item; on collision, keep or replace data and return old data
@@ -101,27 +403,55 @@ static void *set_insert(Set *set, void *data, int keep)
 {
     assert(set);
     assert(data);
-    if (!set->item) x__set_create_items(set);
-    if (set->size + 1 > set->capacity * set->load_factor) x__set_resize_items(set);
-    const uint64_t hash = set->data_hash(data, set->data_size);
-    long dist = 0, i = hash % set->capacity;
-    SetItem *item = &set->item[i];
-    while (item->data && (item->hash != hash || memcmp(item->data, data, set->data_size))) {
-        dist += 1;
-        i = (i + 1) % set->capacity;
-        item = &set->item[i];
+    if (!set->data) x__set_create_items(set);
+    if (set->size + 1 > set->capacity * set->load_factor) {
+        X__HASH_STATS(const double start = x__hash_stats_now());
+        x__set_resize_items(set);
+        X__HASH_STATS(x__hash_stats_resize(set->stats, start));
     }
-    if (!item->data) {
-        x__set_item_create(set, item, data, hash);
-        if (dist > set->max_dist) set->max_dist = dist;
+    if (set->old) x__set_move_items(set);
+    long probe = 0;
+    void *item_data = x__set_insert_item(set, data, x__set_hash(set, data), keep, 0, &probe);
+    X__HASH_STATS(x__hash_stats_insert(set->stats, probe));
+    return item_data;
+}
+
+// insert count items with data data[i]; the table is grown at most once beforehand, and the items
+// are hashed and their slots prefetched in batches; on collision, keep or replace data (replaced
+// data is freed, and the new data is copied, as for new items)
+static void set_insert_many(Set *set, void *const *data, long count, int keep)
+{
+    assert(set);
+    assert(data || count == 0);
+    assert(count >= 0);
+    long capacity = set->capacity;
+    while (set->size + count > capacity * set->load_factor) capacity *= 2;
+    if (!set->data) {
+        set->capacity = capacity;
+        x__set_create_items(set);
     }
-    else {
-        void *item_data = item->data;
-        if (!keep) item->data = data;
-        return item_data;
+    else if (capacity > set->capacity) {
+        X__HASH_STATS(const double start = x__hash_stats_now());
+        while (set->old) x__set_move_items(set);
+        x__set_rehash_items(set, capacity);
+        X__HASH_STATS(x__hash_stats_resize(set->stats, start));
+    }
+    uint64_t hash[X__SET_BATCH];
+    for (long first = 0; first < count; first += X__SET_BATCH) {
+        const long n = (count - first < X__SET_BATCH ? count - first : X__SET_BATCH);
+        for (long i = 0; i < n; ++i) {
+            hash[i] = x__set_hash(set, data[first + i]);
+            x__set_prefetch(set, hash[i]);
+        }
+        for (long i = 0; i < n; ++i) {
+            if (set->old) x__set_move_items(set);
+            long probe = 0;
+            void *replaced = x__set_insert_item(set, data[first + i], hash[i], keep, 1, &probe);
+            X__HASH_STATS(x__hash_stats_insert(set->stats, probe));
+            if (replaced && !keep && set->data_free && !(set->flags & SET_FLAT))
+                set->data_free(replaced);
+        }
     }
-    set->size += 1;
-    return 0;
 }
 
 // return a copy of the set
@@ -129,33 +459,44 @@ static Set set_copy(const Set *set)
 {
     assert(set);
     Set copy = set_create_full(set->size, set->data_size, set->load_factor, set->data_hash,
-                               set->data_copy, set->data_free);
+                               set->data_copy, set->data_free, &set->alloc, set->flags);
     if (set->size == 0) return copy;
-    for (const SetItem *item = set->item; item < set->item + set->capacity; ++item)
-        if (item->data) set_insert(&copy, item->data, 0);
+    for (const Set *table = set; table; table = table->old) {
+        for (long i = 0; i < table->capacity; ++i) {
+            void *item_data = x__set_item_data(table, x__set_item(table, table->data, i));
+            if (item_data) set_insert(&copy, item_data, 0);
+        }
+    }
     return copy;
 }
 
-// remove an item, and return its data
+// remove an item, and return its data; in flat mode, the data is only valid until the set is
+// modified again
 static void *set_remove(Set *set, const void *data)
 {
     assert(set);
     assert(data);
     if (set->size == 0) return 0;
-    const uint64_t hash = set->data_hash(data, set->data_size);
-    long i = hash % set->capacity;
-    SetItem *item = &set->item[i];
-    for (long dist = 0; dist <= set->max_dist; ++dist) {
-        if (item->data && item->hash == hash && !memcmp(item->data, data, set->data_size)) {
-            void *item_data = item->data;
-            memset(item, 0, sizeof(*item));
-            set->size -= 1;
-            return item_data;
-        }
-        i = (i + 1) % set->capacity;
-        item = &set->item[i];
+    if (set->old) x__set_move_items(set);
+    const uint64_t hash = x__set_hash(set, data);
+    Set *table = set;
+    long probe = 0;
+    long i = x__set_find_item(set, data, hash, &probe);
+    if (i < 0 && set->old && (i = x__set_find_item(set->old, data, hash, &probe)) >= 0)
+        table = set->old;
+    X__HASH_STATS(x__hash_stats_find(set->stats, probe));
+    if (i < 0) return 0;
+    void *item = x__set_item(table, table->data, i);
+    void *item_data = x__set_item_data(table, item);
+    if (set->flags & SET_FLAT) {
+        SetFlatItem *scratch = x__set_item(set, set->data, set->capacity);
+        memcpy(scratch, item, set->item_size);
+        item_data = scratch->data;
     }
-    return 0;
+    x__set_delete_item(table, i);
+    if (table != set) table->size -= 1;
+    set->size -= 1;
+    return item_data;
 }
 
 // return the data of an item
@@ -164,26 +505,299 @@ static void *set_find(const Set *set, const void *data)
     assert(set);
     assert(data);
     if (set->size == 0) return 0;
-    const uint64_t hash = set->data_hash(data, set->data_size);
-    long i = hash % set->capacity;
-    SetItem *item = &set->item[i];
-    for (long dist = 0; dist <= set->max_dist; ++dist) {
-        if (item->data && item->hash == hash && !memcmp(item->data, data, set->data_size))
-            return item->data;
-        i = (i + 1) % set->capacity;
-        item = &set->item[i];
+    return x__set_find_data(set, data, x__set_hash(set, data));
+}
+
+// find the data of count items with data data[i], and store it in found[i]; the items are hashed
+// and their slots prefetched in batches, so that the memory accesses of a batch overlap
+static void set_find_many(const Set *set, const void *const *data, void **found, long count)
+{
+    assert(set);
+    assert((data && found) || count == 0);
+    assert(count >= 0);
+    if (set->size == 0) {
+        for (long i = 0; i < count; ++i) found[i] = 0;
+        return;
+    }
+    uint64_t hash[X__SET_BATCH];
+    for (long first = 0; first < count; first += X__SET_BATCH) {
+        const long n = (count - first < X__SET_BATCH ? count - first : X__SET_BATCH);
+        for (long i = 0; i < n; ++i) {
+            hash[i] = x__set_hash(set, data[first + i]);
+            x__set_prefetch(set, hash[i]);
+        }
+        for (long i = 0; i < n; ++i)
+            found[first + i] = x__set_find_data(set, data[first + i], hash[i]);
+    }
+}
+
+// return whether a set that is either 0 or not empty contains an item with a given hash
+static int x__set_contains(const Set *set, const void *data, uint64_t hash)
+{
+    return (set && x__set_find_data(set, data, hash));
+}
+
+// create an empty set with the parameters of another one and room for size items, which is not
+// resized while they are inserted
+static Set x__set_create_like(const Set *set, long size)
+{
+    Set like = set_create_full(size, set->data_size, set->load_factor, set->data_hash,
+                               set->data_copy, set->data_free, &set->alloc, set->flags);
+    x__set_create_items(&like);
+    return like;
+}
+
+// insert the items of a batch whose presence in a set (if it is not 0) equals found into a result
+// set (unless it is 0), and return their number
+static long x__set_filter_batch(Set *result, const Set *other, void *const *data,
+                                const uint64_t *hash, long count, int found)
+{
+    long n = 0;
+    for (long i = 0; i < count; ++i) {
+        if (x__set_contains(other, data[i], hash[i]) != found) continue;
+        if (result) {
+            long probe = 0;
+            x__set_insert_item(result, data[i], hash[i], 1, 0, &probe);
+            X__HASH_STATS(x__hash_stats_insert(result->stats, probe));
+        }
+        n += 1;
+    }
+    return n;
+}
+
+// insert the items of a set whose presence in another set (if it is not 0) equals found into a
+// result set (unless it is 0) with their stored hashes, and return their number; the items are
+// visited in batches, whose slots in the other set are prefetched
+static long x__set_filter(Set *result, const Set *set, const Set *other, int found)
+{
+    assert(!other || (set->data_hash == other->data_hash && set->data_size == other->data_size));
+    if (set->size == 0) return 0;
+    if (other && other->size == 0) other = 0;
+    void *data[X__SET_BATCH];
+    uint64_t hash[X__SET_BATCH];
+    long n = 0, count = 0;
+    for (const Set *table = set; table; table = table->old) {
+        for (long i = 0; i < table->capacity; ++i) {
+            void *item = x__set_item(table, table->data, i);
+            if (!(data[n] = x__set_item_data(table, item))) continue;
+            hash[n] = x__set_item_hash(table, item);
+            if (other) x__set_prefetch(other, hash[n]);
+            if (++n < X__SET_BATCH) continue;
+            count += x__set_filter_batch(result, other, data, hash, n, found);
+            n = 0;
+        }
+    }
+    return count + x__set_filter_batch(result, other, data, hash, n, found);
+}
+
+// return a new set with the items of both sets; the result has the parameters of set a, and both
+// sets must have the same data size and hash function, so that the stored hashes are reused
+static Set set_union(const Set *a, const Set *b)
+{
+    assert(a && b);
+    Set result = x__set_create_like(a, a->size + b->size);
+    x__set_filter(&result, a, 0, 0);
+    x__set_filter(&result, b, a, 0);
+    return result;
+}
+
+// return a new set with the items that are in both sets (see set_union); the smaller set is
+// visited, and its items are looked up in the larger one
+static Set set_intersection(const Set *a, const Set *b)
+{
+    assert(a && b);
+    const Set *small = (a->size <= b->size ? a : b), *large = (small == a ? b : a);
+    Set result = x__set_create_like(a, small->size);
+    x__set_filter(&result, small, large, 1);
+    return result;
+}
+
+// return a new set with the items of set a that are not in set b (see set_union)
+static Set set_difference(const Set *a, const Set *b)
+{
+    assert(a && b);
+    Set result = x__set_create_like(a, a->size);
+    x__set_filter(&result, a, b, 0);
+    return result;
+}
+
+// return whether every item of set a is also in set b (see set_union)
+static int set_issubset(const Set *a, const Set *b)
+{
+    assert(a && b);
+    return (a->size <= b->size && x__set_filter(0, a, b, 0) == 0);
+}
+
+// remove the items of set a that are not in set b, without allocating (see set_union); a removed
+// item shifts the items that follow it back, so its slot is visited again
+static void set_intersection_update(Set *a, const Set *b)
+{
+    assert(a && b);
+    assert(a->data_hash == b->data_hash && a->data_size == b->data_size);
+    if (a->size == 0) return;
+    const Set *other = (b->size > 0 ? b : 0);
+    for (Set *table = a; table; table = table->old) {
+        for (long i = 0; i < table->capacity;) {
+            void *item = x__set_item(table, table->data, i);
+            void *item_data = x__set_item_data(table, item);
+            if (!item_data || x__set_contains(other, item_data, x__set_item_hash(table, item))) {
+                i += 1;
+                continue;
+            }
+            if (a->data_free && !(a->flags & SET_FLAT)) a->data_free(item_data);
+            x__set_delete_item(table, i);
+            if (table != a) table->size -= 1;
+            a->size -= 1;
+        }
     }
-    return 0;
 }
 
 // remove all items from the set
 static void set_clear(Set *set)
 {
     assert(set);
-    if (!set->item) return;
-    if (set->data_free)
-        for (SetItem *item = set->item; item < set->item + set->capacity; ++item)
-            if (item->data) set->data_free(item->data);
-    free(set->item);
+    if (!set->data) return;
+    if (set->old) {
+        X__HASH_STATS(set->old->stats = 0);
+        set_clear(set->old);
+        allocator_free(&set->alloc, set->old);
+    }
+    if (set->data_free) {
+        for (long i = 0; i < set->capacity; ++i) {
+            void *item_data = x__set_item_data(set, x__set_item(set, set->data, i));
+            if (item_data) set->data_free(item_data);
+        }
+    }
+    allocator_free(&set->alloc, set->data);
+    allocator_free(&set->alloc, set->dist_count);
+    X__HASH_STATS(allocator_free(&set->alloc, set->stats));
     *set = (Set){0};
 }
+
+#ifdef HASH_STATS
+// print the counters of the set to file, with the current distribution of probe distances
+static void set_stats_print(FILE *file, const Set *set)
+{
+    assert(file);
+    assert(set);
+    const double load = (set->capacity ? (double)set->size / set->capacity : 0);
+    fprintf(file, "set of %ld items in %ld slots (load %.3f of %.3f)%s\n", set->size,
+            set->capacity, load, set->load_factor, (set->old ? " while resizing" : ""));
+    if (!set->stats) return;
+    x__hash_stats_print(file, set->stats);
+    if (!set->dist_count) return;
+    fprintf(file, "%8s %12s\n", "distance", "items");
+    for (long dist = 0; dist <= set->max_dist; ++dist)
+        fprintf(file, "%8ld %12ld\n", dist, set->dist_count[dist]);
+}
+#endif
+
+// define a typed set `name` of items of type T, using data_hash(T) and data_eq(T, T); the
+// functions mirror the generic ones, but take and return items by value, and the item type and
+// functions are known at compile time, so they can be inlined
+#define SET_DEFINE(name, T, data_hash, data_eq)                                                  \
+    typedef struct name name;                                                                    \
+    typedef struct name##Item name##Item;                                                        \
+    struct name {                                                                                \
+        long size, capacity;                                                                     \
+        Allocator alloc;                                                                         \
+        name##Item *item;                                                                        \
+    };                                                                                           \
+    struct name##Item {                                                                          \
+        T data;                                                                                  \
+        uint64_t hash;                                                                           \
+    };                                                                                           \
+    [[maybe_unused]] static name name##_create(long capacity, const Allocator *alloc)            \
+    {                                                                                            \
+        assert(capacity >= 0);                                                                   \
+        const long _capacity = hash_capacity(capacity / 0.75 + 1);                               \
+        return (name){.capacity = _capacity, .alloc = (alloc ? *alloc : allocator_std)};         \
+    }                                                                                            \
+    [[maybe_unused]] static uint64_t x__##name##_hash(T data)                                    \
+    {                                                                                            \
+        const uint64_t _hash = hash_mix(data_hash(data));                                        \
+        return _hash + !_hash;                                                                   \
+    }                                                                                            \
+    [[maybe_unused]] static name##Item *x__##name##_slot(name##Item *item, long capacity,        \
+                                                         T data, uint64_t _hash)                 \
+    {                                                                                            \
+        long i = _hash & (capacity - 1);                                                         \
+        while (item[i].hash && (item[i].hash != _hash || !data_eq(item[i].data, data)))          \
+            i = (i + 1) & (capacity - 1);                                                        \
+        return &item[i];                                                                         \
+    }                                                                                            \
+    [[maybe_unused]] static void x__##name##_resize_items(name *set)                             \
+    {                                                                                            \
+        const long _capacity = (set->item ? 2 * set->capacity : set->capacity);                  \
+        name##Item *_item = allocator_alloc(&set->alloc, _capacity, sizeof(name##Item), 1);      \
+        assert(_item);                                                                           \
+        for (long i = 0; set->item && i < set->capacity; ++i)                                    \
+            if (set->item[i].hash)                                                               \
+                *x__##name##_slot(_item, _capacity, set->item[i].data, set->item[i].hash) =      \
+                    set->item[i];                                                                \
+        allocator_free(&set->alloc, set->item);                                                  \
+        set->item = _item;                                                                       \
+        set->capacity = _capacity;                                                               \
+    }                                                                                            \
+    [[maybe_unused]] static int name##_insert(name *set, T data)                                 \
+    {                                                                                            \
+        assert(set);                                                                             \
+        if (!set->item) x__##name##_resize_items(set);                                           \
+        if (set->size + 1 > set->capacity * 0.75) x__##name##_resize_items(set);                 \
+        const uint64_t _hash = x__##name##_hash(data);                                           \
+        name##Item *item = x__##name##_slot(set->item, set->capacity, data, _hash);              \
+        if (item->hash) return 1;                                                                \
+        *item = (name##Item){.data = data, .hash = _hash};                                       \
+        set->size += 1;                                                                          \
+        return 0;                                                                                \
+    }                                                                                            \
+    [[maybe_unused]] static name name##_copy(const name *set)                                    \
+    {                                                                                            \
+        assert(set);                                                                             \
+        name copy = {.capacity = set->capacity, .alloc = set->alloc};                            \
+        if (set->size == 0) return copy;                                                         \
+        copy.item = allocator_alloc(&copy.alloc, copy.capacity, sizeof(name##Item), 0);          \
+        assert(copy.item);                                                                       \
+        memcpy(copy.item, set->item, set->capacity * sizeof(name##Item));                        \
+        copy.size = set->size;                                                                   \
+        return copy;                                                                             \
+    }                                                                                            \
+    [[maybe_unused]] static int name##_remove(name *set, T data)                                 \
+    {                                                                                            \
+        assert(set);                                                                             \
+        if (set->size == 0) return 0;                                                            \
+        const uint64_t _hash = x__##name##_hash(data);                                           \
+        name##Item *item = x__##name##_slot(set->item, set->capacity, data, _hash);              \
+        if (!item->hash) return 0;                                                               \
+        const long mask = set->capacity - 1;                                                     \
+        long i = item - set->item;                                                               \
+        for (long j = (i + 1) & mask; set->item[j].hash; j = (j + 1) & mask) {                   \
+            const long home = set->item[j].hash & mask;                                          \
+            if (((j - home) & mask) >= ((j - i) & mask)) {                                       \
+                set->item[i] = set->item[j];                                                     \
+                i = j;                                                                           \
+            }                                                                                    \
+        }                                                                                        \
+        set->item[i].hash = 0;                                                                   \
+        set->size -= 1;                                                                          \
+        return 1;                                                                                \
+    }                                                                                            \
+    [[maybe_unused]] static T *name##_find(const name *set, T data)                              \
+    {                                                                                            \
+        assert(set);                                                                             \
+        if (set->size == 0) return 0;                                                            \
+        const uint64_t _hash = x__##name##_hash(data);                                           \
+        name##Item *item = x__##name##_slot(set->item, set->capacity, data, _hash);              \
+        return (item->hash ? &item->data : 0);                                                   \
+    }                                                                                            \
+    [[maybe_unused]] static void name##_clear(name *set)                                         \
+    {                                                                                            \
+        assert(set);                                                                             \
+        allocator_free(&set->alloc, set->item);                                                  \
+        *set = (name){0};                                                                        \
+    }
+
+#define SetForEachTyped(item, set)                                                     \
+    for (typeof((set)->item) item = (set)->item; item < (set)->item + (set)->capacity; \
+         ++item)                                                                       \
+        if (item->hash)
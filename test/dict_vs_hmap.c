@@ -6,53 +6,55 @@
 #include "../hmap.h"
 
 void stress_dict(long n, long capacity, double load_factor, DictKeyHash hash);
-void stress_hmap(long n, long capacity, double load_factor, HmapKeyHash hash);
+void stress_hmap(long n, long capacity, double load_factor, HmapKeyHash hash, int flags);
 char *number(char *str, long num);
 
-/* Compiled with release flags I get:
+/* Compiled with release flags (and gcc) I get the times of dict, hmap, and hmap with the swiss
+ * table backend, and the speedups of both hmaps over dict:
  * - for m = 0 (maximum amount of resizing):
- *   0.05:     1.5534,     1.3444,     0.1345
- *   0.10:     2.0774,     1.7301,     0.1672
- *   0.15:     1.1148,     0.9791,     0.1218
- *   0.20:     0.9256,     0.8227,     0.1111
- *   0.25:     1.1039,     0.9411,     0.1474
- *   0.30:     0.9032,     0.7847,     0.1312
- *   0.35:     0.9258,     0.7964,     0.1398
- *   0.40:     0.9479,     0.8085,     0.1470
- *   0.45:     0.9487,     0.7885,     0.1689
- *   0.50:     0.9087,     0.7482,     0.1766
- *   0.55:     0.9908,     0.7832,     0.2096
- *   0.60:     1.0357,     0.7993,     0.2283
- *   0.65:     1.0353,     0.8250,     0.2032
- *   0.70:     1.2060,     0.8332,     0.3091
- *   0.75:     1.1596,     0.8234,     0.2899
- *   0.80:     1.3033,     0.9131,     0.2994
- *   0.85:     1.4334,     1.0385,     0.2755
- *   0.90:     1.7734,     1.4115,     0.2041
- *   0.95:     2.5671,     2.7638,    -0.0766
+ *   0.05:     5.0142,     4.2536,     3.9056,     0.1517,     0.2211
+ *   0.10:     7.0105,     6.1505,     7.0991,     0.1227,    -0.0126
+ *   0.15:     3.9307,     3.4621,     4.7835,     0.1192,    -0.2170
+ *   0.20:     2.7287,     2.7193,     4.1768,     0.0034,    -0.5307
+ *   0.25:     3.8280,     3.5213,     3.6504,     0.0801,     0.0464
+ *   0.30:     2.8157,     2.6755,     3.1319,     0.0498,    -0.1123
+ *   0.35:     2.3781,     2.6447,     3.0718,    -0.1121,    -0.2917
+ *   0.40:     2.9022,     2.3380,     3.0606,     0.1944,    -0.0546
+ *   0.45:     3.2576,     2.5883,     3.0957,     0.2055,     0.0497
+ *   0.50:     2.6103,     2.4838,     2.6279,     0.0485,    -0.0067
+ *   0.55:     2.8295,     2.6328,     2.9802,     0.0695,    -0.0533
+ *   0.60:     3.2505,     2.9293,     2.6855,     0.0988,     0.1738
+ *   0.65:     2.7291,     2.6077,     2.7850,     0.0445,    -0.0205
+ *   0.70:     3.2122,     2.5546,     2.6846,     0.2047,     0.1643
+ *   0.75:     3.2435,     3.0627,     2.6910,     0.0557,     0.1703
+ *   0.80:     3.4428,     3.4558,     2.5236,    -0.0038,     0.2670
+ *   0.85:     3.7315,     4.3193,     2.6288,    -0.1575,     0.2955
+ *   0.90:     4.9058,     5.9145,     2.9721,    -0.2056,     0.3942
+ *   0.95:     7.6542,    14.6910,     3.9543,    -0.9193,     0.4834
  * - for m = n (no resizing):
- *   0.05:     1.2129,     1.0731,     0.1153
- *   0.10:     0.9908,     0.8953,     0.0964
- *   0.15:     0.9227,     0.8381,     0.0918
- *   0.20:     0.8889,     0.8096,     0.0892
- *   0.25:     0.8741,     0.7889,     0.0974
- *   0.30:     0.8644,     0.7756,     0.1027
- *   0.35:     0.8598,     0.7659,     0.1093
- *   0.40:     0.8598,     0.7582,     0.1181
- *   0.45:     0.8589,     0.7505,     0.1262
- *   0.50:     0.8601,     0.7475,     0.1310
- *   0.55:     0.8629,     0.7398,     0.1427
- *   0.60:     0.8657,     0.7307,     0.1559
- *   0.65:     0.8720,     0.7274,     0.1658
- *   0.70:     0.8717,     0.7203,     0.1736
- *   0.75:     0.8758,     0.7174,     0.1809
- *   0.80:     0.8796,     0.7120,     0.1905
- *   0.85:     0.8841,     0.7172,     0.1888
- *   0.90:     0.8881,     0.7278,     0.1805
- *   0.95:     0.8933,     0.7742,     0.1333
+ *   0.05:     4.1223,     3.7735,     4.0186,     0.0846,     0.0252
+ *   0.10:     3.2812,     3.0723,     3.3667,     0.0637,    -0.0261
+ *   0.15:     3.0889,     2.8248,     3.2603,     0.0855,    -0.0555
+ *   0.20:     2.9594,     2.6208,     3.0238,     0.1144,    -0.0217
+ *   0.25:     2.6624,     2.2978,     2.5138,     0.1369,     0.0558
+ *   0.30:     2.2020,     2.1876,     2.6400,     0.0066,    -0.1989
+ *   0.35:     2.5219,     2.2502,     2.3599,     0.1077,     0.0642
+ *   0.40:     2.1732,     2.0704,     2.8102,     0.0473,    -0.2931
+ *   0.45:     2.5583,     2.2528,     2.8418,     0.1194,    -0.1108
+ *   0.50:     2.4951,     2.3684,     2.7201,     0.0508,    -0.0902
+ *   0.55:     2.5276,     2.2219,     2.3830,     0.1209,     0.0572
+ *   0.60:     2.2504,     2.1166,     2.6918,     0.0595,    -0.1961
+ *   0.65:     2.5440,     2.3822,     2.3699,     0.0636,     0.0684
+ *   0.70:     2.6170,     2.3871,     2.6095,     0.0879,     0.0029
+ *   0.75:     2.6744,     2.3022,     2.3498,     0.1392,     0.1214
+ *   0.80:     2.5260,     2.1886,     2.7237,     0.1336,    -0.0783
+ *   0.85:     2.5076,     2.6200,     2.5282,    -0.0448,    -0.0082
+ *   0.90:     2.3610,     2.3860,     2.5885,    -0.0106,    -0.0964
+ *   0.95:     2.5766,     2.9422,     2.6719,    -0.1419,    -0.0370
  *
- * This show that hmap is consistently faster than dict, except for very high low load factors,
- * where both data structures perform badly. I get similar results if compiled with gcc.
+ * This shows that hmap is mostly faster than dict, except for very high load factors. Without
+ * resizing, the swiss table backend is about as fast as hmap, but with resizing it stays fast at
+ * high load factors, where both dict and hmap perform badly.
  */
 int main(void)
 {
@@ -65,20 +67,27 @@ int main(void)
         stress_dict(n, capacity, load_factor, strhash_fnv1a);
         const clock_t t1 = clock();
 
-        stress_hmap(n, capacity, load_factor, strhash_fnv1a);
+        stress_hmap(n, capacity, load_factor, strhash_fnv1a, 0);
         const clock_t t2 = clock();
-        stress_hmap(n, capacity, load_factor, strhash_fnv1a);
+        stress_hmap(n, capacity, load_factor, strhash_fnv1a, 0);
         const clock_t t3 = clock();
 
-        printf("%.2f: %10.4f, %10.4f, %10.4f\n", load_factor, (t1 - t0) / (double)CLOCKS_PER_SEC,
-               (t3 - t2) / (double)CLOCKS_PER_SEC, 1 - (t3 - t2) / (double)(t1 - t0));
+        stress_hmap(n, capacity, load_factor, strhash_fnv1a, HMAP_SWISS);
+        const clock_t t4 = clock();
+        stress_hmap(n, capacity, load_factor, strhash_fnv1a, HMAP_SWISS);
+        const clock_t t5 = clock();
+
+        printf("%.2f: %10.4f, %10.4f, %10.4f, %10.4f, %10.4f\n", load_factor,
+               (t1 - t0) / (double)CLOCKS_PER_SEC, (t3 - t2) / (double)CLOCKS_PER_SEC,
+               (t5 - t4) / (double)CLOCKS_PER_SEC, 1 - (t3 - t2) / (double)(t1 - t0),
+               1 - (t5 - t4) / (double)(t1 - t0));
     }
 }
 
 void stress_dict(long n, long capacity, double load_factor, DictKeyHash hash)
 {
     char key[1024];
-    Dict dict = dict_create_full(capacity, sizeof(long), load_factor, hash, memcpy, free);
+    Dict dict = dict_create_full(capacity, sizeof(long), load_factor, hash, memcpy, free, 0, 0);
     for (long i = 0; i < n; ++i) dict_insert(&dict, number(key, i), &i, 0);
     assert(dict.size == n);
     for (long i = 0; i < n; ++i) assert(dict_find(&dict, number(key, i)));
@@ -87,10 +96,10 @@ void stress_dict(long n, long capacity, double load_factor, DictKeyHash hash)
     dict_clear(&dict);
 }
 
-void stress_hmap(long n, long capacity, double load_factor, HmapKeyHash hash)
+void stress_hmap(long n, long capacity, double load_factor, HmapKeyHash hash, int flags)
 {
     char key[1024];
-    Hmap hmap = hmap_create_full(capacity, sizeof(long), load_factor, hash, memcpy, free);
+    Hmap hmap = hmap_create_full(capacity, sizeof(long), load_factor, hash, memcpy, free, 0, flags);
     for (long i = 0; i < n; ++i) hmap_insert(&hmap, number(key, i), &i, 0);
     assert(hmap.size == n);
     for (long i = 0; i < n; ++i) assert(hmap_find(&hmap, number(key, i)));
@@ -0,0 +1,42 @@
+#include "varena.h"
+
+#include <stdio.h>
+
+#include "array.h"
+
+int main(void)
+{
+    // create an arena that reserves 64 GiB of virtual memory, backed by huge pages if possible
+    Varena arena = varena_create_full(64L << 30, VARENA_HUGEPAGE);
+    Allocator alloc = varena_allocator(&arena);
+
+    // append ten million integers to an array that lives in the arena; the array is the last
+    // allocation of the arena, so it grows in place and its data never moves
+    Array a = array_create_full(1, sizeof(long), 0, memcpy, 0, &alloc, ARRAY_FLAT);
+    const void *data = 0;
+    long moved = 0;
+    for (long i = 0; i < 10000000; ++i) {
+        array_append(&a, &i);
+        if (data && a.data != data) moved += 1;
+        data = a.data;
+    }
+    printf("a.size = %ld\n", a.size);
+    printf("a.data moved %ld times\n", moved);
+    printf("arena used = %td MiB, committed = %td MiB\n", (arena.head - arena.data) >> 20,
+           (arena.commit - arena.data) >> 20);
+
+    // allocate temporary memory in a loop, and release it after every iteration
+    for (long i = 0; i < 100; ++i) {
+        Varena save = varena_save(&arena);
+        for (long j = 0; j < 100; ++j) varena_alloc(&arena, 1, 1 << 10, 16, 1);
+        varena_restore(&arena, save);
+    }
+    printf("arena used = %td MiB\n", (arena.head - arena.data) >> 20);
+
+    // release all allocations and their pages, but keep the reserved range
+    varena_reset(&arena);
+    printf("arena used = %td MiB\n", (arena.head - arena.data) >> 20);
+
+    // cleanup
+    varena_clear(&arena);
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+// mmap with anonymous memory and madvise are part of POSIX and Linux, not of standard C, so that
+// this header needs -D_DEFAULT_SOURCE (or -std=gnu23) on glibc; defining it here would not help if
+// another libc header was already included
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "allocator.h"
+
+// arena allocator that reserves a large range of virtual memory up front, and commits its pages as
+// the arena grows; pointers stay valid, and the last allocation grows in place until the reserved
+// range runs out
+typedef struct Varena Varena;
+
+// ask the kernel to back the arena with transparent huge pages (where supported)
+enum { VARENA_HUGEPAGE = 1 << 0 };
+
+// pages are committed in chunks of this size (the size of a huge page on most systems)
+enum { X__VARENA_COMMIT = 1 << 21 };
+
+struct Varena {
+    int flags;
+    char *data, *prev, *head, *commit, *tail;
+};
+
+// create an empty arena that reserves a given size of virtual memory (e.g., 64 GiB) without
+// committing any of it; the size is rounded up to a multiple of the commit chunk
+static Varena varena_create_full(long reserve, int flags)
+{
+    assert(reserve > 0);
+    const long chunk = X__VARENA_COMMIT;
+    reserve = (reserve + chunk - 1) / chunk * chunk;
+    char *data = mmap(0, reserve, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    assert(data != MAP_FAILED);
+#ifdef MADV_HUGEPAGE
+    if (flags & VARENA_HUGEPAGE) madvise(data, reserve, MADV_HUGEPAGE);
+#endif
+    return (Varena){
+        .flags = flags,
+        .data = data,
+        .prev = data,
+        .head = data,
+        .commit = data,
+        .tail = data + reserve,
+    };
+}
+static Varena varena_create(long reserve)
+{
+    return varena_create_full(reserve, 0);
+}
+
+// commit the pages up to end; abort if the system is out of memory
+static void x__varena_commit(Varena *varena, const char *end)
+{
+    if (end <= varena->commit) return;
+    const long chunk = X__VARENA_COMMIT;
+    const long size = (end - varena->commit + chunk - 1) / chunk * chunk;
+    if (mprotect(varena->commit, size, PROT_READ | PROT_WRITE)) abort();
+    varena->commit += size;
+}
+
+// allocate a block of memory; return aligned pointer on zero size; abort if the reserved range or
+// the system is out of memory
+[[gnu::malloc, gnu::alloc_size(2, 3), gnu::alloc_align(4)]]
+static void *varena_alloc(Varena *varena, long count, long size, long align, int init)
+{
+    assert(varena);
+    assert(varena->data);
+    assert(align > 0 && (align & (align - 1)) == 0);
+    const long padding = -(uintptr_t)varena->head & (align - 1);
+    if (count <= 0 || size <= 0) return varena->head + padding;
+    const long available = varena->tail - varena->head - padding;
+    if (available < 0 || count > available / size) abort();
+    varena->prev = varena->head + padding;
+    assert((uintptr_t)varena->prev % align == 0);
+    varena->head = varena->prev + count * size;
+    x__varena_commit(varena, varena->head);
+    return (init ? memset(varena->prev, 0, count * size) : varena->prev);
+}
+
+// reallocate a block of memory; the last block always grows in place
+static void *varena_realloc(Varena *varena, void *ptr, long new_size, long align)
+{
+    assert(varena);
+    assert(varena->data);
+    if (!ptr || new_size <= 0) return varena_alloc(varena, 1, new_size, align, 0);
+    assert(varena->data <= (char *)ptr && (char *)ptr < varena->head + align);
+    assert((uintptr_t)ptr % align == 0);
+    if (ptr == varena->prev) {
+        if (new_size > varena->tail - varena->prev) abort();
+        varena->head = varena->prev + new_size;
+        x__varena_commit(varena, varena->head);
+        return ptr;
+    }
+    const long max_old_size = varena->head - (char *)ptr;
+    void *new_ptr = varena_alloc(varena, 1, new_size, align, 0);
+    if (max_old_size <= 0) return new_ptr;
+    return memcpy(new_ptr, ptr, (new_size < max_old_size ? new_size : max_old_size));
+}
+
+// return the current state of the arena, so that varena_restore can release everything that is
+// allocated after this call
+static Varena varena_save(const Varena *varena)
+{
+    assert(varena);
+    return *varena;
+}
+
+// release everything that was allocated after the varena_save that returned save; the pages stay
+// committed, so that the next allocations do not fault them in again
+static void varena_restore(Varena *varena, Varena save)
+{
+    assert(varena);
+    assert(save.data == varena->data && save.head <= varena->head);
+    save.commit = varena->commit;
+    *varena = save;
+}
+
+// release all allocations, and return the committed pages to the system; the range stays reserved
+// and the pages are faulted in again (zeroed) on the next use
+static void varena_reset(Varena *varena)
+{
+    assert(varena);
+    assert(varena->data);
+#ifdef MADV_DONTNEED
+    if (varena->commit > varena->data)
+        madvise(varena->data, varena->commit - varena->data, MADV_DONTNEED);
+#endif
+    varena->prev = varena->data;
+    varena->head = varena->data;
+}
+
+// remove all memory from the arena, and release the reserved range
+static void varena_clear(Varena *varena)
+{
+    assert(varena);
+    if (varena->data) munmap(varena->data, varena->tail - varena->data);
+    *varena = (Varena){0};
+}
+
+static void *x__varena_allocate(void *varena, long count, long size, int init)
+{
+    return varena_alloc(varena, count, size, alignof(max_align_t), init);
+}
+
+static void *x__varena_reallocate(void *varena, void *ptr, long size)
+{
+    return varena_realloc(varena, ptr, size, alignof(max_align_t));
+}
+
+// return an allocator that allocates from the arena; memory is only released by varena_reset and
+// varena_clear
+static Allocator varena_allocator(Varena *varena)
+{
+    assert(varena);
+    return (Allocator){
+        .allocate = x__varena_allocate,
+        .reallocate = x__varena_reallocate,
+        .context = varena,
+    };
+}